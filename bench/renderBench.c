@@ -0,0 +1,160 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <render.h>
+#include <eventBus.h>
+#include <score.h>
+
+/*
+ * renderBench draws a fixed number of frames offscreen, with SDL's dummy video driver and
+ * software renderer, and reports how long every draw pass of render() took. Passes are timed
+ * whenever they are drawn, so the samples differ between them: the sky, the ground and the tree
+ * are only drawn when the background layer is rendered again, a few times per run.
+ *
+ * Usage: renderBench [frames] [seed] [leaves]
+ * leaves extra leaves are blown into the scene before the first frame, to time a storm.
+ * The renderer loads the atlas built next to the executable.
+ */
+
+#define DEFAULT_FRAMES 200
+#define DEFAULT_SEED 1
+#define BENCH_GRID_SIZE 4
+#define FRAMES_PER_BACKGROUND_TICK 6 // 100 ms background timer at 60 frames per second.
+#define NUMBER_OF_SCORES 10
+
+static uint64_t* passSamples[RENDER_NUM_PASSES];
+static int numPassSamples[RENDER_NUM_PASSES];
+static int maxSamples = 0;
+
+static void recordPass(renderPassE pass, uint64_t ticks)
+{
+  if (numPassSamples[pass] < maxSamples)
+  {
+    passSamples[pass][numPassSamples[pass]++] = ticks;
+  }
+}
+
+static int compareTicks(const void* a_p, const void* b_p)
+{
+  uint64_t a = *(const uint64_t*)a_p;
+  uint64_t b = *(const uint64_t*)b_p;
+  return (a > b) - (a < b);
+}
+
+static void printStats(const char* name, uint64_t* samples, int numSamples)
+{
+  if (numSamples == 0)
+  {
+    printf("%-18s %8d %10s\n", name, 0, "not drawn");
+    return;
+  }
+  const double msPerTick = 1000.0 / SDL_GetPerformanceFrequency();
+  qsort(samples, numSamples, sizeof(uint64_t), compareTicks);
+  int p99Index = (numSamples * 99 + 99) / 100 - 1;
+  printf("%-18s %8d %10.4f %10.4f %10.4f %10.4f\n",
+         name,
+         numSamples,
+         samples[0] * msPerTick,
+         samples[numSamples / 2] * msPerTick,
+         samples[p99Index] * msPerTick,
+         samples[numSamples - 1] * msPerTick);
+}
+
+static void pumpEvents(void)
+{
+  // The background animation posts events that nobody consumes here.
+  SDL_Event event;
+  while (SDL_PollEvent(&event));
+  busEventS busEvent;
+  while (eventBusPoll(&busEvent));
+}
+
+int main(int argc, char* argv[])
+{
+  int frames = (argc > 1) ? atoi(argv[1]) : DEFAULT_FRAMES;
+  unsigned int seed = (argc > 2) ? (unsigned int)strtoul(argv[2], NULL, 0) : DEFAULT_SEED;
+  int storm = (argc > 3) ? atoi(argv[3]) : 0;
+  if (frames <= 0 || storm < 0)
+  {
+    printf("Usage: %s [frames] [seed] [leaves]\n", argv[0]);
+    return 1;
+  }
+
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+  SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0)
+  {
+    printf("Could not initialize SDL: %s\n", SDL_GetError());
+    return 1;
+  }
+
+  srand(seed);
+  eventBusInit();
+  if (renderInit(BENCH_GRID_SIZE, BENCH_GRID_SIZE) != 0)
+  {
+    SDL_Quit();
+    return 1;
+  }
+  // Drive the background from the frame loop so that every run animates the same way.
+  renderSetBackgroundTimer(false);
+  storm = renderStorm(storm);
+
+  maxSamples = frames;
+  for (int pass = 0; pass < RENDER_NUM_PASSES; pass++)
+  {
+    passSamples[pass] = malloc(frames * sizeof(uint64_t));
+  }
+  uint64_t* frameSamples = malloc(frames * sizeof(uint64_t));
+  uint64_t* scoreBoardSamples = malloc(frames * sizeof(uint64_t));
+
+  char grid[BENCH_GRID_SIZE][BENCH_GRID_SIZE];
+  for (int i = 0; i < BENCH_GRID_SIZE * BENCH_GRID_SIZE; i++)
+  {
+    grid[i / BENCH_GRID_SIZE][i % BENCH_GRID_SIZE] = (i % 3 == 0) ? ' ' : '!' + rand() % ('~' - '!');
+  }
+
+  renderSetPasses(RENDER_ALL_PASSES);
+  renderSetPassTimer(recordPass);
+  for (int frame = 0; frame < frames; frame++)
+  {
+    if (frame % FRAMES_PER_BACKGROUND_TICK == 0) renderTickBackground();
+    renderStepBackgroundFrame();
+    uint64_t frameStart = SDL_GetPerformanceCounter();
+    render(&grid[0][0], frame * 2, 1500);
+    frameSamples[frame] = SDL_GetPerformanceCounter() - frameStart;
+    pumpEvents();
+  }
+  renderSetPassTimer(NULL);
+
+  scoreS hiScoreList[NUMBER_OF_SCORES];
+  for (int i = 0; i < NUMBER_OF_SCORES; i++)
+  {
+    snprintf(hiScoreList[i].name, sizeof(hiScoreList[i].name), "%c%c%c", 'A' + i, 'B' + i, 'C' + i);
+    hiScoreList[i].score = (NUMBER_OF_SCORES - i) * 100 + rand() % 100;
+  }
+  scoreRankS rank = {hiScoreList[0].score / 2, 123456, 61728, true, hiScoreList[0].score};
+  for (int frame = 0; frame < frames; frame++)
+  {
+    uint64_t frameStart = SDL_GetPerformanceCounter();
+    renderScoreBoard(hiScoreList, NUMBER_OF_SCORES, &rank);
+    scoreBoardSamples[frame] = SDL_GetPerformanceCounter() - frameStart;
+    pumpEvents();
+  }
+
+  printf("%d frames, seed %u, %d extra leaves, times in ms\n", frames, seed, storm);
+  printf("%-18s %8s %10s %10s %10s %10s\n", "pass", "samples", "min", "median", "p99", "max");
+  for (int pass = 0; pass < RENDER_NUM_PASSES; pass++)
+  {
+    printStats(renderPassName(pass), passSamples[pass], numPassSamples[pass]);
+    free(passSamples[pass]);
+  }
+  printStats("render()", frameSamples, frames);
+  printStats("renderScoreBoard()", scoreBoardSamples, frames);
+  free(frameSamples);
+  free(scoreBoardSamples);
+
+  renderDestroy();
+  SDL_Quit();
+  return 0;
+}
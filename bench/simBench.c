@@ -0,0 +1,261 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <game.h>
+#include <bot.h>
+#include <workerPool.h>
+
+/*
+ * simBench plays games headless with bot typists on a virtual clock, on all cores, as fast as
+ * the rules run, and reports how long the games last and what they score. For load testing the
+ * rules and tuning the difficulty: the bots and the rules take the same options as a player
+ * would see them, and the results only depend on the seed, not on the number of threads.
+ *
+ * Usage: simBench [games] [seed] [--grid CxR] [--interval MS] [--count N] [--decay F]
+ *                 [--reaction MS] [--jitter MS] [--errors PERCENT] [--key MS] [--check]
+ */
+
+#define DEFAULT_GAMES 10000
+#define DEFAULT_SEED 1
+#define DEFAULT_GRID_SIZE 4
+#define MAX_GRID_SIZE 1024 // Columns or rows, as in main.c.
+#define GAMES_PER_TASK 64
+#define MAX_GAME_MS (6 * 3600 * 1000) // Games still going are stopped and counted as unfinished.
+
+typedef struct simS
+{
+  int games;
+  uint32_t seed;
+  int columns;
+  int rows;
+  gameRulesS rules;
+  botProfileS profile;
+  bool check;
+  // One entry per game.
+  int* scores_p;
+  uint32_t* durationsMs_p;
+  // One entry per task.
+  uint64_t* keys_p;
+  uint64_t* errors_p;
+  int* unfinished_p;
+  int* invalid_p;
+} simS;
+
+/* seedFor() spreads the seed of the run over the games, and the game and its bot of one game. */
+static uint32_t seedFor(uint32_t seed, int game, int stream)
+{
+  uint32_t mixed = seed * 0x9E3779B9u + (uint32_t)game * 2 + stream;
+  mixed ^= mixed >> 16;
+  mixed *= 0x85EBCA6Bu;
+  mixed ^= mixed >> 13;
+  return mixed;
+}
+
+/*
+ * playGame() plays one game to its end and returns the clock then. The clock jumps from one
+ * thing happening to the next, keys first when a spawn is due at the same time, so that the bot
+ * notices the spawns at its clock.
+ */
+static uint32_t playGame(simS* sim_p, gameS* game_p, botS* bot_p, int task)
+{
+  uint32_t nowMs = 0;
+  while (!game_p->lost && nowMs < MAX_GAME_MS)
+  {
+    int untilSpawnMs = gameMsUntilSpawn(game_p, nowMs);
+    int untilKeyMs = botMsUntilKey(bot_p, nowMs);
+    nowMs += (untilKeyMs >= 0 && untilKeyMs < untilSpawnMs) ? untilKeyMs : untilSpawnMs;
+    botStep(bot_p, game_p, nowMs);
+    gameAdvance(game_p, nowMs);
+    if (sim_p->check && !gameValid(game_p))
+    {
+      sim_p->invalid_p[task]++;
+      break;
+    }
+  }
+  if (!game_p->lost) sim_p->unfinished_p[task]++;
+  return nowMs;
+}
+
+static void playTask(void* context_p, int task)
+{
+  simS* sim_p = context_p;
+  int first = task * GAMES_PER_TASK;
+  int last = first + GAMES_PER_TASK < sim_p->games ? first + GAMES_PER_TASK : sim_p->games;
+  for (int i = first; i < last; i++)
+  {
+    gameS game;
+    botS bot;
+    if (!gameInit(&game, sim_p->columns, sim_p->rows, &sim_p->rules, seedFor(sim_p->seed, i, 0)))
+    {
+      sim_p->invalid_p[task]++;
+      continue;
+    }
+    botInit(&bot, &sim_p->profile, seedFor(sim_p->seed, i, 1));
+    gameSetHooks(&game, botHooks(), &bot);
+    sim_p->durationsMs_p[i] = playGame(sim_p, &game, &bot, task);
+    sim_p->scores_p[i] = game.score;
+    sim_p->keys_p[task] += bot.keys;
+    sim_p->errors_p[task] += bot.errors;
+    gameDestroy(&game);
+  }
+}
+
+static int compareInts(const void* a_p, const void* b_p)
+{
+  int a = *(const int*)a_p;
+  int b = *(const int*)b_p;
+  return (a > b) - (a < b);
+}
+
+static int compareUint32s(const void* a_p, const void* b_p)
+{
+  uint32_t a = *(const uint32_t*)a_p;
+  uint32_t b = *(const uint32_t*)b_p;
+  return (a > b) - (a < b);
+}
+
+/* percentileIndex() returns the index of the percent percentile of n sorted samples. */
+static int percentileIndex(int n, int percent)
+{
+  int index = (n * percent + 99) / 100 - 1;
+  return index < 0 ? 0 : index;
+}
+
+static void printUsage(const char* program)
+{
+  printf("Usage: %s [games] [seed] [--grid CxR] [--interval MS] [--count N] [--decay F]\n", program);
+  printf("       [--reaction MS] [--jitter MS] [--errors PERCENT] [--key MS] [--check]\n");
+  printf("  --interval MS     first spawn interval, --count N spawns between the decays of the\n");
+  printf("                    interval by --decay F\n");
+  printf("  --reaction MS     the bots' mean reaction time, spread by +- --jitter MS\n");
+  printf("  --errors PERCENT  keys typed wrong, --key MS the shortest time between two keys\n");
+  printf("  --check           check the game after every step, slower\n");
+}
+
+int main(int argc, char* argv[])
+{
+  simS sim = {DEFAULT_GAMES, DEFAULT_SEED, DEFAULT_GRID_SIZE, DEFAULT_GRID_SIZE,
+              GAME_DEFAULT_RULES, BOT_DEFAULT_PROFILE, false, NULL, NULL, NULL, NULL, NULL, NULL};
+  int numbers = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    unsigned int columns;
+    unsigned int rows;
+    if (strcmp(argv[i], "--check") == 0) sim.check = true;
+    else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) sim.rules.startIntervalMs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) sim.rules.intervalCount = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--decay") == 0 && i + 1 < argc) sim.rules.intervalDecay = atof(argv[++i]);
+    else if (strcmp(argv[i], "--reaction") == 0 && i + 1 < argc) sim.profile.reactionMs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) sim.profile.jitterMs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--errors") == 0 && i + 1 < argc) sim.profile.errorPercent = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--key") == 0 && i + 1 < argc) sim.profile.keyMs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc &&
+             sscanf(argv[i + 1], "%ux%u", &columns, &rows) == 2 &&
+             columns > 0 && columns <= MAX_GRID_SIZE && rows > 0 && rows <= MAX_GRID_SIZE)
+    {
+      sim.columns = columns;
+      sim.rows = rows;
+      i++;
+    }
+    else if (argv[i][0] != '-' && numbers == 0 && (sim.games = atoi(argv[i])) > 0) numbers++;
+    else if (argv[i][0] != '-' && numbers == 1)
+    {
+      sim.seed = strtoul(argv[i], NULL, 0);
+      numbers++;
+    }
+    else
+    {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (sim.profile.reactionMs < 0 || sim.profile.jitterMs < 0 ||
+      sim.profile.errorPercent < 0 || sim.profile.errorPercent > 100)
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+  // Checks the rules before any thread does.
+  gameS game;
+  if (!gameInit(&game, sim.columns, sim.rows, &sim.rules, sim.seed)) return 1;
+  gameDestroy(&game);
+
+  if (SDL_Init(SDL_INIT_TIMER) != 0)
+  {
+    printf("Could not initialize SDL: %s\n", SDL_GetError());
+    return 1;
+  }
+  int workerThreads = SDL_GetCPUCount() - 1;
+  if (!workerPoolInit(workerThreads > 0 ? workerThreads : 0))
+  {
+    SDL_Quit();
+    return 1;
+  }
+  int numTasks = (sim.games + GAMES_PER_TASK - 1) / GAMES_PER_TASK;
+  sim.scores_p = calloc(sim.games, sizeof(int));
+  sim.durationsMs_p = calloc(sim.games, sizeof(uint32_t));
+  sim.keys_p = calloc(numTasks, sizeof(uint64_t));
+  sim.errors_p = calloc(numTasks, sizeof(uint64_t));
+  sim.unfinished_p = calloc(numTasks, sizeof(int));
+  sim.invalid_p = calloc(numTasks, sizeof(int));
+  if (sim.scores_p == NULL || sim.durationsMs_p == NULL || sim.keys_p == NULL ||
+      sim.errors_p == NULL || sim.unfinished_p == NULL || sim.invalid_p == NULL)
+  {
+    printf("Could not allocate the results of %d games.\n", sim.games);
+    return 1;
+  }
+
+  uint64_t start = SDL_GetPerformanceCounter();
+  workerPoolRun(playTask, &sim, numTasks);
+  double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+  uint64_t keys = 0;
+  uint64_t errors = 0;
+  int unfinished = 0;
+  int invalid = 0;
+  for (int task = 0; task < numTasks; task++)
+  {
+    keys += sim.keys_p[task];
+    errors += sim.errors_p[task];
+    unfinished += sim.unfinished_p[task];
+    invalid += sim.invalid_p[task];
+  }
+  double playedMs = 0;
+  for (int i = 0; i < sim.games; i++)
+  {
+    playedMs += sim.durationsMs_p[i];
+  }
+  qsort(sim.scores_p, sim.games, sizeof(int), compareInts);
+  qsort(sim.durationsMs_p, sim.games, sizeof(uint32_t), compareUint32s);
+
+  printf("%d games on %dx%d cells, seed %u, %d threads\n", sim.games, sim.columns, sim.rows, sim.seed, workerPoolSize());
+  printf("Rules: a character every %d ms, %d times then %.2f times as often\n",
+         sim.rules.startIntervalMs, sim.rules.intervalCount, sim.rules.intervalDecay);
+  printf("Bots: %d +- %d ms reaction, %d%% errors, a key at most every %d ms\n",
+         sim.profile.reactionMs, sim.profile.jitterMs, sim.profile.errorPercent, sim.profile.keyMs);
+  printf("%.3f s, %.0f games/s, %.0f times real time\n",
+         seconds, sim.games / seconds, playedMs / 1000.0 / seconds);
+  printf("%-12s %10s %10s %10s %10s %10s\n", "", "min", "median", "p90", "p99", "max");
+  printf("%-12s %10d %10d %10d %10d %10d\n", "score", sim.scores_p[0],
+         sim.scores_p[sim.games / 2], sim.scores_p[percentileIndex(sim.games, 90)],
+         sim.scores_p[percentileIndex(sim.games, 99)], sim.scores_p[sim.games - 1]);
+  printf("%-12s %10.1f %10.1f %10.1f %10.1f %10.1f\n", "length (s)", sim.durationsMs_p[0] / 1000.0,
+         sim.durationsMs_p[sim.games / 2] / 1000.0, sim.durationsMs_p[percentileIndex(sim.games, 90)] / 1000.0,
+         sim.durationsMs_p[percentileIndex(sim.games, 99)] / 1000.0, sim.durationsMs_p[sim.games - 1] / 1000.0);
+  printf("%.1f keys per game, %.1f%% of them wrong\n",
+         (double)keys / sim.games, keys > 0 ? 100.0 * errors / keys : 0.0);
+  if (unfinished > 0) printf("%d games still going after %d s were stopped.\n", unfinished, MAX_GAME_MS / 1000);
+  if (invalid > 0) printf("%d games broke the rules.\n", invalid);
+
+  free(sim.scores_p);
+  free(sim.durationsMs_p);
+  free(sim.keys_p);
+  free(sim.errors_p);
+  free(sim.unfinished_p);
+  free(sim.invalid_p);
+  workerPoolDestroy();
+  SDL_Quit();
+  return invalid > 0 ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fixedTrig.h>
+
+/*
+ * trigBench checks fixedTrig against libm and times both.
+ * Exits with 1 when an error bound documented in fixedTrig.h is exceeded.
+ *
+ * Usage: trigBench [calls]
+ */
+
+#define DEFAULT_CALLS 10000000
+#define SIN_BOUND 2e-5
+#define ASIN_BOUND 1e-5
+#define SQRT_BOUND (0.5 / FIXED_ONE)
+#define ANGLE_STEP 4099 // Odd, so every table position and fraction is visited.
+
+static bool checkBound(const char* name, double maxError, double bound)
+{
+  bool pass = maxError <= bound;
+  printf("%-10s max error %.3e, bound %.3e %s\n", name, maxError, bound, pass ? "ok" : "FAILED");
+  return pass;
+}
+
+static bool checkAccuracy(void)
+{
+  double sinError = 0;
+  double cosError = 0;
+  for (uint64_t angle = 0; angle < (1ull << 32); angle += ANGLE_STEP)
+  {
+    double radians = angle * (2 * M_PI / 4294967296.0);
+    sinError = fmax(sinError, fabs(fixedToDouble(fixedSin((fixedAngleT)angle)) - sin(radians)));
+    cosError = fmax(cosError, fabs(fixedToDouble(fixedCos((fixedAngleT)angle)) - cos(radians)));
+  }
+
+  double asinError = 0;
+  for (fixedT value = -FIXED_ONE; value <= FIXED_ONE; value++)
+  {
+    asinError = fmax(asinError, fabs(fixedToDouble(fixedAsin(value)) - asin(fixedToDouble(value))));
+  }
+
+  double sqrtError = 0;
+  for (fixedT value = 0; value < 64 * FIXED_ONE; value += 7)
+  {
+    sqrtError = fmax(sqrtError, fabs(fixedToDouble(fixedSqrt(value)) - sqrt(fixedToDouble(value))));
+  }
+
+  // The conversion only matters through what it does to the result.
+  double radiansError = 0;
+  for (int i = -100000; i <= 100000; i++)
+  {
+    double radians = i / 97.0;
+    radiansError = fmax(radiansError, fabs(fixedToDouble(fixedSin(fixedAngleFromRadians(radians))) - sin(radians)));
+  }
+
+  bool pass = true;
+  pass &= checkBound("fixedSin", sinError, SIN_BOUND);
+  pass &= checkBound("fixedCos", cosError, SIN_BOUND);
+  pass &= checkBound("fixedAsin", asinError, ASIN_BOUND);
+  pass &= checkBound("fixedSqrt", sqrtError, SQRT_BOUND);
+  pass &= checkBound("radians", radiansError, SIN_BOUND);
+  return pass;
+}
+
+static double seconds(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Sums keep the compiler from dropping the calls, volatile keeps it from folding them.
+static volatile double doubleSink;
+static volatile fixedT fixedSink;
+
+static void timeCalls(int calls)
+{
+  double start = seconds();
+  double doubleSum = 0;
+  for (int i = 0; i < calls; i++) doubleSum += sin(i / 50.0);
+  double libmSin = seconds() - start;
+  doubleSink = doubleSum;
+
+  start = seconds();
+  fixedT fixedSum = 0;
+  fixedAngleT step = fixedAngleFromRadians(1 / 50.0);
+  for (int i = 0; i < calls; i++) fixedSum += fixedSin(i * step);
+  double tableSin = seconds() - start;
+  fixedSink = fixedSum;
+
+  start = seconds();
+  doubleSum = 0;
+  for (int i = 0; i < calls; i++) doubleSum += cos(i / 50.0);
+  double libmCos = seconds() - start;
+  doubleSink = doubleSum;
+
+  start = seconds();
+  fixedSum = 0;
+  for (int i = 0; i < calls; i++) fixedSum += fixedCos(fixedAngleFromRadians(i / 50.0));
+  double tableCos = seconds() - start;
+  fixedSink = fixedSum;
+
+  start = seconds();
+  doubleSum = 0;
+  for (int i = 0; i < calls; i++) doubleSum += asin((i & 0xFFFF) / 65536.0);
+  double libmAsin = seconds() - start;
+  doubleSink = doubleSum;
+
+  start = seconds();
+  fixedSum = 0;
+  for (int i = 0; i < calls; i++) fixedSum += fixedAsin(i & 0xFFFF);
+  double tableAsin = seconds() - start;
+  fixedSink = fixedSum;
+
+  const double nsPerCall = 1e9 / calls;
+  printf("\n%-34s %10s %10s\n", "ns per call", "libm", "fixedTrig");
+  printf("%-34s %10.2f %10.2f\n", "sin, angle steps", libmSin * nsPerCall, tableSin * nsPerCall);
+  printf("%-34s %10.2f %10.2f\n", "cos, converted from radians", libmCos * nsPerCall, tableCos * nsPerCall);
+  printf("%-34s %10.2f %10.2f\n", "asin", libmAsin * nsPerCall, tableAsin * nsPerCall);
+}
+
+int main(int argc, char* argv[])
+{
+  int calls = (argc > 1) ? atoi(argv[1]) : DEFAULT_CALLS;
+  if (calls <= 0) calls = DEFAULT_CALLS;
+
+  fixedTrigInit();
+  bool pass = checkAccuracy();
+  timeCalls(calls);
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * The bitmaps of the game, packed into one file at build time by tools/atlasPack.c. Images are
+ * stacked into pages, a page is uploaded as one texture. The pixels are stored in the format
+ * they are drawn in, with the colour keys already turned into transparent pixels, so the file is
+ * mapped as it is and its pixels go to SDL without being decoded or converted.
+ *
+ * The file is an atlasHeaderS, numPages atlasPageS, numImages atlasImageS and the pages, each
+ * starting at a multiple of ATLAS_ALIGN. Everything is little endian.
+ */
+
+#define ATLAS_FILE "stormClacker.atlas" // Next to the executable.
+#define ATLAS_MAGIC 0x534C5441u         // "ATLS"
+#define ATLAS_VERSION 1
+#define ATLAS_PIXEL_FORMAT SDL_PIXELFORMAT_ABGR8888 // Like the streaming textures.
+#define ATLAS_ALIGN 64
+#define ATLAS_NAME_SIZE 16
+#define ATLAS_KEYED 1 // The image had a colour key, its pixels have alpha 0.
+
+typedef struct atlasHeaderS
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;      // Of the whole file.
+  uint32_t numPages;
+  uint32_t numImages;
+} atlasHeaderS;
+
+typedef struct atlasPageS
+{
+  uint32_t format;    // ATLAS_PIXEL_FORMAT.
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch;     // Bytes from one row to the next.
+  uint32_t offset;    // Of the first row, from the start of the file.
+} atlasPageS;
+
+typedef struct atlasImageS
+{
+  char name[ATLAS_NAME_SIZE];
+  uint32_t page;
+  uint32_t x;         // Where the image is in its page.
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  uint32_t flags;     // ATLAS_KEYED.
+  uint32_t colorKey;  // In ATLAS_PIXEL_FORMAT, with the alpha it had in the bitmap.
+} atlasImageS;
+
+/* atlasOpen() maps the atlas file and checks its headers. */
+bool atlasOpen(const char* path_p);
+
+/* atlasClose() unmaps the file, the pixels handed out before are gone after it. */
+void atlasClose(void);
+
+/* atlasFind() returns the image called name_p, or NULL. */
+const atlasImageS* atlasFind(const char* name_p);
+
+/* atlasPixel() returns the pixel at x, y of the image, 0 outside it. */
+uint32_t atlasPixel(const atlasImageS* image_p, int x, int y);
+
+/* atlasPixels() returns the first row of the image, and the pixels from one row to the next
+ * in stride_p. */
+const uint32_t* atlasPixels(const atlasImageS* image_p, int* stride_p);
+
+/* atlasCreateTexture() uploads the page of the image into a static texture, drawn blended.
+ * Images sharing a page share the texture, their source rects are offset by the image x, y. */
+SDL_Texture* atlasCreateTexture(SDL_Renderer* renderer_p, const atlasImageS* image_p);
+
+#endif
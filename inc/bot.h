@@ -0,0 +1,56 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <stdint.h>
+#include <game.h>
+
+/*
+ * A bot typist that plays a game on its virtual clock, for load testing the rules and tuning the
+ * difficulty. The bot notices every spawn after its reaction time, types the characters in the
+ * order it noticed them, no faster than one key every keyMs, and types a wrong key now and then,
+ * after which it types the right one. Hook it up with botHooks(), which a game calls as it
+ * changes. Not thread safe, one bot per game.
+ */
+
+typedef struct botProfileS
+{
+  int reactionMs;     // Mean time from a spawn until the bot may type it.
+  int jitterMs;       // Reaction times are spread evenly over the mean +- jitterMs.
+  int errorPercent;   // Keys typed wrong, each a miss.
+  int keyMs;          // Shortest time between two keys, at least 1.
+} botProfileS;
+
+#define BOT_DEFAULT_PROFILE {450, 150, 5, 120}
+
+typedef struct botS
+{
+  botProfileS profile;
+  uint32_t random;
+  // The characters noticed or about to be and not typed yet, in a ring sorted by dueMs.
+  int queue[GAME_NUM_CHARS];
+  uint32_t dueMs[GAME_NUM_CHARS]; // When the character at the same place in queue is noticed.
+  int head;
+  int count;
+  uint32_t nowMs;                 // The clock, as last given to botStep().
+  uint32_t nextKeyMs;             // Keys are typed no sooner than this.
+  uint64_t keys;
+  uint64_t errors;
+} botS;
+
+/* botInit() makes a bot typing with the profile. The seed decides its reactions and errors. */
+void botInit(botS* bot_p, const botProfileS* profile_p, uint32_t seed);
+
+/* botReset() forgets what the bot noticed, for a new game. */
+void botReset(botS* bot_p);
+
+/* botHooks() returns the hooks that let the bot watch a game, the bot being their context. */
+const gameHooksS* botHooks(void);
+
+/* botMsUntilKey() returns how long after nowMs the bot types its next key, or -1 when it has
+ * nothing to type. */
+int botMsUntilKey(const botS* bot_p, uint32_t nowMs);
+
+/* botStep() moves the bot's clock to nowMs and types the keys that are due into the game. */
+void botStep(botS* bot_p, gameS* game_p, uint32_t nowMs);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef BUMP_MAP_H
+#define BUMP_MAP_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BUMP_MAP_MAX_DIRTY_RECTS 8
+
+/* A row-major map of packed SDL_PIXELFORMAT_ABGR8888 pixels that remembers which
+ * rectangles changed since it was last uploaded to a texture. */
+typedef struct bumpMapS
+{
+  int width;
+  int height;
+  uint32_t* pixels_p;
+  SDL_Rect dirtyRects[BUMP_MAP_MAX_DIRTY_RECTS];
+  int numDirtyRects;
+} bumpMapS;
+
+/* bumpMapInit() allocates the map, fills it with color and marks all of it dirty. */
+bool bumpMapInit(bumpMapS* map_p, int width, int height, uint32_t color);
+
+/* bumpMapDestroy() frees the pixels of the map. */
+void bumpMapDestroy(bumpMapS* map_p);
+
+/* bumpMapAdd() adds amount to every pixel inside rect_p and marks the rectangle dirty.
+ * The rectangle is clipped to the map. */
+void bumpMapAdd(bumpMapS* map_p, const SDL_Rect* rect_p, uint32_t amount);
+
+/* bumpMapUpload() copies the dirty rectangles into texture_p, which must be as large as
+ * the map, and clears them. Nothing is copied when nothing changed. */
+void bumpMapUpload(bumpMapS* map_p, SDL_Texture* texture_p);
+
+#endif
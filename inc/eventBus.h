@@ -0,0 +1,71 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Game events from the timer, world and worker threads to the main thread, in a bounded ring
+ * that any number of threads publish into without a lock and only the main thread takes events
+ * from. Every slot has a sequence number, the slot is the publisher's once its claim of the tail
+ * succeeds and the main thread's once the sequence number says it is written.
+ *
+ * The main thread is woken up by one SDL_USEREVENT with code EVENT_BUS_WAKEUP however many
+ * events are published before it polls, instead of one SDL event per event. A full ring drops
+ * the event and counts it.
+ */
+
+#define EVENT_BUS_CAPACITY 1024 // A power of two.
+#define EVENT_BUS_WAKEUP 0x42555321 // SDL_UserEvent code of the wakeup.
+
+typedef enum busEventTypeE
+{
+  BUS_SPAWN,     // A character was put on the grid.
+  BUS_HIT,       // A character was shot off the grid.
+  BUS_MISS,      // A character was typed that is not on the grid, pos is -1.
+  BUS_WIND,      // The background changed.
+  BUS_GAME_OVER, // The grid was full.
+} busEventTypeE;
+
+typedef struct busEventS
+{
+  busEventTypeE type;
+  union
+  {
+    struct
+    {
+      int charIndex;
+      int pos;
+    } spawn, hit, miss;
+    struct
+    {
+      int speed;
+    } wind;
+  };
+} busEventS;
+
+typedef struct eventBusStatsS
+{
+  uint32_t published;
+  uint32_t dropped;  // Published while the ring was full.
+  uint32_t depth;    // Events waiting right now.
+  uint32_t maxDepth; // The most events ever waiting.
+  uint32_t wakeups;  // SDL events pushed to wake the main thread.
+} eventBusStatsS;
+
+/* eventBusInit() empties the ring, before any thread publishes into it. */
+void eventBusInit(void);
+
+/* eventBusPublish() queues the event and wakes up the main thread. Safe to call from any
+ * thread. Returns false when the ring is full and the event is dropped. */
+bool eventBusPublish(const busEventS* event_p);
+
+/* eventBusPoll() takes the oldest event. Returns false when there is none. Only called by the
+ * main thread. */
+bool eventBusPoll(busEventS* event_p);
+
+/* eventBusStats() returns the counters of the bus. */
+eventBusStatsS eventBusStats(void);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef FIXED_TRIG_H
+#define FIXED_TRIG_H
+
+#include <stdint.h>
+
+/*
+ * Table driven fixed point trigonometry for the animations, so the per frame paths do not call
+ * libm. Values are 16.16 fixed point, angles are binary angles where 2^32 is one full turn, so
+ * they wrap around for free.
+ *
+ * Error bounds, checked against libm by bench/trigBench.c:
+ *   fixedSin(), fixedCos()  |error| <= 2e-5      (1024 entry table, linear interpolation)
+ *   fixedAsin()             |error| <= 1e-5 rad  (512 entry table on [0, 0.5], the rest through
+ *                                                 asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2)))
+ *   fixedSqrt()             |error| <= 0.5 / 65536 (rounded to the nearest value)
+ * fixedAngleFromRadians() adds at most 1.5e-9 rad for the conversion.
+ */
+
+typedef int32_t fixedT;
+typedef uint32_t fixedAngleT;
+
+#define FIXED_ONE 65536
+#define FIXED_HALF_TURN 0x80000000u
+#define FIXED_QUARTER_TURN 0x40000000u
+
+#define FIXED_ANGLE_PER_RADIAN 683565275.57643163 // 2^32 / (2 pi)
+
+/* FIXED_TURNS() is the angle of num / den turns, FIXED_RADIANS() of a constant in radians. */
+#define FIXED_TURNS(num, den) ((fixedAngleT)((((int64_t)(num)) << 32) / (den)))
+#define FIXED_RADIANS(radians) ((fixedAngleT)(int64_t)((radians) * FIXED_ANGLE_PER_RADIAN))
+
+/* fixedTrigInit() fills the tables. It has to be called before anything else here, calling it
+ * again does nothing. */
+void fixedTrigInit(void);
+
+fixedT fixedSin(fixedAngleT angle);
+fixedT fixedCos(fixedAngleT angle);
+
+/* fixedAsin() returns asin(value) in 16.16 radians. value is clamped to [-1, 1].
+ * Above 0.5 it takes an integer square root, it is meant for building tables, not per frame. */
+fixedT fixedAsin(fixedT value);
+
+/* fixedSqrt() returns the square root of a non negative value, 0 for negative ones. */
+fixedT fixedSqrt(fixedT value);
+
+/* fixedAngleFromRadians() converts any angle in radians, also outside one turn. */
+fixedAngleT fixedAngleFromRadians(double radians);
+
+fixedT fixedFromDouble(double value);
+double fixedToDouble(fixedT value);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef FREE_SET_H
+#define FREE_SET_H
+
+#include <stdbool.h>
+
+/*
+ * A set of the integers 0 to capacity - 1, kept as a packed array of the members plus the
+ * position of every integer in that array. Adding, removing, testing and picking a random member
+ * are all constant time: a removed member is replaced by the last one. Not thread safe.
+ */
+typedef struct freeSetS
+{
+  int capacity;
+  int count;
+  int* members_p;   // The first count entries are the members, in no particular order.
+  int* positions_p; // Where every integer is in members_p, or -1 when it is not a member.
+} freeSetS;
+
+/* freeSetInit() allocates a set for capacity integers, holding all of them if full is true. */
+bool freeSetInit(freeSetS* set_p, int capacity, bool full);
+
+/* freeSetDestroy() frees the set. */
+void freeSetDestroy(freeSetS* set_p);
+
+/* freeSetFill() makes the set hold all of its integers, or none of them. */
+void freeSetFill(freeSetS* set_p, bool full);
+
+/* freeSetAdd() and freeSetRemove() do nothing when item already is, or is not, a member. */
+void freeSetAdd(freeSetS* set_p, int item);
+void freeSetRemove(freeSetS* set_p, int item);
+
+/* freeSetContains() returns true when item is a member. */
+bool freeSetContains(const freeSetS* set_p, int item);
+
+/* freeSetPick() returns the member selected by random, which should be uniformly distributed,
+ * or -1 when the set is empty. The member stays in the set. */
+int freeSetPick(const freeSetS* set_p, unsigned int random);
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <freeSet.h>
+#include <score.h>
+
+/*
+ * The rules of the game, on a game of its own, without timers, threads or rendering. Time is a
+ * virtual clock in milliseconds since the game started that the caller moves forward, so the
+ * same rules run in real time on screen and thousands of times faster without one. A game is
+ * not thread safe, but any number of games run on as many threads.
+ *
+ * Characters are spawned one spawn interval after the other on random empty cells. Every
+ * intervalCount spawns the interval is multiplied by intervalDecay. Every character is in play at
+ * most once, the game is lost when a spawn falls due with no empty cell left or, on a board of
+ * more than GAME_NUM_CHARS cells, with every character in play.
+ */
+
+#define GAME_START_CHAR 33 // '!', the first character played with.
+#define GAME_END_CHAR 126
+#define GAME_NUM_CHARS (GAME_END_CHAR - GAME_START_CHAR)
+#define GAME_EMPTY_CELL ' '
+#define GAME_NONE (-1) // No character, or no cell.
+
+/* The difficulty of the game. */
+typedef struct gameRulesS
+{
+  int startIntervalMs;
+  int intervalCount;    // Spawns between two decays of the interval.
+  float intervalDecay;
+  int hitPoints;
+  int missPoints;
+} gameRulesS;
+
+#define GAME_DEFAULT_RULES {1500, 40, 0.8f, 2, -1}
+#define GAME_MIN_INTERVAL_MS 1 // The interval decays no further.
+
+/* Called as the rules change the game, for what mirrors it: the grid that is drawn, statistics,
+ * events or a bot watching the game. Any of them may be NULL. context_p is the one given to
+ * gameSetHooks(). */
+typedef struct gameHooksS
+{
+  void (*spawned)(void* context_p, int charIndex, int pos);
+  void (*hit)(void* context_p, int charIndex, int pos);
+  void (*missed)(void* context_p, int charIndex);
+  void (*lost)(void* context_p);
+  // Picks the character to spawn among the free ones, uniformly when NULL.
+  int (*pick)(void* context_p, const freeSetS* freeChars_p);
+} gameHooksS;
+
+typedef struct gameS
+{
+  gameRulesS rules;
+  const gameHooksS* hooks_p;
+  void* hooksContext_p;
+  int columns;
+  int rows;
+  char* cells_p;                     // columns * rows, row after row.
+  freeSetS emptyCells;
+  freeSetS freeChars;                // The characters not in play.
+  int placement[GAME_NUM_CHARS];     // The cell of every character in play, or GAME_NONE.
+  int score;
+  int intervalMs;
+  int intervalCountDown;
+  uint32_t nextSpawnMs;
+  bool lost;
+  uint32_t random;                   // State of the xorshift generator of the spawns.
+} gameS;
+
+/* gameInit() makes a game on columns x rows cells, ready to be played. The seed decides the
+ * spawns. */
+bool gameInit(gameS* game_p, int columns, int rows, const gameRulesS* rules_p, uint32_t seed);
+
+/* gameSetHooks() has the game call hooks_p, which must stay valid as long as the game, or no
+ * hooks when NULL. */
+void gameSetHooks(gameS* game_p, const gameHooksS* hooks_p, void* context_p);
+
+/* gameDestroy() frees the game. */
+void gameDestroy(gameS* game_p);
+
+/* gameReset() starts a new game, at 0 ms of the clock. */
+void gameReset(gameS* game_p);
+
+/* gameMsUntilSpawn() returns how long after nowMs the next character is due, 0 when it is
+ * overdue and -1 when the game is lost. */
+int gameMsUntilSpawn(const gameS* game_p, uint32_t nowMs);
+
+/* gamePickSpawn() decides what the next spawn is: a free character, or GAME_NONE when all are in
+ * play, and an empty cell for it, or GAME_NONE when there is none. */
+void gamePickSpawn(gameS* game_p, int* charIndex_p, int* pos_p);
+
+/* gameSpawn() carries out a spawn decision, of gamePickSpawn() or of a recording, and moves the
+ * next spawn one interval on. No character, or a character without a cell, loses the game. A character already in
+ * play or a cell already taken, from a damaged recording, spawns nothing. */
+void gameSpawn(gameS* game_p, int charIndex, int pos);
+
+/* gameAdvance() carries out every spawn that is due by nowMs. Returns how many. */
+int gameAdvance(gameS* game_p, uint32_t nowMs);
+
+/* gameShoot() takes the character off the grid when it is in play, and scores the hit or the
+ * miss. Characters outside the game score nothing. Returns the points scored. */
+int gameShoot(gameS* game_p, char inputChar);
+
+/* gameValid() checks that the cells, the empty cells and the characters in play agree. */
+bool gameValid(const gameS* game_p);
+
+/* gameInsertScore() puts score in the list of the best numScores scores where it belongs, when it
+ * is among the best maxScores. Returns the entry, with an empty name, or NULL. */
+scoreS* gameInsertScore(int score, scoreS* scores_p, int* numScores_p, int maxScores);
+
+#endif
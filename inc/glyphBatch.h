@@ -0,0 +1,43 @@
+#ifndef GLYPH_BATCH_H
+#define GLYPH_BATCH_H
+
+#include <SDL.h>
+#include <stdbool.h>
+
+/* Where each glyph of a text or grid goes on screen, computed once and reused every frame. */
+typedef struct glyphLayoutS
+{
+  int numGlyphs;
+  SDL_FRect* rects_p;
+} glyphLayoutS;
+
+/* glyphBatchInit() prepares batching of glyphs from fontTexture_p, a sheet of 16 glyphs per
+ * row where every glyph is glyphWidth x glyphHeight pixels. */
+bool glyphBatchInit(SDL_Renderer* renderer_p, SDL_Texture* fontTexture_p, int glyphWidth, int glyphHeight);
+
+/* glyphBatchDestroy() frees the batch buffers. */
+void glyphBatchDestroy(void);
+
+/* glyphBatchAdd() queues one glyph to be drawn at dest_p. */
+void glyphBatchAdd(char glyph, const SDL_FRect* dest_p);
+
+/* glyphBatchAddLayout() queues text[i] at the i:th rectangle of layout_p, for the first
+ * numChars characters or as many as the layout has room for. */
+void glyphBatchAddLayout(const glyphLayoutS* layout_p, const char* text, int numChars);
+
+/* glyphBatchAddLine() queues text on one line, glyph i starting at x + i * glyphWidth. */
+void glyphBatchAddLine(const char* text, int numChars, float x, float y, float glyphWidth, float glyphHeight);
+
+/* glyphBatchFlush() draws all queued glyphs with one SDL_RenderGeometry call and empties the batch. */
+void glyphBatchFlush(void);
+
+/* glyphBatchClear() empties the batch without drawing it. */
+void glyphBatchClear(void);
+
+/* glyphLayoutCreate() allocates room for numGlyphs rectangles, filled in by the caller. */
+bool glyphLayoutCreate(glyphLayoutS* layout_p, int numGlyphs);
+
+/* glyphLayoutDestroy() frees the rectangles of the layout. */
+void glyphLayoutDestroy(glyphLayoutS* layout_p);
+
+#endif
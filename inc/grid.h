@@ -0,0 +1,38 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdbool.h>
+
+/*
+ * The playing field. Cells are written by the game on the main thread, and read by the renderer
+ * and the spectator thread. Writes are published through a sequence lock, so readers get a
+ * consistent copy of all cells without ever waiting for a writer or taking a mutex.
+ * Cell (x, y) is column x, row y and lives at index y * columns + x.
+ */
+
+/* gridInit() allocates the grid and fills it with emptyCell. */
+bool gridInit(int columns, int rows, char emptyCell);
+
+/* gridDestroy() frees the grid. */
+void gridDestroy(void);
+
+/* gridSet() writes one cell. Safe to call from any thread. */
+void gridSet(int index, char cell);
+
+/* gridFill() writes all cells. Safe to call from any thread. */
+void gridFill(char cell);
+
+/* gridSnapshot() copies all cells into snapshot_p if they changed since the copy that had
+ * *version_p, and updates *version_p. Returns false when nothing changed. Never blocks.
+ * Start with *version_p set to GRID_NO_VERSION. */
+#define GRID_NO_VERSION (-1)
+bool gridSnapshot(char* snapshot_p, int* version_p);
+
+/* gridNumCells() returns columns * rows. */
+int gridNumCells(void);
+
+/* gridColumns() and gridRows() return the size given to gridInit(). */
+int gridColumns(void);
+int gridRows(void);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef HUD_CACHE_H
+#define HUD_CACHE_H
+
+#include <SDL.h>
+#include <stdbool.h>
+
+#define HUD_LINE_SIZE 100
+
+/* One line of HUD text, kept rendered in a texture until its text changes. */
+typedef struct hudLineS
+{
+  char text[HUD_LINE_SIZE];
+  int numChars;
+  int capacity; // Characters the texture has room for.
+  int charWidth;
+  int charHeight;
+  SDL_Texture* texture_p;
+} hudLineS;
+
+/* hudCacheInit() sets the renderer that HUD lines are rendered with. The glyph batch must be
+ * initialized as HUD lines are rendered through it. */
+void hudCacheInit(SDL_Renderer* renderer_p);
+
+/* hudLineInit() makes an empty line with glyphs of charWidth x charHeight pixels. */
+void hudLineInit(hudLineS* line_p, int charWidth, int charHeight);
+
+/* hudLineDraw() draws text with its first glyph at x, y. The glyphs are only rendered again when
+ * text differs from what was drawn last time, otherwise this is a single copy. */
+void hudLineDraw(hudLineS* line_p, const char* text, int x, int y);
+
+/* hudLineDestroy() frees the texture of the line. */
+void hudLineDestroy(hudLineS* line_p);
+
+#endif
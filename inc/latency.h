@@ -0,0 +1,53 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Keystroke to photon latency: how long it takes from a key press until the frame that shows its
+ * result is presented. Every key is stamped as it goes through the game, from the SDL event
+ * timestamp to the return of SDL_RenderPresent(), and each span between two stamps is counted in
+ * a histogram of its own.
+ *
+ * The stamps are taken on the main thread only. The histograms are updated with atomic adds, so
+ * any thread may read percentiles while keys are counted, without a lock.
+ */
+
+/* The spans measured for every key, each ends where the next starts. */
+typedef enum latencySpanE
+{
+  LATENCY_QUEUE,      // From the SDL event timestamp, in whole ms, until the main loop takes it.
+  LATENCY_INPUT,      // From taking the event until gameShoot() starts.
+  LATENCY_SHOOT,      // gameShoot() itself, taking the character off the grid.
+  LATENCY_FRAME_WAIT, // Until render() starts on the next frame.
+  LATENCY_RENDER,     // From render() starting until SDL_RenderPresent() returns.
+  LATENCY_TOTAL,      // From the SDL event timestamp until SDL_RenderPresent() returns.
+  LATENCY_NUM_SPANS
+} latencySpanE;
+
+/* latencyKeyEvent() stamps a key event taken from the queue, timestamp is event.key.timestamp. */
+void latencyKeyEvent(uint32_t timestamp);
+
+/* latencyShootBegin() and latencyShootEnd() stamp the last key event around gameShoot(). Keys that
+ * never get here, like the ones that are not characters, are not counted. */
+void latencyShootBegin(void);
+void latencyShootEnd(void);
+
+/* latencyRenderBegin() and latencyPresented() stamp a frame around render(). Every key shot
+ * before the frame started is counted when it has been presented. */
+void latencyRenderBegin(void);
+void latencyPresented(void);
+
+/* latencyCount() returns how many keys have been counted. */
+uint64_t latencyCount(void);
+
+/* latencyPercentileUs() returns the latency, in microseconds, that the fraction of the keys
+ * counted for the span stayed within, 0 before any key is counted. Rounded up to the bucket of
+ * the histogram, within 1/16 of the value. */
+uint32_t latencyPercentileUs(latencySpanE span, double fraction);
+
+/* latencyPrint() prints the percentiles of every span. */
+void latencyPrint(void);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef LEAVES_H
+#define LEAVES_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * The leaves blowing around in the wind, as a particle system. Every property of a leaf has its
+ * own array, and the live leaves are kept packed at the front, so a step only touches live leaves
+ * and runs several of them at once with SIMD.
+ */
+
+#define LEAF_NUM_STATES 4 // State 0 is not drawn, states 1 to 3 are leaf colours.
+
+typedef struct leavesS
+{
+  int capacity;
+  int count;
+  int32_t* x_p;
+  int32_t* y_p;
+  int32_t* state_p;
+  int32_t* mode_p;      // In the air, in a loop or on the ground.
+  int32_t* lifetime_p;  // Steps left on the ground.
+  int32_t* loopType_p;
+  int32_t* loopIndex_p;
+  uint32_t* random_p;   // Random number generator of the leaf.
+  SDL_Rect* rects_p;    // Where the leaves are drawn, grouped by state.
+  int stateStart[LEAF_NUM_STATES + 1];
+  bool rectsValid;
+} leavesS;
+
+/* leavesInit() allocates room for capacity leaves and sets up the loop paths. */
+bool leavesInit(leavesS* leaves_p, int capacity);
+
+/* leavesDestroy() frees the leaves. */
+void leavesDestroy(leavesS* leaves_p);
+
+/* leavesSpawn() adds a leaf in the air. Returns false when there is no room for it. */
+bool leavesSpawn(leavesS* leaves_p, int x, int y, int state, uint32_t seed);
+
+/* leavesStep() moves all leaves one background tick. A gust sends some leaves into loops.
+ * Leaves fall until they pass groundY, lie there for a while, and go away when they leave the
+ * window on the left or their time on the ground is up. Many leaves are split over the worker
+ * pool. */
+void leavesStep(leavesS* leaves_p, int windSpeed, bool gust, int groundY);
+
+/* leavesRects() returns the size x size squares of the leaves in state, and their number in
+ * *count_p. They are only recomputed after the leaves changed. */
+const SDL_Rect* leavesRects(leavesS* leaves_p, int state, int size, int* count_p);
+
+#endif
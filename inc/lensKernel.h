@@ -0,0 +1,18 @@
+#ifndef LENS_KERNEL_H
+#define LENS_KERNEL_H
+
+#include <stdint.h>
+
+/* lensKernelInit() picks the fastest kernel the CPU supports.
+ * lensAddSpan() falls back to the scalar kernel until it has been called. */
+void lensKernelInit(void);
+
+#define LENS_FLAT_COLOR 0x00808080u // Grey, where nothing has bumped the lens yet.
+
+/* lensAddSpan() adds amount to count packed SDL_PIXELFORMAT_ABGR8888 pixels. The sum carries
+ * from red into green and blue, like adding to a 24 bit integer. Alpha follows the height above
+ * LENS_FLAT_COLOR: half its low byte, so the flat lens is transparent and every bump pixel rises
+ * to half opaque and back to clear as bumps pile up, without ever covering the scene. */
+void lensAddSpan(uint32_t* pixels_p, int count, uint32_t amount);
+
+#endif
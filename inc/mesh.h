@@ -0,0 +1,63 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fixedTrig.h>
+
+/*
+ * A polygon mesh drawn in the background. The vertices are transformed once per frame from the
+ * stored orientation, faces turned away from the camera are culled, the rest are depth sorted
+ * back to front with a radix sort and drawn with a single SDL_RenderGeometry() call, fills and
+ * outlines interleaved so nearer faces cover the outlines behind them.
+ */
+
+#define MESH_FILL 1     // Faces are filled, shaded by how much they face the camera.
+#define MESH_OUTLINE 2  // Face edges are drawn as one pixel wide lines.
+
+/* Where the mesh is seen from. The camera is at the origin looking down negative z. */
+typedef struct meshViewS
+{
+  float focalLength; // Screen pixels per unit of x / z.
+  float centerX;     // Where the view axis hits the screen.
+  float centerY;
+  float distance;    // z of the centre of the mesh, negative.
+  float scale;
+  int flags;         // MESH_FILL and MESH_OUTLINE.
+  SDL_Color fill;
+  SDL_Color outline;
+} meshViewS;
+
+typedef struct meshS
+{
+  int numVertices;
+  float* positions_p;    // x, y, z, 1 of every vertex.
+  float* view_p;         // The positions transformed by the last meshDraw(), same layout.
+  SDL_FPoint* screen_p;  // And projected onto the screen.
+  int numFaces;
+  int* faceStart_p;      // Face f uses faceIndices_p[faceStart_p[f]] up to faceStart_p[f + 1].
+  int* faceIndices_p;
+  fixedAngleT orientation[3]; // Rotation around x, y and z, as angles so that it never drifts.
+  // Per frame buffers, allocated for the worst case when the mesh is loaded.
+  uint32_t* keys_p;
+  uint32_t* keysTemp_p;
+  int* order_p;
+  int* orderTemp_p;
+  uint8_t* shade_p;      // Brightness of every face drawn, 0 to 255.
+  SDL_Vertex* vertices_p;
+  int* indices_p;
+} meshS;
+
+/* meshLoadObj() reads the v and f lines of a Wavefront OBJ file, everything else is skipped.
+ * Faces need 3 or more vertices and are kept as polygons, wound counter clockwise when seen
+ * from the front. */
+bool meshLoadObj(meshS* mesh_p, const char* path_p);
+
+/* meshDestroy() frees the mesh. */
+void meshDestroy(meshS* mesh_p);
+
+/* meshDraw() transforms, culls, sorts and draws the mesh as seen from view_p. */
+void meshDraw(meshS* mesh_p, SDL_Renderer* renderer_p, const meshViewS* view_p);
+
+#endif
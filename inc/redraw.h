@@ -0,0 +1,22 @@
+#ifndef REDRAW_H
+#define REDRAW_H
+
+#include <SDL.h>
+#include <stdbool.h>
+
+/* redrawInit() sets the highest number of frames drawn per second. 0 means no cap. */
+void redrawInit(int maxFps);
+
+/* redrawRequest() marks the screen as changed so the next frame gets drawn.
+ * Safe to call from any thread. */
+void redrawRequest(void);
+
+/* redrawWaitEvent() sleeps until an event arrives or the next frame is due, but no longer than
+ * maxWaitMs unless that is negative. With nothing requested and nothing animating it sleeps until
+ * the next event. Returns true when event_p was filled in. */
+bool redrawWaitEvent(SDL_Event* event_p, bool animating, int maxWaitMs);
+
+/* redrawBegin() returns true when a frame should be drawn now and clears the request. */
+bool redrawBegin(bool animating);
+
+#endif
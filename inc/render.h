@@ -1,23 +1,102 @@
 #ifndef RENDER_H
 #define RENDER_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <score.h>
 
+/* The draw passes of render(), in the order they are drawn. */
+typedef enum renderPassE
+{
+  RENDER_PASS_BACKGROUND, // Keeps the static passes below in cached layers, see render().
+  RENDER_PASS_SKY,
+  RENDER_PASS_GROUND,
+  RENDER_PASS_CLOUDS,
+  RENDER_PASS_LEAVES,
+  RENDER_PASS_STRING,
+  RENDER_PASS_TREE,
+  RENDER_PASS_LENS,
+  RENDER_PASS_MESH,
+  RENDER_PASS_GRID,
+  RENDER_PASS_GLYPHS, // Draws the glyphs queued by the grid pass.
+  RENDER_PASS_SCORE,
+  RENDER_NUM_PASSES
+} renderPassE;
+
+#define RENDER_PASS_BIT(pass) (1u << (pass))
+#define RENDER_ALL_PASSES (RENDER_PASS_BIT(RENDER_NUM_PASSES) - 1)
+#define RENDER_DEFAULT_PASSES (RENDER_PASS_BIT(RENDER_PASS_BACKGROUND) | \
+                               RENDER_PASS_BIT(RENDER_PASS_SKY) | \
+                               RENDER_PASS_BIT(RENDER_PASS_GROUND) | \
+                               RENDER_PASS_BIT(RENDER_PASS_STRING) | \
+                               RENDER_PASS_BIT(RENDER_PASS_TREE) | \
+                               RENDER_PASS_BIT(RENDER_PASS_LENS) | \
+                               RENDER_PASS_BIT(RENDER_PASS_MESH) | \
+                               RENDER_PASS_BIT(RENDER_PASS_GRID) | \
+                               RENDER_PASS_BIT(RENDER_PASS_SCORE) | \
+                               RENDER_PASS_BIT(RENDER_PASS_GLYPHS))
+
+/* Passes that change on every frame drawn, not only when the game or the background changes. */
+#define RENDER_ANIMATED_PASSES (RENDER_PASS_BIT(RENDER_PASS_STRING) | \
+                                RENDER_PASS_BIT(RENDER_PASS_LENS) | \
+                                RENDER_PASS_BIT(RENDER_PASS_MESH))
+
+/* renderPassName() returns the name of the pass, as it is shown in benchmarks and traces. */
+const char* renderPassName(renderPassE pass);
+
+/* Called with the duration, in performance counter ticks, of every pass drawn. */
+typedef void (*renderPassTimerT)(renderPassE pass, uint64_t ticks);
+
 /**
  * renderDestroy will free all the allocated resources of the renderer.
  */
 void renderDestroy(void);
 
 /* render() will draw all the objects onto the canvas and flip the screen.
+ * With the background pass enabled the sky and the ground, and the tree too when no pass is
+ * drawn between them, are rendered once per wind state into a layer that is copied every frame.
+ * A layer is only rendered again when the passes in it are switched on or off.
  */
 void render(char* input, int score, int intervalMs);
 
-/* renderInit() will initialize the renderer.
+/* renderInit() will initialize the renderer for a grid of columns x rows characters.
  */
-int renderInit(int gridSize);
+int renderInit(int columns, int rows);
 
 /* renderScoreBoard()
- * will render the end result compared to high score list */
-void renderScoreBoard(scoreS* hiScoreList, int numberOfScores);
+ * will render the end result compared to high score list, and to all games when rank_p is not
+ * NULL. */
+void renderScoreBoard(scoreS* hiScoreList, int numberOfScores, const scoreRankS* rank_p);
+
+/* renderSetPasses() selects the passes render() draws, one RENDER_PASS_BIT() per pass.
+ * RENDER_DEFAULT_PASSES is used until this is called. */
+void renderSetPasses(unsigned int passMask);
+unsigned int renderGetPasses(void);
+
+/* renderIsAnimated() returns true when a pass that changes every frame is enabled. */
+bool renderIsAnimated(void);
+
+/* renderSetPassTimer() installs a callback that times every drawn pass. NULL removes it. */
+void renderSetPassTimer(renderPassTimerT passTimer);
+
+/* renderSetBackgroundTimer() starts or stops the ticks of the background simulation, which
+ * runs on a thread of its own. While they are stopped render() does not move the animation on
+ * either. renderInit() starts them. */
+void renderSetBackgroundTimer(bool running);
+
+/* renderTickBackground() advances the background simulation by one tick and returns when the
+ * result can be drawn. Used to drive the animation deterministically while the timer is stopped. */
+void renderTickBackground(void);
+
+/* renderStepBackgroundFrame() moves the animation of the background one frame on and returns when
+ * the result can be drawn. Used like renderTickBackground(), once before every render(). */
+void renderStepBackgroundFrame(void);
+
+/* renderSetOverlay() shows a line of text under the score, NULL or "" hides it. */
+void renderSetOverlay(const char* text_p);
+
+/* renderStorm() blows numLeaves more leaves into the scene, as far as there is room for them.
+ * Returns how many were added. */
+int renderStorm(int numLeaves);
 
 #endif
@@ -0,0 +1,69 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Recording and playback of a game session: every key handed to the game and every spawn
+ * decision, with the time it happened, in a compact binary file. Playing it back gives the
+ * same game without depending on rand() or on when the timers fire.
+ */
+
+typedef enum replayEventTypeE
+{
+  REPLAY_KEY = 1,
+  REPLAY_SPAWN = 2,
+} replayEventTypeE;
+
+typedef struct replayEventS
+{
+  uint64_t timeUs; // Since the recording started.
+  replayEventTypeE type;
+  union
+  {
+    struct
+    {
+      int32_t sym;
+      uint16_t mod;
+    } key;
+    struct
+    {
+      int charIndex; // -1 when no character was free.
+      int pos;       // -1 when the grid was full.
+    } spawn;
+  };
+} replayEventS;
+
+/* Fixed part of a replay file. */
+typedef struct replayHeaderS
+{
+  uint32_t seed;
+  uint32_t columns;
+  uint32_t rows;
+} replayHeaderS;
+
+/* replayStartRecording() creates the file at path and starts the recording clock. */
+bool replayStartRecording(const char* path, const replayHeaderS* header_p);
+
+/* replayIsRecording() returns true between replayStartRecording() and replayStopRecording(). */
+bool replayIsRecording(void);
+
+/* replayRecordKey() and replayRecordSpawn() append an event stamped with the current time.
+ * They do nothing when not recording and are safe to call from any thread. */
+void replayRecordKey(int32_t sym, uint16_t mod);
+void replayRecordSpawn(int charIndex, int pos);
+
+/* replayStopRecording() flushes and closes the file. */
+void replayStopRecording(void);
+
+/* replayOpen() opens a recording for playback and reads its header. */
+bool replayOpen(const char* path, replayHeaderS* header_p);
+
+/* replayRead() reads the next event. Returns false at the end of the recording. */
+bool replayRead(replayEventS* event_p);
+
+/* replayClose() closes the recording being played back. */
+void replayClose(void);
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef SCORE_H
 #define SCORE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #define MAX_NBR_NAME_CHARS 3
 
 typedef struct scoreS
@@ -9,4 +12,14 @@ typedef struct scoreS
   int score;
 } scoreS;
 
+/* Where a score ranks among every game played before it. */
+typedef struct scoreRankS
+{
+  int score;
+  uint64_t games;   // Games played before, 0 when not known yet.
+  uint64_t above;   // Of those, the games that scored more.
+  bool hasBest;
+  int best;         // The best score played before under the same name.
+} scoreRankS;
+
 #endif
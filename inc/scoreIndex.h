@@ -0,0 +1,48 @@
+#ifndef SCORE_INDEX_H
+#define SCORE_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Counts of all scores ever played, to rank a score among them. The scores are counted in one
+ * bucket per point, SCORE_INDEX_MIN up to SCORE_INDEX_MIN + SCORE_INDEX_BUCKETS - 1, scores
+ * outside go into the first or last bucket. The buckets are a Fenwick tree, so adding a score and
+ * counting the scores above one are both O(log buckets) however many games were played. The best
+ * score of every name is kept in a hash table. Not thread safe.
+ */
+
+#define SCORE_INDEX_MIN (-1024) // A miss costs a point, a game can end below zero.
+#define SCORE_INDEX_BUCKETS 65536 // A power of two.
+
+typedef struct scoreIndexNameS
+{
+  uint32_t key;  // The name packed into 4 bytes, 0 for an empty slot.
+  int best;
+} scoreIndexNameS;
+
+typedef struct scoreIndexS
+{
+  uint32_t* tree_p;    // Fenwick tree over the buckets, entry i sums the i & -i buckets up to i.
+  uint64_t count;
+  scoreIndexNameS* names_p;
+  int nameCapacity;    // A power of two, at most half full.
+  int numNames;
+} scoreIndexS;
+
+/* scoreIndexInit() makes an empty index. */
+bool scoreIndexInit(scoreIndexS* index_p);
+
+/* scoreIndexDestroy() frees the index. */
+void scoreIndexDestroy(scoreIndexS* index_p);
+
+/* scoreIndexAdd() counts one game. Games without a name are only counted. */
+void scoreIndexAdd(scoreIndexS* index_p, const char* name_p, int score);
+
+/* scoreIndexAbove() returns how many games scored more than score. */
+uint64_t scoreIndexAbove(const scoreIndexS* index_p, int score);
+
+/* scoreIndexBest() finds the best score of the name, returns false when it has none. */
+bool scoreIndexBest(const scoreIndexS* index_p, const char* name_p, int* best_p);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef SCORE_STORE_H
+#define SCORE_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <score.h>
+
+/*
+ * The scores of every game played, kept in an append only log that any number of game instances
+ * share. The best SCORE_STORE_TOP scores are loaded once at startup and kept in memory, new
+ * scores go into them at once and are written to the log by a thread of its own, so a game over
+ * never waits for the disk.
+ *
+ * The log is a header and 16 byte records, each with a checksum. Its first sortedRecords records
+ * are sorted best first, the rest are appended in the order the games ended. A record cut short
+ * by a crash is dropped by the next append. When the unsorted tail grows long, or damaged records
+ * are found, the whole log is sorted into a new file that replaces the old one with rename().
+ * Appends and compactions of all instances take turns through flock() on path.lock.
+ *
+ * The writer thread also reads the whole log once, into a scoreIndexS that ranks any score among
+ * all games in O(log n).
+ */
+
+#define SCORE_STORE_TOP 10
+
+/* scoreStoreInit() loads the best scores from the log at path_p and starts the writer thread.
+ * A log that does not exist yet is created, with the scores of the text score board at
+ * legacyPath_p in it when there is one. */
+bool scoreStoreInit(const char* path_p, const char* legacyPath_p);
+
+/* scoreStoreDestroy() writes the scores still pending and stops the writer thread. */
+void scoreStoreDestroy(void);
+
+/* scoreStoreTop() copies up to maxScores of the best scores, best first, and returns how many. */
+int scoreStoreTop(scoreS* scores_p, int maxScores);
+
+/* scoreStoreAdd() adds the score of a game and returns before it is written. Of equal scores the
+ * newest comes first. */
+void scoreStoreAdd(const scoreS* score_p);
+
+/* scoreStoreRank() counts the games played, in games_p, and those that scored more than score,
+ * in above_p. Returns false until the history is read, shortly after startup. */
+bool scoreStoreRank(int score, uint64_t* games_p, uint64_t* above_p);
+
+/* scoreStoreBest() finds the best score ever played under the name. */
+bool scoreStoreBest(const char* name_p, int* best_p);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <stdbool.h>
+#include <eventBus.h>
+
+/*
+ * Live game state for spectators, sent over a Unix domain socket to any number of local
+ * clients. A thread of its own takes a copy of the grid SPECTATOR_HZ times a second, encodes what
+ * changed since the last time once, and fans that out to every client through epoll. The game
+ * loop only sets a few atomics and queues its events.
+ *
+ * Every message is a u32 length, then that many bytes starting with the message type. All
+ * integers are little endian, a varint stores 7 bits per byte, low bits first, with the top bit
+ * set on all but the last.
+ *   SPECTATOR_KEYFRAME: seq (u32), columns (u16), rows (u16), score (i32), interval ms (u32),
+ *                       then columns * rows cells, one byte each.
+ *   SPECTATOR_DELTA:    seq (u32), flags (u8), score (i32) if SPECTATOR_SCORE is set,
+ *                       interval ms (u32) if SPECTATOR_INTERVAL is set,
+ *                       number of cells (varint), then per cell its index minus that of the
+ *                       cell before it, -1 before the first (varint), and the cell (u8),
+ *                       number of events (varint), then per event its busEventTypeE (u8),
+ *                       charIndex + 1 and pos + 1 (varints), 0 for an event without a
+ *                       character or a cell, like the end of the game.
+ * Deltas are numbered one after the other, a keyframe has the seq of the last delta it includes.
+ * A client that sees a gap waits for the next keyframe. Keyframes are sent to new clients, to
+ * clients that fell too far behind, whose queued deltas are dropped, and to everyone every
+ * SPECTATOR_KEYFRAME_MS.
+ */
+
+#define SPECTATOR_HZ 30
+#define SPECTATOR_KEYFRAME_MS 2000
+#define SPECTATOR_KEYFRAME 1
+#define SPECTATOR_DELTA 2
+#define SPECTATOR_SCORE 0x01
+#define SPECTATOR_INTERVAL 0x02
+
+/* spectatorStart() listens on a socket at path_p, replacing a stale one, and starts the thread
+ * serving the clients. Fails when another game listens at path_p. */
+bool spectatorStart(const char* path_p);
+
+/* spectatorStop() disconnects the clients and removes the socket. */
+void spectatorStop(void);
+
+/* spectatorSetScore() publishes the score and the spawn interval. */
+void spectatorSetScore(int score, int intervalMs);
+
+/* spectatorEvent() queues a hit, miss, spawn or game over for the next delta. Only called by
+ * the main thread. */
+void spectatorEvent(const busEventS* event_p);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef STRING_RASTER_H
+#define STRING_RASTER_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Draws the twisting string on the CPU. The string is a row of columns, each a strip of cells
+ * that shows part of the cylinder bitmap, shaded and highlighted by how the cylinder faces the
+ * light. All cells are written into one pixel band, split over the worker pool by columns, and
+ * uploaded to a streaming texture that is drawn with a single copy.
+ */
+
+/* How one column of the string is placed in a frame. */
+typedef struct stringColumnS
+{
+  double offsetY; // Added to the cylinder rows the cells show.
+  double twist;   // 1 shows the cells at full height, 0 squeezes them into the middle.
+} stringColumnS;
+
+/* What the string is made of. The tables have one entry per row of the cylinder. */
+typedef struct stringSetupS
+{
+  int numColumns;
+  int cellSize;       // Width of a column, and the cylinder rows between cells.
+  int cylinderHeight; // Rows of the cylinder, and entries of the tables.
+  int centerY;        // Window row the middle of the cylinder is drawn at.
+  const double* yOverCylinder_p;         // Bitmap row shown at every cylinder row.
+  const char* colorOverCylinder_p;       // Shade at every cylinder row.
+  const char* highlightOverCylinder_p;   // Highlight at every cylinder row.
+  const uint32_t* cylinderPixels_p; // The bitmap the cells show, SDL_PIXELFORMAT_ABGR8888.
+  int bitmapWidth;
+  int bitmapHeight;
+  int bitmapStride;         // Pixels from one bitmap row to the next.
+  int sourceStepX;          // Bitmap columns per window column.
+  int sourceWidth;          // Bitmap area shown by a cell.
+  int sourceHeight;
+  const SDL_Color* highlight_p; // sourceWidth x sourceHeight colours added in the highlight.
+} stringSetupS;
+
+/* stringRasterInit() copies what it needs from the setup and creates the streaming texture. The
+ * cylinder pixels are used where they are, they must stay until stringRasterDestroy(). */
+bool stringRasterInit(SDL_Renderer* renderer_p, const stringSetupS* setup_p);
+
+/* stringRasterDestroy() frees the pixels and the texture. */
+void stringRasterDestroy(void);
+
+/* stringRasterDraw() draws the string with numColumns columns, light shifting the shading by
+ * lightShift cylinder rows. */
+void stringRasterDraw(const stringColumnS* columns_p, int lightShift);
+
+#endif
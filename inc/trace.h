@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Tracing of what every thread does within a frame. TRACE_SCOPE() records the time from where it
+ * stands to the end of the enclosing block as one event, in a ring buffer of the calling thread
+ * that keeps its newest TRACE_BUFFER_EVENTS events. Only the owning thread writes a buffer, so
+ * recording takes no locks. traceWrite() saves the events of all threads in the Chrome trace
+ * format, for chrome://tracing or ui.perfetto.dev.
+ *
+ * The macros compile to nothing unless STORM_TRACE is defined, cmake -DSTORM_TRACE=ON.
+ */
+
+#define TRACE_BUFFER_EVENTS 16384 // A power of two.
+
+#ifdef STORM_TRACE
+
+typedef struct traceScopeS
+{
+  const char* name_p;
+  uint64_t start;
+} traceScopeS;
+
+uint64_t traceNow(void);
+void traceScopeEnd(traceScopeS* scope_p);
+void traceThreadName(const char* name_p);
+
+#define TRACE_JOIN(a, b) a##b
+#define TRACE_NAME(line) TRACE_JOIN(traceScope, line)
+
+/* TRACE_SCOPE() times the rest of the block. name_p must stay valid, a string literal. */
+#define TRACE_SCOPE(name_p) \
+  traceScopeS TRACE_NAME(__LINE__) __attribute__((cleanup(traceScopeEnd))) = {(name_p), traceNow()}
+
+/* TRACE_THREAD_NAME() names the calling thread in the trace. */
+#define TRACE_THREAD_NAME(name_p) traceThreadName(name_p)
+
+#else
+
+#define TRACE_SCOPE(name_p) ((void)0)
+#define TRACE_THREAD_NAME(name_p) ((void)0)
+
+#endif
+
+/* traceWrite() saves the recorded events as Chrome trace JSON. Threads may go on recording
+ * meanwhile, events they overwrite while it copies are left out. Returns false when it could not
+ * write the file, or when tracing is not built in. */
+bool traceWrite(const char* path_p);
+
+#endif
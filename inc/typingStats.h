@@ -0,0 +1,45 @@
+#ifndef TYPING_STATS_H
+#define TYPING_STATS_H
+
+#include <stdbool.h>
+#include <freeSet.h>
+
+/*
+ * How the player does on every character of a session: how often it was spawned, hit and typed
+ * while not in play, and how long it took to hit. From the same numbers every character gets a
+ * spawn weight, higher for the characters that are slow to hit or often mistyped, so that
+ * spawns can favor the player's weak keys.
+ *
+ * Spawns are counted as the game makes them and hits and misses as keys are typed, all on the
+ * main thread, which also picks the spawns. Not thread safe. A spawn must be counted before the
+ * character can be hit.
+ */
+
+#define TYPING_STATS_WEIGHT_ONE 16 // The weight of a character the player does average on.
+#define TYPING_STATS_WEIGHT_MAX 64 // The weakest keys are spawned up to 4 times as often.
+
+/* typingStatsInit() starts a session of numChars characters, firstChar being the first. */
+bool typingStatsInit(int firstChar, int numChars);
+
+/* typingStatsDestroy() frees the statistics. */
+void typingStatsDestroy(void);
+
+/* typingStatsSpawn() counts a spawn of the character, and when it was spawned. */
+void typingStatsSpawn(int charIndex);
+
+/* typingStatsHit() counts a hit of the character in play, and updates its weight. */
+void typingStatsHit(int charIndex);
+
+/* typingStatsMiss() counts the character typed while not in play, and updates its weight. */
+void typingStatsMiss(int charIndex);
+
+/* typingStatsPick() draws a member of the set, the characters free to be spawned, with a
+ * probability proportional to its weight. Rejection sampling: a uniform pick is kept with the
+ * probability weight / TYPING_STATS_WEIGHT_MAX, so the pick takes a bounded number of tries on
+ * average however many characters there are. Returns -1 when the set is empty. */
+int typingStatsPick(const freeSetS* set_p);
+
+/* typingStatsSave() writes the statistics of the session to a file at path_p. */
+bool typingStatsSave(const char* path_p);
+
+#endif
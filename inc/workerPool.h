@@ -0,0 +1,28 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+
+/*
+ * A few threads that share the tasks of the jobs they are given. The thread that runs a job
+ * works on its tasks too and returns when all of them are done. Jobs from different threads run
+ * side by side, none waits for another to finish, only for the threads that helped with it.
+ */
+
+/* Runs task number task of a job. */
+typedef void (*workerTaskT)(void* context_p, int task);
+
+/* workerPoolInit() starts numThreads threads. With none the jobs run on the calling thread. */
+bool workerPoolInit(int numThreads);
+
+/* workerPoolDestroy() stops the threads. */
+void workerPoolDestroy(void);
+
+/* workerPoolSize() returns how many threads work on a job, the calling one included. */
+int workerPoolSize(void);
+
+/* workerPoolRun() runs task_p for every task from 0 to numTasks - 1, spread over the threads,
+ * and returns when all are done. */
+void workerPoolRun(workerTaskT task_p, void* context_p, int numTasks);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fixedTrig.h>
+#include <leaves.h>
+#include <stringRaster.h>
+
+/*
+ * The simulation of the background: wind, clouds, leaves, the string, the lens and the mesh. It runs on a
+ * thread of its own, with the leaves split over the worker pool, and publishes what the renderer
+ * needs as snapshots. There are two of them, the renderer reads the newest while the simulation
+ * writes the other, so neither side waits for the other while a frame is drawn.
+ */
+
+#define WORLD_MAX_CLOUDS 20
+#define WORLD_LENS_BUMPS 64 // The newest bumps added to the lens, more than a frame ever adds.
+
+typedef struct worldConfigS
+{
+  int width;
+  int height;
+  int groundY;          // Where the ground starts, leaves fall until they pass it.
+  int treeX;            // Where new leaves fall from the tree.
+  int treeY;
+  int maxLeaves;
+  int leafSize;
+  int stringColumns;    // The string is drawn in columns of cellSize pixels.
+  int cellSize;
+  int stringHeight;     // Pixels the string moves per turn of twist.
+  int lensBumpSize;
+  int tickMs;           // Between steps of the wind, clouds and leaves.
+  uint32_t seed;
+} worldConfigS;
+
+typedef struct worldCloudS
+{
+  int x;
+  int y;
+  int height;
+  int width;
+  int spriteY;
+  int speed;
+} worldCloudS;
+
+/* Everything the renderer draws from, as it was when the snapshot was published. */
+typedef struct worldSnapshotS
+{
+  int windSpeed;
+  int numClouds;
+  worldCloudS clouds[WORLD_MAX_CLOUDS];
+  SDL_Rect* leafRects_p;   // The leaves, grouped by state.
+  int leafStart[LEAF_NUM_STATES + 1]; // State s is leafRects_p[leafStart[s]] up to leafStart[s + 1].
+  uint32_t leavesVersion;  // Only copied again when the leaves changed.
+  stringColumnS* columns_p;
+  double lightAngle;       // Of the highlight on the string, in radians.
+  uint64_t numLensBumps;   // Added since the start, bump n is lensBumps[n % WORLD_LENS_BUMPS].
+  SDL_Rect lensBumps[WORLD_LENS_BUMPS];
+  fixedAngleT meshOrientation[3]; // Rotation of the mesh around x, y and z.
+} worldSnapshotS;
+
+/* worldInit() sets up the simulation, publishes the first snapshot and starts the thread,
+ * with the ticks of the wind, clouds and leaves stopped. */
+bool worldInit(const worldConfigS* config_p);
+
+/* worldDestroy() stops the thread and frees the world. */
+void worldDestroy(void);
+
+/* worldAcquire() returns the newest snapshot, which stays unchanged until worldRelease().
+ * Only one snapshot can be held at a time, and no other world function may be called while
+ * holding it. */
+const worldSnapshotS* worldAcquire(void);
+void worldRelease(void);
+
+/* worldRequestFrame() asks for the string, the lens and the mesh to move one frame on. Requests
+ * made before the simulation gets to them make a single frame. */
+void worldRequestFrame(void);
+
+/* worldStepFrame() moves the string, the lens and the mesh exactly one frame on and returns when
+ * it is published. */
+void worldStepFrame(void);
+
+/* worldSetTicking() starts or stops ticking on the world's own clock. */
+void worldSetTicking(bool running);
+
+/* worldTick() runs one tick and returns when it is published. */
+void worldTick(void);
+
+/* worldStorm() blows numLeaves more leaves in, as far as there is room for them. Returns how
+ * many were added. */
+int worldStorm(int numLeaves);
+
+#endif
@@ -0,0 +1,135 @@
+#include <SDL.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atlas.h>
+
+static const uint8_t* file_p = NULL;
+static size_t fileSize = 0;
+static const atlasHeaderS* header_p = NULL;
+static const atlasPageS* pages_p = NULL;
+static const atlasImageS* images_p = NULL;
+
+/* atlasValid() checks the header and that every page and image lies inside the file. */
+static bool atlasValid(void)
+{
+  if (fileSize < sizeof(atlasHeaderS)) return false;
+  if (header_p->magic != ATLAS_MAGIC || header_p->version != ATLAS_VERSION) return false;
+  if (header_p->size != fileSize) return false;
+  uint64_t tables = sizeof(atlasHeaderS) + (uint64_t)header_p->numPages * sizeof(atlasPageS) +
+                    (uint64_t)header_p->numImages * sizeof(atlasImageS);
+  if (tables > fileSize) return false;
+  pages_p = (const atlasPageS*)(header_p + 1);
+  images_p = (const atlasImageS*)(pages_p + header_p->numPages);
+  for (uint32_t i = 0; i < header_p->numPages; i++)
+  {
+    const atlasPageS* page_p = &pages_p[i];
+    if (page_p->format != ATLAS_PIXEL_FORMAT || page_p->offset % ATLAS_ALIGN != 0) return false;
+    if (page_p->pitch < page_p->width * sizeof(uint32_t) || page_p->pitch % sizeof(uint32_t) != 0) return false;
+    if (page_p->offset + (uint64_t)page_p->pitch * page_p->height > fileSize) return false;
+  }
+  for (uint32_t i = 0; i < header_p->numImages; i++)
+  {
+    const atlasImageS* image_p = &images_p[i];
+    if (image_p->page >= header_p->numPages) return false;
+    const atlasPageS* page_p = &pages_p[image_p->page];
+    if ((uint64_t)image_p->x + image_p->width > page_p->width) return false;
+    if ((uint64_t)image_p->y + image_p->height > page_p->height) return false;
+    if (memchr(image_p->name, '\0', ATLAS_NAME_SIZE) == NULL) return false;
+  }
+  return true;
+}
+
+bool atlasOpen(const char* path_p)
+{
+  int fd = open(path_p, O_RDONLY);
+  if (fd < 0)
+  {
+    printf("Could not open atlas %s.\n", path_p);
+    return false;
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size <= 0)
+  {
+    printf("Could not read atlas %s.\n", path_p);
+    close(fd);
+    return false;
+  }
+  fileSize = (size_t)status.st_size;
+  void* mapped_p = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped_p == MAP_FAILED)
+  {
+    printf("Could not map atlas %s.\n", path_p);
+    fileSize = 0;
+    return false;
+  }
+  file_p = mapped_p;
+  header_p = (const atlasHeaderS*)file_p;
+  if (!atlasValid())
+  {
+    printf("Atlas %s is damaged or from another version, rebuild it.\n", path_p);
+    atlasClose();
+    return false;
+  }
+  return true;
+}
+
+void atlasClose(void)
+{
+  if (file_p != NULL) munmap((void*)file_p, fileSize);
+  file_p = NULL;
+  fileSize = 0;
+  header_p = NULL;
+  pages_p = NULL;
+  images_p = NULL;
+}
+
+const atlasImageS* atlasFind(const char* name_p)
+{
+  if (header_p == NULL) return NULL;
+  for (uint32_t i = 0; i < header_p->numImages; i++)
+  {
+    if (strncmp(images_p[i].name, name_p, ATLAS_NAME_SIZE) == 0) return &images_p[i];
+  }
+  printf("Atlas has no image %s.\n", name_p);
+  return NULL;
+}
+
+const uint32_t* atlasPixels(const atlasImageS* image_p, int* stride_p)
+{
+  const atlasPageS* page_p = &pages_p[image_p->page];
+  *stride_p = page_p->pitch / sizeof(uint32_t);
+  return (const uint32_t*)(file_p + page_p->offset) + image_p->y * *stride_p + image_p->x;
+}
+
+uint32_t atlasPixel(const atlasImageS* image_p, int x, int y)
+{
+  if (x < 0 || y < 0 || x >= (int)image_p->width || y >= (int)image_p->height) return 0;
+  int stride;
+  const uint32_t* pixels_p = atlasPixels(image_p, &stride);
+  return pixels_p[y * stride + x];
+}
+
+SDL_Texture* atlasCreateTexture(SDL_Renderer* renderer_p, const atlasImageS* image_p)
+{
+  const atlasPageS* page_p = &pages_p[image_p->page];
+  SDL_Texture* texture_p = SDL_CreateTexture(renderer_p, page_p->format, SDL_TEXTUREACCESS_STATIC,
+                                             page_p->width, page_p->height);
+  if (texture_p == NULL)
+  {
+    printf("Error when creating texture: %s\n", SDL_GetError());
+    return NULL;
+  }
+  if (SDL_UpdateTexture(texture_p, NULL, file_p + page_p->offset, page_p->pitch) != 0)
+  {
+    printf("Error when updating texture: %s\n", SDL_GetError());
+    SDL_DestroyTexture(texture_p);
+    return NULL;
+  }
+  SDL_SetTextureBlendMode(texture_p, SDL_BLENDMODE_BLEND);
+  return texture_p;
+}
@@ -0,0 +1,105 @@
+#include <string.h>
+#include <bot.h>
+
+static void botSpawned(void* context_p, int charIndex, int pos);
+
+static const gameHooksS hooks = {botSpawned, NULL, NULL, NULL, NULL};
+
+/* nextRandom() is a xorshift generator of the bot's own. */
+static uint32_t nextRandom(botS* bot_p)
+{
+  bot_p->random ^= bot_p->random << 13;
+  bot_p->random ^= bot_p->random >> 17;
+  bot_p->random ^= bot_p->random << 5;
+  return bot_p->random;
+}
+
+void botInit(botS* bot_p, const botProfileS* profile_p, uint32_t seed)
+{
+  memset(bot_p, 0, sizeof(*bot_p));
+  bot_p->profile = *profile_p;
+  if (bot_p->profile.jitterMs > bot_p->profile.reactionMs) bot_p->profile.jitterMs = bot_p->profile.reactionMs;
+  // Keys take time, a bot that only types wrong ones still lets the clock move on.
+  if (bot_p->profile.keyMs < 1) bot_p->profile.keyMs = 1;
+  bot_p->random = seed != 0 ? seed : 1; // xorshift never leaves 0.
+}
+
+void botReset(botS* bot_p)
+{
+  bot_p->head = 0;
+  bot_p->count = 0;
+  bot_p->nowMs = 0;
+  bot_p->nextKeyMs = 0;
+}
+
+const gameHooksS* botHooks(void)
+{
+  return &hooks;
+}
+
+/*
+ * botSpawned() queues a spawn to be typed once the bot has reacted to it. The spawn happened at
+ * the bot's clock, which the game's spawns never run ahead of. The queue is kept in the order the
+ * spawns are noticed, a quick reaction overtakes slower ones to earlier spawns.
+ */
+static void botSpawned(void* context_p, int charIndex, int pos)
+{
+  botS* bot_p = context_p;
+  // At most every character is in play once.
+  if (bot_p->count == GAME_NUM_CHARS) return;
+  const botProfileS* profile_p = &bot_p->profile;
+  int reactionMs = profile_p->reactionMs;
+  if (profile_p->jitterMs > 0)
+  {
+    reactionMs += (int)(nextRandom(bot_p) % (2 * profile_p->jitterMs + 1)) - profile_p->jitterMs;
+  }
+  uint32_t dueMs = bot_p->nowMs + reactionMs;
+  // Insertion from the tail, only the spawns noticed after this one move.
+  int place = bot_p->count;
+  while (place > 0)
+  {
+    int before = (bot_p->head + place - 1) % GAME_NUM_CHARS;
+    if ((int32_t)(bot_p->dueMs[before] - dueMs) <= 0) break;
+    int at = (bot_p->head + place) % GAME_NUM_CHARS;
+    bot_p->queue[at] = bot_p->queue[before];
+    bot_p->dueMs[at] = bot_p->dueMs[before];
+    place--;
+  }
+  int at = (bot_p->head + place) % GAME_NUM_CHARS;
+  bot_p->queue[at] = charIndex;
+  bot_p->dueMs[at] = dueMs;
+  bot_p->count++;
+}
+
+int botMsUntilKey(const botS* bot_p, uint32_t nowMs)
+{
+  if (bot_p->count == 0) return -1;
+  uint32_t dueMs = bot_p->dueMs[bot_p->head];
+  if ((int32_t)(bot_p->nextKeyMs - dueMs) > 0) dueMs = bot_p->nextKeyMs;
+  int32_t untilMs = (int32_t)(dueMs - nowMs);
+  return untilMs > 0 ? untilMs : 0;
+}
+
+void botStep(botS* bot_p, gameS* game_p, uint32_t nowMs)
+{
+  bot_p->nowMs = nowMs;
+  while (botMsUntilKey(bot_p, nowMs) == 0)
+  {
+    int charIndex = bot_p->queue[bot_p->head];
+    bot_p->nextKeyMs = nowMs + bot_p->profile.keyMs;
+    bot_p->keys++;
+    if ((int)(nextRandom(bot_p) % 100) < bot_p->profile.errorPercent)
+    {
+      // Any other key, the right one is typed next.
+      int wrongIndex = (charIndex + 1 + nextRandom(bot_p) % (GAME_NUM_CHARS - 1)) % GAME_NUM_CHARS;
+      bot_p->errors++;
+      gameShoot(game_p, (char)(wrongIndex + GAME_START_CHAR));
+    }
+    else
+    {
+      bot_p->head = (bot_p->head + 1) % GAME_NUM_CHARS;
+      bot_p->count--;
+      gameShoot(game_p, (char)(charIndex + GAME_START_CHAR));
+    }
+  }
+}
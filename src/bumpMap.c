@@ -0,0 +1,118 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <bumpMap.h>
+#include <lensKernel.h>
+
+static void markDirty(bumpMapS* map_p, SDL_Rect rect);
+
+bool bumpMapInit(bumpMapS* map_p, int width, int height, uint32_t color)
+{
+  map_p->width = width;
+  map_p->height = height;
+  map_p->numDirtyRects = 0;
+  map_p->pixels_p = malloc((size_t)width * height * sizeof(uint32_t));
+  if (map_p->pixels_p == NULL)
+  {
+    printf("Could not allocate bump map.\n");
+    return false;
+  }
+
+  for (int i = 0; i < width * height; i++)
+  {
+    map_p->pixels_p[i] = color;
+  }
+  SDL_Rect all = {0, 0, width, height};
+  markDirty(map_p, all);
+  return true;
+}
+
+void bumpMapDestroy(bumpMapS* map_p)
+{
+  free(map_p->pixels_p);
+  map_p->pixels_p = NULL;
+  map_p->numDirtyRects = 0;
+}
+
+void bumpMapAdd(bumpMapS* map_p, const SDL_Rect* rect_p, uint32_t amount)
+{
+  SDL_Rect bounds = {0, 0, map_p->width, map_p->height};
+  SDL_Rect rect;
+  if (!SDL_IntersectRect(rect_p, &bounds, &rect)) return;
+
+  for (int y = rect.y; y < rect.y + rect.h; y++)
+  {
+    lensAddSpan(&map_p->pixels_p[y * map_p->width + rect.x], rect.w, amount);
+  }
+  markDirty(map_p, rect);
+}
+
+void bumpMapUpload(bumpMapS* map_p, SDL_Texture* texture_p)
+{
+  for (int i = 0; i < map_p->numDirtyRects; i++)
+  {
+    SDL_Rect* rect_p = &map_p->dirtyRects[i];
+    const uint32_t* source_p = &map_p->pixels_p[rect_p->y * map_p->width + rect_p->x];
+    if (SDL_UpdateTexture(texture_p, rect_p, source_p, map_p->width * sizeof(uint32_t)))
+    {
+      printf("Error when updating texture: %s\n", SDL_GetError());
+    }
+  }
+  map_p->numDirtyRects = 0;
+}
+
+/* Returns how much the area of the bounding box of a and b exceeds the area of a. */
+static int unionGrowth(const SDL_Rect* a_p, const SDL_Rect* b_p)
+{
+  SDL_Rect both;
+  SDL_UnionRect(a_p, b_p, &both);
+  return both.w * both.h - a_p->w * a_p->h;
+}
+
+/*
+ * markDirty() adds rect to the dirty rectangles. Overlapping rectangles are merged so that no
+ * pixel is uploaded twice. When the list is full the rectangle is merged with the one whose
+ * bounding box grows the least.
+ */
+static void markDirty(bumpMapS* map_p, SDL_Rect rect)
+{
+  int i = 0;
+  while (i < map_p->numDirtyRects)
+  {
+    if (SDL_HasIntersection(&map_p->dirtyRects[i], &rect))
+    {
+      // Merge and start over, the bigger rectangle may now overlap earlier ones.
+      SDL_UnionRect(&map_p->dirtyRects[i], &rect, &rect);
+      map_p->dirtyRects[i] = map_p->dirtyRects[map_p->numDirtyRects - 1];
+      map_p->numDirtyRects--;
+      i = 0;
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  if (map_p->numDirtyRects < BUMP_MAP_MAX_DIRTY_RECTS)
+  {
+    map_p->dirtyRects[map_p->numDirtyRects++] = rect;
+    return;
+  }
+
+  int best = 0;
+  int bestGrowth = unionGrowth(&map_p->dirtyRects[0], &rect);
+  for (i = 1; i < map_p->numDirtyRects; i++)
+  {
+    int growth = unionGrowth(&map_p->dirtyRects[i], &rect);
+    if (growth < bestGrowth)
+    {
+      best = i;
+      bestGrowth = growth;
+    }
+  }
+  // The merged rectangle can overlap others, so insert it again from scratch.
+  SDL_UnionRect(&map_p->dirtyRects[best], &rect, &rect);
+  map_p->dirtyRects[best] = map_p->dirtyRects[map_p->numDirtyRects - 1];
+  map_p->numDirtyRects--;
+  markDirty(map_p, rect);
+}
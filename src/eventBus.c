@@ -0,0 +1,118 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <eventBus.h>
+
+#define BUS_MASK (EVENT_BUS_CAPACITY - 1)
+
+typedef struct busSlotS
+{
+  // Equal to the position it is published at when free, one more once written. Taking the
+  // event moves it a lap ahead.
+  SDL_atomic_t sequence;
+  busEventS event;
+} busSlotS;
+
+static busSlotS slots[EVENT_BUS_CAPACITY];
+static SDL_atomic_t tail;         // Where the next event is published.
+static SDL_atomic_t head;         // Where the main thread takes the next event, only it moves it.
+static SDL_atomic_t wakePending;  // A wakeup is pushed and the main thread has not polled since.
+static SDL_atomic_t published;
+static SDL_atomic_t dropped;
+static SDL_atomic_t maxDepth;
+static SDL_atomic_t wakeups;
+
+static void noteDepth(int depth)
+{
+  int seen = SDL_AtomicGet(&maxDepth);
+  while (seen < depth && !SDL_AtomicCAS(&maxDepth, seen, depth))
+  {
+    seen = SDL_AtomicGet(&maxDepth);
+  }
+}
+
+/* wakeMainThread() pushes one SDL event, unless one is already on its way. */
+static void wakeMainThread(void)
+{
+  if (!SDL_AtomicCAS(&wakePending, 0, 1)) return;
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = SDL_USEREVENT;
+  event.user.code = EVENT_BUS_WAKEUP;
+  SDL_PushEvent(&event);
+  SDL_AtomicAdd(&wakeups, 1);
+}
+
+void eventBusInit(void)
+{
+  for (int i = 0; i < EVENT_BUS_CAPACITY; i++)
+  {
+    SDL_AtomicSet(&slots[i].sequence, i);
+  }
+  SDL_AtomicSet(&tail, 0);
+  SDL_AtomicSet(&head, 0);
+  SDL_AtomicSet(&wakePending, 0);
+}
+
+bool eventBusPublish(const busEventS* event_p)
+{
+  uint32_t position = (uint32_t)SDL_AtomicGet(&tail);
+  for (;;)
+  {
+    busSlotS* slot_p = &slots[position & BUS_MASK];
+    int32_t lap = (int32_t)((uint32_t)SDL_AtomicGet(&slot_p->sequence) - position);
+    if (lap == 0)
+    {
+      if (SDL_AtomicCAS(&tail, (int)position, (int)(position + 1)))
+      {
+        slot_p->event = *event_p;
+        // The event is written before the slot is handed over.
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&slot_p->sequence, (int)(position + 1));
+        break;
+      }
+      position = (uint32_t)SDL_AtomicGet(&tail);
+    }
+    else if (lap < 0)
+    {
+      // The main thread has not taken the event a lap behind, the ring is full.
+      SDL_AtomicAdd(&dropped, 1);
+      wakeMainThread();
+      return false;
+    }
+    else
+    {
+      // Another thread published here first.
+      position = (uint32_t)SDL_AtomicGet(&tail);
+    }
+  }
+  SDL_AtomicAdd(&published, 1);
+  // Negative when the main thread took the event already.
+  noteDepth((int32_t)(position + 1 - (uint32_t)SDL_AtomicGet(&head)));
+  wakeMainThread();
+  return true;
+}
+
+bool eventBusPoll(busEventS* event_p)
+{
+  // Cleared before looking, an event published after this wakes the main thread again.
+  SDL_AtomicSet(&wakePending, 0);
+  uint32_t position = (uint32_t)SDL_AtomicGet(&head);
+  busSlotS* slot_p = &slots[position & BUS_MASK];
+  if ((uint32_t)SDL_AtomicGet(&slot_p->sequence) != position + 1) return false;
+  SDL_MemoryBarrierAcquire();
+  *event_p = slot_p->event;
+  SDL_AtomicSet(&slot_p->sequence, (int)(position + EVENT_BUS_CAPACITY));
+  SDL_AtomicSet(&head, (int)(position + 1));
+  return true;
+}
+
+eventBusStatsS eventBusStats(void)
+{
+  eventBusStatsS stats;
+  stats.published = (uint32_t)SDL_AtomicGet(&published);
+  stats.dropped = (uint32_t)SDL_AtomicGet(&dropped);
+  stats.depth = (uint32_t)SDL_AtomicGet(&tail) - (uint32_t)SDL_AtomicGet(&head);
+  stats.maxDepth = (uint32_t)SDL_AtomicGet(&maxDepth);
+  stats.wakeups = (uint32_t)SDL_AtomicGet(&wakeups);
+  return stats;
+}
@@ -0,0 +1,121 @@
+#include <math.h>
+#include <stdbool.h>
+#include <fixedTrig.h>
+
+#define SIN_BITS 10
+#define SIN_ENTRIES (1 << SIN_BITS) // Over one full turn.
+#define SIN_FRACTION_BITS 16        // Of the angle between two entries used to interpolate.
+
+#define ASIN_ENTRIES 512            // Over [0, 0.5], the steep part near 1 is not tabled.
+#define ASIN_BITS 24                // The asin table and its argument are 8.24 fixed point.
+#define ASIN_STEP_BITS (ASIN_BITS - 10)
+#define ASIN_HALF_PI 26353589       // pi / 2 in 8.24 fixed point.
+
+// One guard entry at the end of each table, so interpolation never wraps.
+static fixedT sinTable[SIN_ENTRIES + 1];
+static int32_t asinTable[ASIN_ENTRIES + 1];
+static bool initialized = false;
+
+void fixedTrigInit(void)
+{
+  if (initialized) return;
+  for (int i = 0; i <= SIN_ENTRIES; i++)
+  {
+    sinTable[i] = (fixedT)lround(sin(2 * M_PI * i / SIN_ENTRIES) * FIXED_ONE);
+  }
+  for (int i = 0; i <= ASIN_ENTRIES; i++)
+  {
+    asinTable[i] = (int32_t)lround(asin(0.5 * i / ASIN_ENTRIES) * (1 << ASIN_BITS));
+  }
+  initialized = true;
+}
+
+fixedT fixedSin(fixedAngleT angle)
+{
+  int index = angle >> (32 - SIN_BITS);
+  int32_t fraction = (angle >> (32 - SIN_BITS - SIN_FRACTION_BITS)) & ((1 << SIN_FRACTION_BITS) - 1);
+  int32_t step = sinTable[index + 1] - sinTable[index];
+  return sinTable[index] + ((step * fraction + (1 << (SIN_FRACTION_BITS - 1))) >> SIN_FRACTION_BITS);
+}
+
+fixedT fixedCos(fixedAngleT angle)
+{
+  return fixedSin(angle + FIXED_QUARTER_TURN);
+}
+
+/* squareRoot() returns the square root of value rounded to the nearest integer. */
+static uint64_t squareRoot(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = 1ull << 62;
+  while (bit > value) bit >>= 2;
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  // What is left of value is the original value - root^2.
+  if (value > root) root++;
+  return root;
+}
+
+fixedT fixedSqrt(fixedT value)
+{
+  if (value <= 0) return 0;
+  return (fixedT)squareRoot((uint64_t)value << 16);
+}
+
+/* asinTabled() looks up asin(value) for 8.24 values in [0, 0.5]. */
+static int32_t asinTabled(int32_t value)
+{
+  int index = value >> ASIN_STEP_BITS;
+  int32_t fraction = value & ((1 << ASIN_STEP_BITS) - 1);
+  if (index >= ASIN_ENTRIES) return asinTable[ASIN_ENTRIES];
+  int64_t step = asinTable[index + 1] - asinTable[index];
+  return asinTable[index] + (int32_t)((step * fraction + (1 << (ASIN_STEP_BITS - 1))) >> ASIN_STEP_BITS);
+}
+
+fixedT fixedAsin(fixedT value)
+{
+  bool negative = value < 0;
+  int32_t magnitude = negative ? -value : value;
+  if (magnitude > FIXED_ONE) magnitude = FIXED_ONE;
+
+  int32_t result;
+  if (magnitude <= FIXED_ONE / 2)
+  {
+    result = asinTabled(magnitude << (ASIN_BITS - 16));
+  }
+  else
+  {
+    // sqrt((1 - x) / 2) in 8.24, from (1 - x) / 2 in 16.48.
+    int32_t root = (int32_t)squareRoot((uint64_t)(FIXED_ONE - magnitude) << 31);
+    result = ASIN_HALF_PI - 2 * asinTabled(root);
+  }
+  result = (result + (1 << (ASIN_BITS - 17))) >> (ASIN_BITS - 16);
+  return negative ? -result : result;
+}
+
+fixedAngleT fixedAngleFromRadians(double radians)
+{
+  // Exact modulo one turn for anything the animations use, up to about 10^10 radians.
+  return FIXED_RADIANS(radians);
+}
+
+fixedT fixedFromDouble(double value)
+{
+  return (fixedT)lround(value * FIXED_ONE);
+}
+
+double fixedToDouble(fixedT value)
+{
+  return value / (double)FIXED_ONE;
+}
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <freeSet.h>
+
+bool freeSetInit(freeSetS* set_p, int capacity, bool full)
+{
+  set_p->capacity = capacity;
+  set_p->members_p = malloc(capacity * sizeof(int));
+  set_p->positions_p = malloc(capacity * sizeof(int));
+  if (set_p->members_p == NULL || set_p->positions_p == NULL)
+  {
+    printf("Could not allocate set of %d.\n", capacity);
+    freeSetDestroy(set_p);
+    return false;
+  }
+  freeSetFill(set_p, full);
+  return true;
+}
+
+void freeSetDestroy(freeSetS* set_p)
+{
+  free(set_p->members_p);
+  free(set_p->positions_p);
+  set_p->members_p = NULL;
+  set_p->positions_p = NULL;
+  set_p->capacity = 0;
+  set_p->count = 0;
+}
+
+void freeSetFill(freeSetS* set_p, bool full)
+{
+  for (int i = 0; i < set_p->capacity; i++)
+  {
+    set_p->members_p[i] = i;
+    set_p->positions_p[i] = full ? i : -1;
+  }
+  set_p->count = full ? set_p->capacity : 0;
+}
+
+void freeSetAdd(freeSetS* set_p, int item)
+{
+  if (set_p->positions_p[item] != -1) return;
+  set_p->positions_p[item] = set_p->count;
+  set_p->members_p[set_p->count++] = item;
+}
+
+void freeSetRemove(freeSetS* set_p, int item)
+{
+  int position = set_p->positions_p[item];
+  if (position == -1) return;
+  // Fill the hole with the last member.
+  int last = set_p->members_p[--set_p->count];
+  set_p->members_p[position] = last;
+  set_p->positions_p[last] = position;
+  set_p->positions_p[item] = -1;
+}
+
+bool freeSetContains(const freeSetS* set_p, int item)
+{
+  return set_p->positions_p[item] != -1;
+}
+
+int freeSetPick(const freeSetS* set_p, unsigned int random)
+{
+  if (set_p->count == 0) return -1;
+  return set_p->members_p[random % set_p->count];
+}
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <game.h>
+
+/* nextRandom() is a xorshift generator of the game's own, so that games on different threads do
+ * not share rand(). */
+static unsigned int nextRandom(gameS* game_p)
+{
+  game_p->random ^= game_p->random << 13;
+  game_p->random ^= game_p->random >> 17;
+  game_p->random ^= game_p->random << 5;
+  return game_p->random;
+}
+
+bool gameInit(gameS* game_p, int columns, int rows, const gameRulesS* rules_p, uint32_t seed)
+{
+  memset(game_p, 0, sizeof(*game_p));
+  if (columns <= 0 || rows <= 0 || rules_p->startIntervalMs < GAME_MIN_INTERVAL_MS ||
+      rules_p->intervalCount <= 0 || rules_p->intervalDecay <= 0 || rules_p->intervalDecay > 1)
+  {
+    printf("Can not play on %dx%d cells, a character every %d ms, %d times then %.2f times as often.\n",
+           columns, rows, rules_p->startIntervalMs, rules_p->intervalCount, rules_p->intervalDecay);
+    return false;
+  }
+  game_p->rules = *rules_p;
+  game_p->columns = columns;
+  game_p->rows = rows;
+  game_p->random = seed != 0 ? seed : 1; // xorshift never leaves 0.
+  game_p->cells_p = malloc(columns * rows);
+  if (game_p->cells_p == NULL ||
+      !freeSetInit(&game_p->emptyCells, columns * rows, true) ||
+      !freeSetInit(&game_p->freeChars, GAME_NUM_CHARS, true))
+  {
+    printf("Could not allocate a game of %dx%d cells.\n", columns, rows);
+    gameDestroy(game_p);
+    return false;
+  }
+  gameReset(game_p);
+  return true;
+}
+
+void gameSetHooks(gameS* game_p, const gameHooksS* hooks_p, void* context_p)
+{
+  game_p->hooks_p = hooks_p;
+  game_p->hooksContext_p = context_p;
+}
+
+void gameDestroy(gameS* game_p)
+{
+  free(game_p->cells_p);
+  game_p->cells_p = NULL;
+  freeSetDestroy(&game_p->emptyCells);
+  freeSetDestroy(&game_p->freeChars);
+}
+
+void gameReset(gameS* game_p)
+{
+  memset(game_p->cells_p, GAME_EMPTY_CELL, game_p->columns * game_p->rows);
+  freeSetFill(&game_p->emptyCells, true);
+  freeSetFill(&game_p->freeChars, true);
+  for (int i = 0; i < GAME_NUM_CHARS; i++)
+  {
+    game_p->placement[i] = GAME_NONE;
+  }
+  game_p->score = 0;
+  game_p->intervalMs = game_p->rules.startIntervalMs;
+  game_p->intervalCountDown = game_p->rules.intervalCount;
+  game_p->nextSpawnMs = game_p->rules.startIntervalMs;
+  game_p->lost = false;
+}
+
+int gameMsUntilSpawn(const gameS* game_p, uint32_t nowMs)
+{
+  if (game_p->lost) return -1;
+  // Signed, so that a clock that went past the spawn gives 0.
+  int32_t untilMs = (int32_t)(game_p->nextSpawnMs - nowMs);
+  return untilMs > 0 ? untilMs : 0;
+}
+
+void gamePickSpawn(gameS* game_p, int* charIndex_p, int* pos_p)
+{
+  const gameHooksS* hooks_p = game_p->hooks_p;
+  if (hooks_p != NULL && hooks_p->pick != NULL)
+  {
+    *charIndex_p = hooks_p->pick(game_p->hooksContext_p, &game_p->freeChars);
+  }
+  else
+  {
+    *charIndex_p = freeSetPick(&game_p->freeChars, nextRandom(game_p));
+  }
+  // Without a character to spawn the grid is not looked at, the spawn loses either way.
+  *pos_p = *charIndex_p != GAME_NONE ? freeSetPick(&game_p->emptyCells, nextRandom(game_p)) : GAME_NONE;
+}
+
+void gameSpawn(gameS* game_p, int charIndex, int pos)
+{
+  const gameHooksS* hooks_p = game_p->hooks_p;
+  if (game_p->lost) return;
+  // No character or no place to place it. You have lost.
+  if (charIndex == GAME_NONE || pos == GAME_NONE)
+  {
+    game_p->lost = true;
+    if (hooks_p != NULL && hooks_p->lost != NULL) hooks_p->lost(game_p->hooksContext_p);
+    return;
+  }
+  if (charIndex >= 0 && charIndex < GAME_NUM_CHARS)
+  {
+    if (pos >= 0 && pos < game_p->columns * game_p->rows &&
+        freeSetContains(&game_p->freeChars, charIndex) && freeSetContains(&game_p->emptyCells, pos))
+    {
+      freeSetRemove(&game_p->freeChars, charIndex);
+      freeSetRemove(&game_p->emptyCells, pos);
+      game_p->cells_p[pos] = (char)(charIndex + GAME_START_CHAR);
+      game_p->placement[charIndex] = pos;
+      if (hooks_p != NULL && hooks_p->spawned != NULL) hooks_p->spawned(game_p->hooksContext_p, charIndex, pos);
+    }
+  }
+
+  // Make the interval smaller everytime a certain number of characters have been placed.
+  game_p->intervalCountDown--;
+  if (game_p->intervalCountDown == 0)
+  {
+    game_p->intervalCountDown = game_p->rules.intervalCount;
+    game_p->intervalMs = game_p->intervalMs * game_p->rules.intervalDecay;
+    if (game_p->intervalMs < GAME_MIN_INTERVAL_MS) game_p->intervalMs = GAME_MIN_INTERVAL_MS;
+  }
+  game_p->nextSpawnMs += game_p->intervalMs;
+}
+
+int gameAdvance(gameS* game_p, uint32_t nowMs)
+{
+  int spawns = 0;
+  while (gameMsUntilSpawn(game_p, nowMs) == 0)
+  {
+    int charIndex;
+    int pos;
+    gamePickSpawn(game_p, &charIndex, &pos);
+    gameSpawn(game_p, charIndex, pos);
+    spawns++;
+  }
+  return spawns;
+}
+
+int gameShoot(gameS* game_p, char inputChar)
+{
+  const gameHooksS* hooks_p = game_p->hooks_p;
+  // Check if this char is in the range we are playing with.
+  if (inputChar < GAME_START_CHAR || inputChar >= GAME_START_CHAR + GAME_NUM_CHARS) return 0;
+  int charIndex = inputChar - GAME_START_CHAR;
+
+  int pos = game_p->placement[charIndex];
+  if (pos != GAME_NONE)
+  {
+    game_p->placement[charIndex] = GAME_NONE;
+    game_p->cells_p[pos] = GAME_EMPTY_CELL;
+    freeSetAdd(&game_p->emptyCells, pos);
+    freeSetAdd(&game_p->freeChars, charIndex);
+    game_p->score += game_p->rules.hitPoints;
+    if (hooks_p != NULL && hooks_p->hit != NULL) hooks_p->hit(game_p->hooksContext_p, charIndex, pos);
+    return game_p->rules.hitPoints;
+  }
+
+  game_p->score += game_p->rules.missPoints;
+  if (hooks_p != NULL && hooks_p->missed != NULL) hooks_p->missed(game_p->hooksContext_p, charIndex);
+  return game_p->rules.missPoints;
+}
+
+bool gameValid(const gameS* game_p)
+{
+  int numCells = game_p->columns * game_p->rows;
+  int inPlay = 0;
+  for (int i = 0; i < GAME_NUM_CHARS; i++)
+  {
+    int pos = game_p->placement[i];
+    if (pos == GAME_NONE)
+    {
+      if (!freeSetContains(&game_p->freeChars, i)) return false;
+      continue;
+    }
+    if (pos < 0 || pos >= numCells || freeSetContains(&game_p->freeChars, i) ||
+        game_p->cells_p[pos] != (char)(i + GAME_START_CHAR)) return false;
+    inPlay++;
+  }
+  int taken = 0;
+  for (int pos = 0; pos < numCells; pos++)
+  {
+    bool empty = game_p->cells_p[pos] == GAME_EMPTY_CELL;
+    if (empty != freeSetContains(&game_p->emptyCells, pos)) return false;
+    if (!empty) taken++;
+  }
+  return taken == inPlay && game_p->freeChars.count == GAME_NUM_CHARS - inPlay;
+}
+
+scoreS* gameInsertScore(int score, scoreS* scores_p, int* numScores_p, int maxScores)
+{
+  int i = 0;
+  while (i < *numScores_p && scores_p[i].score > score) i++;
+  if (i >= maxScores) return NULL;
+
+  // The last score falls off a full list.
+  int numMoved = (*numScores_p < maxScores ? *numScores_p : maxScores - 1) - i;
+  if (numMoved > 0) memmove(&scores_p[i + 1], &scores_p[i], numMoved * sizeof(scoreS));
+  if (*numScores_p < maxScores) *numScores_p += 1;
+  scores_p[i].name[0] = '\0';
+  scores_p[i].score = score;
+  return &scores_p[i];
+}
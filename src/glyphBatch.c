@@ -0,0 +1,183 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glyphBatch.h>
+
+#define GLYPHS_PER_ROW 16
+#define GLYPH_TABLE_SIZE 256
+#define VERTICES_PER_GLYPH 4
+#define INDICES_PER_GLYPH 6
+#define START_CAPACITY 256
+
+static SDL_Renderer* batchRenderer_p = NULL;
+static SDL_Texture* batchTexture_p = NULL;
+static SDL_FRect glyphSource[GLYPH_TABLE_SIZE]; // Texture coordinates, 0 to 1.
+static SDL_Vertex* vertices_p = NULL;
+static int* indices_p = NULL;
+static int numGlyphs = 0;
+static int glyphCapacity = 0;
+
+static bool growBatch(int capacity);
+
+bool glyphBatchInit(SDL_Renderer* renderer_p, SDL_Texture* fontTexture_p, int glyphWidth, int glyphHeight)
+{
+  int textureWidth, textureHeight;
+  if (SDL_QueryTexture(fontTexture_p, NULL, NULL, &textureWidth, &textureHeight))
+  {
+    printf("Error when querying texture: %s\n", SDL_GetError());
+    return false;
+  }
+  batchRenderer_p = renderer_p;
+  batchTexture_p = fontTexture_p;
+
+  // Same placement as the glyph sheet has always been read with, but only computed once.
+  for (int glyph = 0; glyph < GLYPH_TABLE_SIZE; glyph++)
+  {
+    glyphSource[glyph].x = (float)(glyphWidth * (glyph % GLYPHS_PER_ROW)) / textureWidth;
+    glyphSource[glyph].y = (float)(glyphHeight * (glyph / GLYPHS_PER_ROW)) / textureHeight;
+    glyphSource[glyph].w = (float)glyphWidth / textureWidth;
+    glyphSource[glyph].h = (float)glyphHeight / textureHeight;
+  }
+  numGlyphs = 0;
+  return growBatch(START_CAPACITY);
+}
+
+void glyphBatchDestroy(void)
+{
+  free(vertices_p);
+  free(indices_p);
+  vertices_p = NULL;
+  indices_p = NULL;
+  numGlyphs = 0;
+  glyphCapacity = 0;
+}
+
+/*
+ * growBatch() makes room for at least capacity glyphs. The index buffer never changes with
+ * the content, two triangles per quad, so it is filled in here and not per frame.
+ */
+static bool growBatch(int capacity)
+{
+  if (capacity <= glyphCapacity) return true;
+
+  SDL_Vertex* newVertices_p = realloc(vertices_p, capacity * VERTICES_PER_GLYPH * sizeof(SDL_Vertex));
+  if (newVertices_p == NULL)
+  {
+    printf("Could not allocate glyph vertices.\n");
+    return false;
+  }
+  vertices_p = newVertices_p;
+
+  int* newIndices_p = realloc(indices_p, capacity * INDICES_PER_GLYPH * sizeof(int));
+  if (newIndices_p == NULL)
+  {
+    printf("Could not allocate glyph indices.\n");
+    return false;
+  }
+  indices_p = newIndices_p;
+
+  for (int glyph = glyphCapacity; glyph < capacity; glyph++)
+  {
+    int* index_p = &indices_p[glyph * INDICES_PER_GLYPH];
+    int firstVertex = glyph * VERTICES_PER_GLYPH;
+    index_p[0] = firstVertex;
+    index_p[1] = firstVertex + 1;
+    index_p[2] = firstVertex + 2;
+    index_p[3] = firstVertex + 2;
+    index_p[4] = firstVertex + 3;
+    index_p[5] = firstVertex;
+  }
+  glyphCapacity = capacity;
+  return true;
+}
+
+void glyphBatchAdd(char glyph, const SDL_FRect* dest_p)
+{
+  if (numGlyphs == glyphCapacity && !growBatch(glyphCapacity * 2)) return;
+
+  const SDL_FRect* source_p = &glyphSource[(unsigned char)glyph];
+  const SDL_Color white = {255, 255, 255, SDL_ALPHA_OPAQUE};
+  SDL_Vertex* vertex_p = &vertices_p[numGlyphs * VERTICES_PER_GLYPH];
+
+  vertex_p[0].position.x = dest_p->x;
+  vertex_p[0].position.y = dest_p->y;
+  vertex_p[0].tex_coord.x = source_p->x;
+  vertex_p[0].tex_coord.y = source_p->y;
+
+  vertex_p[1].position.x = dest_p->x + dest_p->w;
+  vertex_p[1].position.y = dest_p->y;
+  vertex_p[1].tex_coord.x = source_p->x + source_p->w;
+  vertex_p[1].tex_coord.y = source_p->y;
+
+  vertex_p[2].position.x = dest_p->x + dest_p->w;
+  vertex_p[2].position.y = dest_p->y + dest_p->h;
+  vertex_p[2].tex_coord.x = source_p->x + source_p->w;
+  vertex_p[2].tex_coord.y = source_p->y + source_p->h;
+
+  vertex_p[3].position.x = dest_p->x;
+  vertex_p[3].position.y = dest_p->y + dest_p->h;
+  vertex_p[3].tex_coord.x = source_p->x;
+  vertex_p[3].tex_coord.y = source_p->y + source_p->h;
+
+  for (int i = 0; i < VERTICES_PER_GLYPH; i++)
+  {
+    vertex_p[i].color = white;
+  }
+  numGlyphs++;
+}
+
+void glyphBatchAddLayout(const glyphLayoutS* layout_p, const char* text, int numChars)
+{
+  if (numChars > layout_p->numGlyphs) numChars = layout_p->numGlyphs;
+  for (int i = 0; i < numChars; i++)
+  {
+    glyphBatchAdd(text[i], &layout_p->rects_p[i]);
+  }
+}
+
+void glyphBatchAddLine(const char* text, int numChars, float x, float y, float glyphWidth, float glyphHeight)
+{
+  SDL_FRect dest = {x, y, glyphWidth, glyphHeight};
+  for (int i = 0; i < numChars; i++)
+  {
+    glyphBatchAdd(text[i], &dest);
+    dest.x += glyphWidth;
+  }
+}
+
+void glyphBatchFlush(void)
+{
+  if (numGlyphs == 0) return;
+  if (SDL_RenderGeometry(batchRenderer_p,
+                         batchTexture_p,
+                         vertices_p,
+                         numGlyphs * VERTICES_PER_GLYPH,
+                         indices_p,
+                         numGlyphs * INDICES_PER_GLYPH)) printf("Error when RenderGeometry: %s\n", SDL_GetError());
+  numGlyphs = 0;
+}
+
+void glyphBatchClear(void)
+{
+  numGlyphs = 0;
+}
+
+bool glyphLayoutCreate(glyphLayoutS* layout_p, int numGlyphs)
+{
+  layout_p->rects_p = calloc(numGlyphs, sizeof(SDL_FRect));
+  if (layout_p->rects_p == NULL)
+  {
+    printf("Could not allocate glyph layout.\n");
+    layout_p->numGlyphs = 0;
+    return false;
+  }
+  layout_p->numGlyphs = numGlyphs;
+  return true;
+}
+
+void glyphLayoutDestroy(glyphLayoutS* layout_p)
+{
+  free(layout_p->rects_p);
+  layout_p->rects_p = NULL;
+  layout_p->numGlyphs = 0;
+}
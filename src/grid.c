@@ -0,0 +1,99 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <grid.h>
+
+// Odd while a writer is changing cells, and bumped by two for every write.
+static SDL_atomic_t sequence = {0};
+// Only serializes writers against each other, and is held for a single write.
+static SDL_SpinLock writerLock = 0;
+static char* cells_p = NULL;
+static int numCells = 0;
+static int numColumns = 0;
+static int numRows = 0;
+
+static void beginWrite(void)
+{
+  SDL_AtomicLock(&writerLock);
+  SDL_AtomicIncRef(&sequence);
+  SDL_MemoryBarrierRelease();
+}
+
+static void endWrite(void)
+{
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicIncRef(&sequence);
+  SDL_AtomicUnlock(&writerLock);
+}
+
+bool gridInit(int columns, int rows, char emptyCell)
+{
+  cells_p = malloc(columns * rows);
+  if (cells_p == NULL)
+  {
+    printf("Could not allocate grid.\n");
+    return false;
+  }
+  numCells = columns * rows;
+  numColumns = columns;
+  numRows = rows;
+  gridFill(emptyCell);
+  return true;
+}
+
+void gridDestroy(void)
+{
+  free(cells_p);
+  cells_p = NULL;
+  numCells = 0;
+}
+
+int gridNumCells(void)
+{
+  return numCells;
+}
+
+int gridColumns(void)
+{
+  return numColumns;
+}
+
+int gridRows(void)
+{
+  return numRows;
+}
+
+void gridSet(int index, char cell)
+{
+  beginWrite();
+  cells_p[index] = cell;
+  endWrite();
+}
+
+void gridFill(char cell)
+{
+  beginWrite();
+  memset(cells_p, cell, numCells);
+  endWrite();
+}
+
+bool gridSnapshot(char* snapshot_p, int* version_p)
+{
+  int before;
+  int after;
+  do
+  {
+    before = SDL_AtomicGet(&sequence);
+    if (before == *version_p) return false;
+    if (before & 1) continue; // A write is in progress, it is only a few stores long.
+
+    SDL_MemoryBarrierAcquire();
+    memcpy(snapshot_p, cells_p, numCells);
+    SDL_MemoryBarrierAcquire();
+    after = SDL_AtomicGet(&sequence);
+  } while ((before & 1) || before != after);
+
+  *version_p = before;
+  return true;
+}
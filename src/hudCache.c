@@ -0,0 +1,92 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <hudCache.h>
+#include <glyphBatch.h>
+
+static SDL_Renderer* hudRenderer_p = NULL;
+
+static bool renderLine(hudLineS* line_p);
+
+void hudCacheInit(SDL_Renderer* renderer_p)
+{
+  hudRenderer_p = renderer_p;
+}
+
+void hudLineInit(hudLineS* line_p, int charWidth, int charHeight)
+{
+  line_p->text[0] = '\0';
+  line_p->numChars = 0;
+  line_p->capacity = 0;
+  line_p->charWidth = charWidth;
+  line_p->charHeight = charHeight;
+  line_p->texture_p = NULL;
+}
+
+void hudLineDestroy(hudLineS* line_p)
+{
+  if (line_p->texture_p != NULL) SDL_DestroyTexture(line_p->texture_p);
+  hudLineInit(line_p, line_p->charWidth, line_p->charHeight);
+}
+
+void hudLineDraw(hudLineS* line_p, const char* text, int x, int y)
+{
+  if (line_p->texture_p == NULL || strncmp(line_p->text, text, HUD_LINE_SIZE) != 0)
+  {
+    snprintf(line_p->text, HUD_LINE_SIZE, "%s", text);
+    line_p->numChars = strlen(line_p->text);
+    if (!renderLine(line_p))
+    {
+      // No render target, draw the glyphs directly instead.
+      glyphBatchAddLine(line_p->text, line_p->numChars, x, y, line_p->charWidth, line_p->charHeight);
+      glyphBatchFlush();
+      return;
+    }
+  }
+
+  SDL_Rect sourceRect = {0, 0, line_p->numChars * line_p->charWidth, line_p->charHeight};
+  SDL_Rect destRect = {x, y, sourceRect.w, sourceRect.h};
+  if (SDL_RenderCopy(hudRenderer_p, line_p->texture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+}
+
+/*
+ * renderLine() renders the glyphs of the line into its texture, which is replaced by a wider
+ * one when the text does not fit.
+ */
+static bool renderLine(hudLineS* line_p)
+{
+  if (line_p->texture_p == NULL || line_p->numChars > line_p->capacity)
+  {
+    if (line_p->texture_p != NULL) SDL_DestroyTexture(line_p->texture_p);
+    line_p->capacity = line_p->numChars > 0 ? line_p->numChars : 1;
+    line_p->texture_p = SDL_CreateTexture(hudRenderer_p,
+                                          SDL_PIXELFORMAT_ARGB8888,
+                                          SDL_TEXTUREACCESS_TARGET,
+                                          line_p->capacity * line_p->charWidth,
+                                          line_p->charHeight);
+    if (line_p->texture_p == NULL)
+    {
+      printf("Error when creating texture: %s\n", SDL_GetError());
+      return false;
+    }
+    SDL_SetTextureBlendMode(line_p->texture_p, SDL_BLENDMODE_BLEND);
+  }
+
+  // Glyphs already queued belong to the current target and have to be drawn before switching.
+  glyphBatchFlush();
+  SDL_Texture* previousTarget_p = SDL_GetRenderTarget(hudRenderer_p);
+  if (SDL_SetRenderTarget(hudRenderer_p, line_p->texture_p))
+  {
+    printf("Error when setting render target: %s\n", SDL_GetError());
+    SDL_DestroyTexture(line_p->texture_p);
+    line_p->texture_p = NULL;
+    line_p->capacity = 0;
+    return false;
+  }
+  SDL_SetRenderDrawColor(hudRenderer_p, 0, 0, 0, SDL_ALPHA_TRANSPARENT);
+  SDL_RenderClear(hudRenderer_p);
+  glyphBatchAddLine(line_p->text, line_p->numChars, 0, 0, line_p->charWidth, line_p->charHeight);
+  glyphBatchFlush();
+  SDL_SetRenderTarget(hudRenderer_p, previousTarget_p);
+  return true;
+}
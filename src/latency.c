@@ -0,0 +1,165 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <latency.h>
+
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS) // Buckets per power of two.
+#define NUM_BUCKETS ((32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS)
+#define MAX_PENDING 64 // Keys shot while no frame is drawn, more are not counted.
+
+// The points where a key is stamped, span i goes from stamp i to stamp i + 1.
+typedef enum stampE
+{
+  STAMP_EVENT,
+  STAMP_TAKEN,
+  STAMP_SHOOT_BEGIN,
+  STAMP_SHOOT_END,
+  STAMP_RENDER_BEGIN,
+  STAMP_PRESENTED,
+  NUM_STAMPS
+} stampE;
+
+typedef struct keyStampsS
+{
+  uint64_t stamps[NUM_STAMPS];
+} keyStampsS;
+
+static const char* spanNames[LATENCY_NUM_SPANS] =
+{
+  [LATENCY_QUEUE] = "queue",
+  [LATENCY_INPUT] = "input",
+  [LATENCY_SHOOT] = "shoot",
+  [LATENCY_FRAME_WAIT] = "frame wait",
+  [LATENCY_RENDER] = "render",
+  [LATENCY_TOTAL] = "key to photon",
+};
+
+// Written by the main thread only.
+static keyStampsS current;
+static keyStampsS pending[MAX_PENDING];
+static int numPending = 0;
+static uint64_t renderBegin = 0;
+
+// Read by any thread.
+static SDL_atomic_t histograms[LATENCY_NUM_SPANS][NUM_BUCKETS];
+static SDL_atomic_t counted;
+
+/* bucket() returns the bucket of a value, every power of two is split in SUB_BUCKETS buckets so
+ * that the buckets are no wider than 1/SUB_BUCKETS of their values. */
+static int bucket(uint32_t us)
+{
+  if (us < SUB_BUCKETS) return (int)us;
+  int shift = 31 - __builtin_clz(us) - SUB_BUCKET_BITS;
+  return (shift + 1) * SUB_BUCKETS + (int)(us >> shift) - SUB_BUCKETS;
+}
+
+/* bucketLast() returns the largest value that goes into the bucket. */
+static uint32_t bucketLast(int index)
+{
+  if (index < SUB_BUCKETS) return (uint32_t)index;
+  if (index == NUM_BUCKETS - 1) return UINT32_MAX;
+  int shift = index / SUB_BUCKETS - 1;
+  uint32_t first = (uint32_t)(index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+  return first + (1u << shift) - 1;
+}
+
+static uint32_t ticksToUs(uint64_t ticks)
+{
+  double us = (double)ticks * 1000000.0 / SDL_GetPerformanceFrequency();
+  return us < UINT32_MAX ? (uint32_t)us : UINT32_MAX;
+}
+
+static void count(latencySpanE span, uint64_t ticks)
+{
+  SDL_AtomicAdd(&histograms[span][bucket(ticksToUs(ticks))], 1);
+}
+
+void latencyKeyEvent(uint32_t timestamp)
+{
+  uint64_t now = SDL_GetPerformanceCounter();
+  // The event timestamp is in milliseconds of SDL_GetTicks(), move it to the counter.
+  uint32_t ageMs = SDL_GetTicks() - timestamp;
+  if (ageMs > 1000000) ageMs = 0; // Not from the queue, it has no real timestamp.
+  current.stamps[STAMP_EVENT] = now - (uint64_t)ageMs * SDL_GetPerformanceFrequency() / 1000;
+  current.stamps[STAMP_TAKEN] = now;
+  current.stamps[STAMP_SHOOT_BEGIN] = 0;
+}
+
+void latencyShootBegin(void)
+{
+  if (current.stamps[STAMP_TAKEN] == 0) return; // A key from a recording.
+  current.stamps[STAMP_SHOOT_BEGIN] = SDL_GetPerformanceCounter();
+}
+
+void latencyShootEnd(void)
+{
+  if (current.stamps[STAMP_SHOOT_BEGIN] == 0) return;
+  current.stamps[STAMP_SHOOT_END] = SDL_GetPerformanceCounter();
+  if (numPending < MAX_PENDING) pending[numPending++] = current;
+  current.stamps[STAMP_TAKEN] = 0;
+  current.stamps[STAMP_SHOOT_BEGIN] = 0;
+}
+
+void latencyRenderBegin(void)
+{
+  renderBegin = SDL_GetPerformanceCounter();
+}
+
+void latencyPresented(void)
+{
+  if (numPending == 0) return;
+  uint64_t presented = SDL_GetPerformanceCounter();
+  for (int i = 0; i < numPending; i++)
+  {
+    uint64_t* stamps_p = pending[i].stamps;
+    stamps_p[STAMP_RENDER_BEGIN] = renderBegin;
+    stamps_p[STAMP_PRESENTED] = presented;
+    for (int span = LATENCY_QUEUE; span < LATENCY_TOTAL; span++)
+    {
+      count(span, stamps_p[span + 1] - stamps_p[span]);
+    }
+    count(LATENCY_TOTAL, presented - stamps_p[STAMP_EVENT]);
+  }
+  SDL_AtomicAdd(&counted, numPending);
+  numPending = 0;
+}
+
+uint64_t latencyCount(void)
+{
+  return (uint64_t)(unsigned int)SDL_AtomicGet(&counted);
+}
+
+uint32_t latencyPercentileUs(latencySpanE span, double fraction)
+{
+  // A copy, so that keys counted meanwhile do not move the buckets under the walk.
+  uint32_t counts[NUM_BUCKETS];
+  uint64_t total = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++)
+  {
+    counts[i] = (uint32_t)SDL_AtomicGet(&histograms[span][i]);
+    total += counts[i];
+  }
+  if (total == 0) return 0;
+  uint64_t rank = (uint64_t)(fraction * total + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > total) rank = total;
+  uint64_t seen = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++)
+  {
+    seen += counts[i];
+    if (seen >= rank) return bucketLast(i);
+  }
+  return UINT32_MAX;
+}
+
+void latencyPrint(void)
+{
+  printf("Keystroke to photon latency of %llu keys, in ms:\n", (unsigned long long)latencyCount());
+  printf("  %-14s %8s %8s %8s %8s\n", "span", "p50", "p90", "p99", "max");
+  for (int span = 0; span < LATENCY_NUM_SPANS; span++)
+  {
+    printf("  %-14s %8.2f %8.2f %8.2f %8.2f\n", spanNames[span],
+           latencyPercentileUs(span, 0.5) / 1000.0, latencyPercentileUs(span, 0.9) / 1000.0,
+           latencyPercentileUs(span, 0.99) / 1000.0, latencyPercentileUs(span, 1.0) / 1000.0);
+  }
+}
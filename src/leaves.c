@@ -0,0 +1,342 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fixedTrig.h>
+#include <leaves.h>
+#include <workerPool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LEAVES_X86 1
+#include <immintrin.h>
+#endif
+
+#define LEAF_AIR 0
+#define LEAF_LOOP 1
+#define LEAF_GROUND 2
+#define LEAF_LIFETIME 500
+#define LEAF_FALL_SPEED 2
+#define LEAF_SPEED_SPREAD 7 // Leaves drift from wind - 4 to wind + 2.
+#define LEAF_SPEED_OFFSET 4
+#define LEAF_LANDING_SPREAD 5
+#define MIN_LEAVES_PER_TASK 4096 // Fewer are not worth waking a worker for.
+#define GUST_CHANCE (0x10000 / 40) // Out of 0x10000, a leaf in a gust loops once in 40 steps.
+#define NUM_LOOP_TYPES 3
+#define MAX_LOOP_LENGTH 17
+
+// How a leaf moves in every step of a loop, per loop type.
+static int loopDx[NUM_LOOP_TYPES * MAX_LOOP_LENGTH];
+static int loopDy[NUM_LOOP_TYPES * MAX_LOOP_LENGTH];
+static const int loopLength[NUM_LOOP_TYPES] = {4, 8, 16};
+
+static void initLoops(void)
+{
+  for (int loopType = 0; loopType < NUM_LOOP_TYPES; loopType++)
+  {
+    int lastX = 0;
+    int lastY = 0;
+    int numberOfLoops = 1 + loopLength[loopType];
+    for (int loopIndex = 0; loopIndex < numberOfLoops; loopIndex++)
+    {
+      // Half a step into every step of the loop, (2 loopIndex + 1) / (2 numberOfLoops) turns.
+      fixedAngleT angle = FIXED_TURNS(2 * loopIndex + 1, 2 * numberOfLoops);
+      int x = 3 * (loopType + 1) * -fixedSin(angle) / FIXED_ONE;
+      int y = 3 * (loopType + 1) * (FIXED_ONE - fixedCos(angle)) / FIXED_ONE;
+      loopDx[loopType * MAX_LOOP_LENGTH + loopIndex] = x - lastX;
+      loopDy[loopType * MAX_LOOP_LENGTH + loopIndex] = y - lastY;
+      lastX = x;
+      lastY = y;
+    }
+  }
+}
+
+static uint32_t nextRandom(uint32_t random)
+{
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  return random;
+}
+
+bool leavesInit(leavesS* leaves_p, int capacity)
+{
+  fixedTrigInit();
+  initLoops();
+  leaves_p->capacity = capacity;
+  leaves_p->count = 0;
+  leaves_p->rectsValid = false;
+  leaves_p->x_p = malloc(capacity * sizeof(int32_t));
+  leaves_p->y_p = malloc(capacity * sizeof(int32_t));
+  leaves_p->state_p = malloc(capacity * sizeof(int32_t));
+  leaves_p->mode_p = malloc(capacity * sizeof(int32_t));
+  leaves_p->lifetime_p = malloc(capacity * sizeof(int32_t));
+  leaves_p->loopType_p = malloc(capacity * sizeof(int32_t));
+  leaves_p->loopIndex_p = malloc(capacity * sizeof(int32_t));
+  leaves_p->random_p = malloc(capacity * sizeof(uint32_t));
+  leaves_p->rects_p = malloc(capacity * sizeof(SDL_Rect));
+  if (leaves_p->x_p == NULL || leaves_p->y_p == NULL || leaves_p->state_p == NULL ||
+      leaves_p->mode_p == NULL || leaves_p->lifetime_p == NULL || leaves_p->loopType_p == NULL ||
+      leaves_p->loopIndex_p == NULL || leaves_p->random_p == NULL || leaves_p->rects_p == NULL)
+  {
+    printf("Could not allocate %d leaves.\n", capacity);
+    leavesDestroy(leaves_p);
+    return false;
+  }
+  return true;
+}
+
+void leavesDestroy(leavesS* leaves_p)
+{
+  free(leaves_p->x_p);
+  free(leaves_p->y_p);
+  free(leaves_p->state_p);
+  free(leaves_p->mode_p);
+  free(leaves_p->lifetime_p);
+  free(leaves_p->loopType_p);
+  free(leaves_p->loopIndex_p);
+  free(leaves_p->random_p);
+  free(leaves_p->rects_p);
+  leaves_p->x_p = NULL;
+  leaves_p->y_p = NULL;
+  leaves_p->state_p = NULL;
+  leaves_p->mode_p = NULL;
+  leaves_p->lifetime_p = NULL;
+  leaves_p->loopType_p = NULL;
+  leaves_p->loopIndex_p = NULL;
+  leaves_p->random_p = NULL;
+  leaves_p->rects_p = NULL;
+  leaves_p->capacity = 0;
+  leaves_p->count = 0;
+}
+
+bool leavesSpawn(leavesS* leaves_p, int x, int y, int state, uint32_t seed)
+{
+  if (leaves_p->count == leaves_p->capacity) return false;
+  int i = leaves_p->count++;
+  leaves_p->x_p[i] = x;
+  leaves_p->y_p[i] = y;
+  leaves_p->state_p[i] = state;
+  leaves_p->mode_p[i] = LEAF_AIR;
+  leaves_p->lifetime_p[i] = LEAF_LIFETIME;
+  leaves_p->loopType_p[i] = 0;
+  leaves_p->loopIndex_p[i] = 0;
+  leaves_p->random_p[i] = seed | 1; // The generator gets stuck at zero.
+  leaves_p->rectsValid = false;
+  return true;
+}
+
+/* stepLeaf() moves leaf i one step, with random as its next random number. */
+static void stepLeaf(leavesS* leaves_p, int i, uint32_t random, int windSpeed, bool gust, int groundY)
+{
+  if (gust && (random & 0xFFFF) < GUST_CHANCE)
+  {
+    leaves_p->mode_p[i] = LEAF_LOOP;
+    leaves_p->loopType_p[i] = (((random >> 16) & 0xFF) * NUM_LOOP_TYPES) >> 8;
+    leaves_p->loopIndex_p[i] = 0;
+  }
+
+  if (leaves_p->mode_p[i] == LEAF_LOOP)
+  {
+    int loopType = leaves_p->loopType_p[i];
+    int step = loopType * MAX_LOOP_LENGTH + leaves_p->loopIndex_p[i];
+    leaves_p->x_p[i] += loopDx[step] - windSpeed;
+    leaves_p->y_p[i] -= loopDy[step];
+    leaves_p->loopIndex_p[i]++;
+    if (leaves_p->loopIndex_p[i] == loopLength[loopType]) leaves_p->mode_p[i] = LEAF_AIR;
+  }
+  else if (leaves_p->mode_p[i] == LEAF_AIR)
+  {
+    int speed = windSpeed + ((((random >> 8) & 0xFF) * LEAF_SPEED_SPREAD) >> 8) - LEAF_SPEED_OFFSET;
+    leaves_p->x_p[i] -= speed;
+    leaves_p->y_p[i] += LEAF_FALL_SPEED;
+    if (leaves_p->y_p[i] > groundY + speed)
+    {
+      leaves_p->mode_p[i] = LEAF_GROUND;
+      leaves_p->y_p[i] += ((random >> 24) * LEAF_LANDING_SPREAD) >> 8;
+    }
+  }
+  else
+  {
+    leaves_p->lifetime_p[i]--;
+  }
+}
+
+static void stepScalar(leavesS* leaves_p, int first, int end, int windSpeed, bool gust, int groundY)
+{
+  for (int i = first; i < end; i++)
+  {
+    leaves_p->random_p[i] = nextRandom(leaves_p->random_p[i]);
+    stepLeaf(leaves_p, i, leaves_p->random_p[i], windSpeed, gust, groundY);
+  }
+}
+
+#ifdef LEAVES_X86
+/*
+ * Four leaves at a time. Leaves in the air and on the ground are moved with masks instead of
+ * branches. Loops need a table lookup per leaf, so a group with a looping leaf takes the scalar
+ * path; they are rare, as leaves only start loops in gusts.
+ */
+__attribute__((target("sse2")))
+static void stepSse2(leavesS* leaves_p, int first, int end, int windSpeed, bool gust, int groundY)
+{
+  const __m128i air = _mm_set1_epi32(LEAF_AIR);
+  const __m128i loop = _mm_set1_epi32(LEAF_LOOP);
+  const __m128i ground = _mm_set1_epi32(LEAF_GROUND);
+  const __m128i byteMask = _mm_set1_epi32(0xFF);
+  const __m128i halfMask = _mm_set1_epi32(0xFFFF);
+  const __m128i gustChance = _mm_set1_epi32(gust ? GUST_CHANCE : 0);
+  const __m128i speedBase = _mm_set1_epi32(windSpeed - LEAF_SPEED_OFFSET);
+  const __m128i fallSpeed = _mm_set1_epi32(LEAF_FALL_SPEED);
+  const __m128i groundLevel = _mm_set1_epi32(groundY);
+  const __m128i spreadFactor = _mm_set1_epi32(LEAF_SPEED_SPREAD);
+  const __m128i landingFactor = _mm_set1_epi32(LEAF_LANDING_SPREAD);
+  int i = first;
+  for (; i + 4 <= end; i += 4)
+  {
+    __m128i random = _mm_loadu_si128((const __m128i*)(leaves_p->random_p + i));
+    random = _mm_xor_si128(random, _mm_slli_epi32(random, 13));
+    random = _mm_xor_si128(random, _mm_srli_epi32(random, 17));
+    random = _mm_xor_si128(random, _mm_slli_epi32(random, 5));
+    _mm_storeu_si128((__m128i*)(leaves_p->random_p + i), random);
+
+    __m128i mode = _mm_loadu_si128((const __m128i*)(leaves_p->mode_p + i));
+    __m128i looping = _mm_or_si128(_mm_cmpeq_epi32(mode, loop),
+                                   _mm_cmplt_epi32(_mm_and_si128(random, halfMask), gustChance));
+    if (_mm_movemask_epi8(looping) != 0)
+    {
+      uint32_t randoms[4];
+      _mm_storeu_si128((__m128i*)randoms, random);
+      for (int lane = 0; lane < 4; lane++)
+      {
+        stepLeaf(leaves_p, i + lane, randoms[lane], windSpeed, gust, groundY);
+      }
+      continue;
+    }
+
+    __m128i inAir = _mm_cmpeq_epi32(mode, air);
+    __m128i onGround = _mm_cmpeq_epi32(mode, ground);
+    // speed = windSpeed + random byte * LEAF_SPEED_SPREAD / 256 - LEAF_SPEED_OFFSET
+    __m128i spread = _mm_and_si128(_mm_srli_epi32(random, 8), byteMask);
+    // The products fit in 16 bits, and the upper 16 bits of every lane stay zero.
+    spread = _mm_srli_epi32(_mm_mullo_epi16(spread, spreadFactor), 8);
+    __m128i speed = _mm_add_epi32(speedBase, spread);
+
+    __m128i x = _mm_loadu_si128((const __m128i*)(leaves_p->x_p + i));
+    __m128i y = _mm_loadu_si128((const __m128i*)(leaves_p->y_p + i));
+    x = _mm_sub_epi32(x, _mm_and_si128(speed, inAir));
+    y = _mm_add_epi32(y, _mm_and_si128(fallSpeed, inAir));
+
+    __m128i landed = _mm_and_si128(inAir, _mm_cmpgt_epi32(y, _mm_add_epi32(groundLevel, speed)));
+    // landing = top random byte * LEAF_LANDING_SPREAD / 256
+    __m128i landing = _mm_srli_epi32(random, 24);
+    landing = _mm_srli_epi32(_mm_mullo_epi16(landing, landingFactor), 8);
+    y = _mm_add_epi32(y, _mm_and_si128(landing, landed));
+    mode = _mm_or_si128(_mm_andnot_si128(landed, mode), _mm_and_si128(landed, ground));
+
+    __m128i lifetime = _mm_loadu_si128((const __m128i*)(leaves_p->lifetime_p + i));
+    lifetime = _mm_add_epi32(lifetime, onGround); // The mask is -1 on the ground.
+
+    _mm_storeu_si128((__m128i*)(leaves_p->x_p + i), x);
+    _mm_storeu_si128((__m128i*)(leaves_p->y_p + i), y);
+    _mm_storeu_si128((__m128i*)(leaves_p->mode_p + i), mode);
+    _mm_storeu_si128((__m128i*)(leaves_p->lifetime_p + i), lifetime);
+  }
+  stepScalar(leaves_p, i, end, windSpeed, gust, groundY);
+}
+#endif
+
+/* removeDead() drops the leaves that left the window or lay on the ground long enough. The last
+ * leaf takes the place of a removed one and is checked in turn. */
+static void removeDead(leavesS* leaves_p)
+{
+  int i = 0;
+  while (i < leaves_p->count)
+  {
+    if (leaves_p->x_p[i] >= 0 && leaves_p->lifetime_p[i] > 0)
+    {
+      i++;
+      continue;
+    }
+    int last = --leaves_p->count;
+    leaves_p->x_p[i] = leaves_p->x_p[last];
+    leaves_p->y_p[i] = leaves_p->y_p[last];
+    leaves_p->state_p[i] = leaves_p->state_p[last];
+    leaves_p->mode_p[i] = leaves_p->mode_p[last];
+    leaves_p->lifetime_p[i] = leaves_p->lifetime_p[last];
+    leaves_p->loopType_p[i] = leaves_p->loopType_p[last];
+    leaves_p->loopIndex_p[i] = leaves_p->loopIndex_p[last];
+    leaves_p->random_p[i] = leaves_p->random_p[last];
+  }
+}
+
+// The leaves of one leavesStep(), split into numTasks ranges for the worker pool.
+typedef struct stepContextS
+{
+  leavesS* leaves_p;
+  int numTasks;
+  int windSpeed;
+  bool gust;
+  int groundY;
+} stepContextS;
+
+static void stepTask(void* context_p, int task)
+{
+  stepContextS* step_p = context_p;
+  // Ranges start on multiples of 4, so only the last one has a scalar tail.
+  int groups = (step_p->leaves_p->count + 3) / 4;
+  int first = 4 * (groups * task / step_p->numTasks);
+  int end = 4 * (groups * (task + 1) / step_p->numTasks);
+  if (end > step_p->leaves_p->count) end = step_p->leaves_p->count;
+#ifdef LEAVES_X86
+  if (SDL_HasSSE2())
+  {
+    stepSse2(step_p->leaves_p, first, end, step_p->windSpeed, step_p->gust, step_p->groundY);
+    return;
+  }
+#endif
+  stepScalar(step_p->leaves_p, first, end, step_p->windSpeed, step_p->gust, step_p->groundY);
+}
+
+void leavesStep(leavesS* leaves_p, int windSpeed, bool gust, int groundY)
+{
+  // Every leaf only touches its own slots, so the ranges can be stepped in parallel.
+  stepContextS step = {leaves_p, leaves_p->count / MIN_LEAVES_PER_TASK, windSpeed, gust, groundY};
+  if (step.numTasks > workerPoolSize()) step.numTasks = workerPoolSize();
+  if (step.numTasks < 1) step.numTasks = 1;
+  workerPoolRun(stepTask, &step, step.numTasks);
+  removeDead(leaves_p);
+  leaves_p->rectsValid = false;
+}
+
+const SDL_Rect* leavesRects(leavesS* leaves_p, int state, int size, int* count_p)
+{
+  if (!leaves_p->rectsValid)
+  {
+    // Counting sort by state, so that every state is one run of rectangles.
+    int next[LEAF_NUM_STATES] = {0};
+    for (int i = 0; i < leaves_p->count; i++)
+    {
+      next[leaves_p->state_p[i]]++;
+    }
+    int start = 0;
+    for (int s = 0; s < LEAF_NUM_STATES; s++)
+    {
+      leaves_p->stateStart[s] = start;
+      start += next[s];
+      next[s] = leaves_p->stateStart[s];
+    }
+    leaves_p->stateStart[LEAF_NUM_STATES] = start;
+
+    for (int i = 0; i < leaves_p->count; i++)
+    {
+      SDL_Rect* rect_p = &leaves_p->rects_p[next[leaves_p->state_p[i]]++];
+      rect_p->x = leaves_p->x_p[i];
+      rect_p->y = leaves_p->y_p[i];
+      rect_p->w = size;
+      rect_p->h = size;
+    }
+    leaves_p->rectsValid = true;
+  }
+
+  *count_p = leaves_p->stateStart[state + 1] - leaves_p->stateStart[state];
+  return &leaves_p->rects_p[leaves_p->stateStart[state]];
+}
@@ -0,0 +1,86 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <lensKernel.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LENS_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+#define COLOR_MASK 0x00FFFFFFu
+#define ALPHA_MASK 0xFEu   // The bits of the height that become alpha,
+#define ALPHA_SHIFT 23     // shifted from bits 1-7 into bits 25-31.
+
+typedef void (*lensKernelT)(uint32_t* pixels_p, int count, uint32_t amount);
+
+static void addScalar(uint32_t* pixels_p, int count, uint32_t amount);
+static lensKernelT lensKernel_p = addScalar;
+
+static void addScalar(uint32_t* pixels_p, int count, uint32_t amount)
+{
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t color = (pixels_p[i] + amount) & COLOR_MASK;
+    pixels_p[i] = color | ((color - LENS_FLAT_COLOR) & ALPHA_MASK) << ALPHA_SHIFT;
+  }
+}
+
+#ifdef LENS_KERNEL_X86
+__attribute__((target("sse2")))
+static void addSse2(uint32_t* pixels_p, int count, uint32_t amount)
+{
+  const __m128i add = _mm_set1_epi32((int)amount);
+  const __m128i mask = _mm_set1_epi32((int)COLOR_MASK);
+  const __m128i flat = _mm_set1_epi32((int)LENS_FLAT_COLOR);
+  const __m128i alphaMask = _mm_set1_epi32((int)ALPHA_MASK);
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i pixels = _mm_loadu_si128((const __m128i*)(pixels_p + i));
+    pixels = _mm_and_si128(_mm_add_epi32(pixels, add), mask);
+    __m128i alpha = _mm_slli_epi32(_mm_and_si128(_mm_sub_epi32(pixels, flat), alphaMask), ALPHA_SHIFT);
+    pixels = _mm_or_si128(pixels, alpha);
+    _mm_storeu_si128((__m128i*)(pixels_p + i), pixels);
+  }
+  addScalar(pixels_p + i, count - i, amount);
+}
+
+__attribute__((target("avx2")))
+static void addAvx2(uint32_t* pixels_p, int count, uint32_t amount)
+{
+  const __m256i add = _mm256_set1_epi32((int)amount);
+  const __m256i mask = _mm256_set1_epi32((int)COLOR_MASK);
+  const __m256i flat = _mm256_set1_epi32((int)LENS_FLAT_COLOR);
+  const __m256i alphaMask = _mm256_set1_epi32((int)ALPHA_MASK);
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256i pixels = _mm256_loadu_si256((const __m256i*)(pixels_p + i));
+    pixels = _mm256_and_si256(_mm256_add_epi32(pixels, add), mask);
+    __m256i alpha = _mm256_slli_epi32(_mm256_and_si256(_mm256_sub_epi32(pixels, flat), alphaMask), ALPHA_SHIFT);
+    pixels = _mm256_or_si256(pixels, alpha);
+    _mm256_storeu_si256((__m256i*)(pixels_p + i), pixels);
+  }
+  addScalar(pixels_p + i, count - i, amount);
+}
+#endif
+
+void lensKernelInit(void)
+{
+  lensKernel_p = addScalar;
+#ifdef LENS_KERNEL_X86
+  if (SDL_HasAVX2())
+  {
+    lensKernel_p = addAvx2;
+  }
+  else if (SDL_HasSSE2())
+  {
+    lensKernel_p = addSse2;
+  }
+#endif
+}
+
+void lensAddSpan(uint32_t* pixels_p, int count, uint32_t amount)
+{
+  lensKernel_p(pixels_p, count, amount);
+}
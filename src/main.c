@@ -1,40 +1,121 @@
 #include <SDL.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <render.h>
 #include <score.h>
+#include <redraw.h>
+#include <grid.h>
+#include <replay.h>
+#include <freeSet.h>
+#include <scoreStore.h>
+#include <latency.h>
+#include <typingStats.h>
+#include <eventBus.h>
+#include <spectator.h>
+#include <game.h>
+#include <trace.h>
+
+#define DEFAULT_GRID_SIZE 4
+#define MAX_GRID_SIZE 1024 // Columns or rows.
+#define MAX_FPS 60 // 0 draws frames as fast as possible.
+#define DEFAULT_SEED 1 // What rand() starts with when never seeded.
+#define DEFAULT_SCORE_LOG "scoreboard.log"
+#define LEGACY_SCORE_BOARD "scoreboard.txt" // Read into a new score log.
+// The rules, played on the main thread. Its clock is the time since the game started, spawns
+// are made by the main loop as they fall due instead of by a timer thread.
+static gameS game;
+static uint32_t gameStartMs = 0;
+// The copy of the grid the renderer draws, refreshed from the grid before every frame.
+static char* renderGrid_p = NULL;
+static int renderGridVersion = GRID_NO_VERSION;
+// Playback of a recorded session, see replay.h.
+static bool replaying = false;
+static bool replayFast = false;
+static bool haveReplayEvent = false;
+static replayEventS nextReplayEvent;
+static uint64_t replayStartCounter = 0;
+static bool latencyOverlay = false;
+static bool adaptiveSpawns = false; // Favor the characters the player is weak on.
 
-#define VALUE_FOR_MISS -1;
-#define VALUE_FOR_HIT 2;
-#define GRID_SIZE 4
-#define START_CHAR 33
-#define END_CHAR 126
-#define INVALID_CHAR ' '
-#define INVALID_POS (-1)
-#define NUMBER_OF_CHARS (END_CHAR - START_CHAR)
-#define INTERVAL_COUNT_START 40
-#define INTERVAL_START_MS 1500
-static int score = 0;
-static bool playerLost = false;
-static int charPlaceIntervalMs = INTERVAL_START_MS;
-static int intervalCountDown = INTERVAL_COUNT_START;
-SDL_mutex* myMutex_p;
-static int charPlacementTable[END_CHAR - START_CHAR][2];
-static char grid[GRID_SIZE][GRID_SIZE] = {0};
-
-static int shoot(char inputChar);
 static void gameInputKey(SDL_KeyboardEvent* key_p);
-static Uint32 placeChar(Uint32 interval, void *param);
+static bool handleGameEvent(SDL_Event* event_p);
+static void advanceGame(void);
+static int msUntilNext(void);
+static bool startReplay(const char* path);
+static bool playReplay(void);
+static int replayMsUntilNext(void);
+static void showLatency(void);
+static void drainEventBus(void);
 
 static char applyShift(char input);
-static bool getEmptyPos(int* x_p, int* y_p, char inputChar);
 static void recordScoreAndReset(void);
-static scoreS* insertNewScore(int* nbrOfScores_p, scoreS hiScoreList[]);
 static void resetGame(void);
-static void setGameProgression(bool gameProgressing);
+static void shutDown(void);
 
-int main(void)
+static void charSpawned(void* context_p, int charIndex, int pos);
+static void charHit(void* context_p, int charIndex, int pos);
+static void charMissed(void* context_p, int charIndex);
+static void gameLost(void* context_p);
+static int pickAdaptive(void* context_p, const freeSetS* freeChars_p);
+
+// What the game mirrors on the grid that is drawn, in the statistics and on the event bus.
+static const gameHooksS liveHooks = {charSpawned, charHit, charMissed, gameLost, NULL};
+static const gameHooksS adaptiveHooks = {charSpawned, charHit, charMissed, gameLost, pickAdaptive};
+
+static void printUsage(const char* program)
+{
+  printf("Usage: %s [--grid COLUMNSxROWS] [--seed N] [--record FILE | --replay FILE [--fast]] [--scores FILE] [--trace FILE] [--latency] [--stats FILE] [--adaptive] [--spectate SOCKET]\n", program);
+  printf("  --grid CxR     play on C columns and R rows, %dx%d by default\n", DEFAULT_GRID_SIZE, DEFAULT_GRID_SIZE);
+  printf("  --record FILE  record keys and spawns of the session into FILE\n");
+  printf("  --replay FILE  play a recorded session back\n");
+  printf("  --fast         play back as fast as possible instead of in real time\n");
+  printf("  --scores FILE  keep the scores in the log FILE, %s by default\n", DEFAULT_SCORE_LOG);
+  printf("  --trace FILE   save a Chrome trace of the last frames at exit, needs -DSTORM_TRACE=ON\n");
+  printf("  --latency      show the keystroke to photon latency while playing\n");
+  printf("  --stats FILE   save how every character was hit and missed into FILE at exit\n");
+  printf("  --adaptive     spawn the characters that are slow to hit or often missed more often\n");
+  printf("  --spectate SOCKET  stream the game to spectators connecting to the Unix socket SOCKET\n");
+}
+
+int main(int argc, char* argv[])
 {
+  const char* recordPath = NULL;
+  const char* replayPath = NULL;
+  const char* tracePath = NULL;
+  const char* statsPath = NULL;
+  const char* spectatePath = NULL;
+  const char* scoresPath = DEFAULT_SCORE_LOG;
+  unsigned int seed = DEFAULT_SEED;
+  unsigned int columns = DEFAULT_GRID_SIZE;
+  unsigned int rows = DEFAULT_GRID_SIZE;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--fast") == 0) replayFast = true;
+    else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) tracePath = argv[++i];
+    else if (strcmp(argv[i], "--scores") == 0 && i + 1 < argc) scoresPath = argv[++i];
+    else if (strcmp(argv[i], "--latency") == 0) latencyOverlay = true;
+    else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) statsPath = argv[++i];
+    else if (strcmp(argv[i], "--adaptive") == 0) adaptiveSpawns = true;
+    else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) spectatePath = argv[++i];
+    else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc &&
+             sscanf(argv[i + 1], "%ux%u", &columns, &rows) == 2 &&
+             columns > 0 && columns <= MAX_GRID_SIZE && rows > 0 && rows <= MAX_GRID_SIZE) i++;
+    else
+    {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (recordPath != NULL && replayPath != NULL)
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+
   if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
   {
     printf("Could not initialize SDL Video");
@@ -43,44 +124,166 @@ int main(void)
     printf("SDL Initialized\n");
   }
 
-  renderInit(GRID_SIZE);
+  if (replayPath != NULL)
+  {
+    replayHeaderS header;
+    if (!replayOpen(replayPath, &header))
+    {
+      shutDown();
+      return 1;
+    }
+    if (header.columns == 0 || header.columns > MAX_GRID_SIZE ||
+        header.rows == 0 || header.rows > MAX_GRID_SIZE)
+    {
+      printf("The replay was recorded on a %ux%u grid.\n", header.columns, header.rows);
+      shutDown();
+      return 1;
+    }
+    seed = header.seed;
+    columns = header.columns;
+    rows = header.rows;
+  }
+  srand(seed);
+
+  TRACE_THREAD_NAME("main");
+  eventBusInit();
+  // Without the log the game goes on, with the scores of this run only.
+  scoreStoreInit(scoresPath, LEGACY_SCORE_BOARD);
+  if (renderInit(columns, rows) != 0)
+  {
+    printf("Could not initialize the renderer.\n");
+    shutDown();
+    return 1;
+  }
+  // Fast playback draws every step, the frame cap would only skip them.
+  redrawInit((replayPath != NULL && replayFast) ? 0 : MAX_FPS);
   bool escaped = false;
-  myMutex_p = SDL_CreateMutex();
+  gameRulesS rules = GAME_DEFAULT_RULES;
+  renderGrid_p = malloc(columns * rows);
+  if (!gridInit(columns, rows, GAME_EMPTY_CELL) ||
+      !gameInit(&game, columns, rows, &rules, seed) ||
+      !typingStatsInit(GAME_START_CHAR, GAME_NUM_CHARS))
+  {
+    shutDown();
+    return 1;
+  }
+  if (renderGrid_p == NULL)
+  {
+    printf("Could not allocate a grid of %ux%u.\n", columns, rows);
+    shutDown();
+    return 1;
+  }
+  gameSetHooks(&game, adaptiveSpawns ? &adaptiveHooks : &liveHooks, NULL);
 
   resetGame();
-  setGameProgression(true);
+  // The game goes on without spectators.
+  if (spectatePath != NULL) spectatorStart(spectatePath);
+  if (recordPath != NULL)
+  {
+    replayHeaderS header = {seed, columns, rows};
+    replayStartRecording(recordPath, &header);
+  }
+  if (replayPath != NULL)
+  {
+    // The recording decides what is spawned and when, not the game's clock.
+    escaped = !startReplay(replayPath);
+  }
 
   while (escaped != true)
   {
     SDL_Event event;
-    // Check if we are going to abort.
-    while (SDL_PollEvent(&event))
+    // Sleep until something happens or the next frame is due, then handle all pending events.
+    if (redrawWaitEvent(&event, renderIsAnimated(), msUntilNext()))
     {
-      if (event.type == SDL_KEYDOWN)
+      do
       {
-        if (event.key.keysym.sym == SDLK_ESCAPE) escaped = true;
-        else
-        {
-          gameInputKey(&event.key);
-        }
-      }
+        // Check if we are going to abort.
+        if (handleGameEvent(&event)) escaped = true;
+      } while (SDL_PollEvent(&event));
+    }
+    if (!replaying) advanceGame();
+    drainEventBus();
+    if (replaying && !playReplay())
+    {
+      printf("Replay finished after %.3f s.\n",
+             (double)(SDL_GetPerformanceCounter() - replayStartCounter) / SDL_GetPerformanceFrequency());
+      escaped = true;
     }
     // Render the view to update the playing field and score.
-    render(&grid[0][0], score, charPlaceIntervalMs);
-    if (playerLost)
+    if (redrawBegin(renderIsAnimated()))
     {
-      recordScoreAndReset();
+      gridSnapshot(renderGrid_p, &renderGridVersion);
+      if (latencyOverlay) showLatency();
+      spectatorSetScore(game.score, game.intervalMs);
+      latencyRenderBegin();
+      render(renderGrid_p, game.score, game.intervalMs);
+      latencyPresented();
+    }
+    if (game.lost)
+    {
+      if (replaying)
+      {
+        // The score board keys are not part of the recording, go straight to the next game.
+        resetGame();
+      }
+      else
+      {
+        recordScoreAndReset();
+      }
     }
   }
   printf("Seems like it's ok. Time to quit.\n");
+  if (tracePath != NULL) traceWrite(tracePath);
+  if (latencyCount() > 0) latencyPrint();
+  eventBusStatsS busStats = eventBusStats();
+  printf("Event bus: %u events, at most %u waiting, %u dropped, %u wakeups.\n",
+         busStats.published, busStats.maxDepth, busStats.dropped, busStats.wakeups);
+
+  if (statsPath != NULL) typingStatsSave(statsPath);
+  shutDown();
+  return 0;
+}
 
+/* shutDown() stops and frees whatever main() started, in the order it has to go. Parts that were
+ * never started are skipped, so every way out of main() ends here. */
+static void shutDown(void)
+{
   renderDestroy();
+  scoreStoreDestroy();
+  spectatorStop();
   SDL_Quit();
-  return 0;
+  // After the timers are gone.
+  replayStopRecording();
+  replayClose();
+  typingStatsDestroy();
+  gridDestroy();
+  gameDestroy(&game);
+  free(renderGrid_p);
+  renderGrid_p = NULL;
+}
+
+/*
+ * handleGameEvent() handles one event while the game is running. Returns true when the player
+ * wants to quit.
+ */
+static bool handleGameEvent(SDL_Event* event_p)
+{
+  if (event_p->type == SDL_KEYDOWN)
+  {
+    if (event_p->key.keysym.sym == SDLK_ESCAPE) return true;
+    // During playback the keys come from the recording.
+    if (!replaying)
+    {
+      latencyKeyEvent(event_p->key.timestamp);
+      gameInputKey(&event_p->key);
+    }
+  }
+  return false;
 }
 
 static void gameInputKey(SDL_KeyboardEvent* key_p)
 {
+  replayRecordKey(key_p->keysym.sym, key_p->keysym.mod);
   int symbol = key_p->keysym.sym;
   // check if this is a character and that it can be represented by ascii.
   if ((symbol | 0x40000000) != 0 && symbol < 0x80)
@@ -92,10 +295,54 @@ static void gameInputKey(SDL_KeyboardEvent* key_p)
     } 
 
     // Check if correct symbol and modify score.
-    score += shoot(symbol);
+    latencyShootBegin();
+    {
+      TRACE_SCOPE("shoot");
+      gameShoot(&game, symbol);
+    }
+    latencyShootEnd();
+  }
+}
+
+/*
+ * drainEventBus() takes the events published since the last time, and hands them on to the
+ * spectators. All of them change what is on screen, game.lost decides when the game is over.
+ */
+static void drainEventBus(void)
+{
+  busEventS event;
+  while (eventBusPoll(&event))
+  {
+    switch (event.type)
+    {
+      case BUS_SPAWN:
+      case BUS_HIT:
+      case BUS_MISS:
+      case BUS_WIND:
+      case BUS_GAME_OVER:
+        redrawRequest();
+        break;
+    }
+    spectatorEvent(&event);
   }
 }
 
+/*
+ * showLatency() puts the keystroke to photon latency of the keys so far under the score. The
+ * line is only formatted again when more keys were counted.
+ */
+static void showLatency(void)
+{
+  static uint64_t shownCount = 0;
+  uint64_t count = latencyCount();
+  if (count == shownCount) return;
+  shownCount = count;
+  char text[64];
+  snprintf(text, sizeof(text), "Key to photon p50 %.1f ms p99 %.1f ms",
+           latencyPercentileUs(LATENCY_TOTAL, 0.5) / 1000.0, latencyPercentileUs(LATENCY_TOTAL, 0.99) / 1000.0);
+  renderSetOverlay(text);
+}
+
 static void enterHighScore(scoreS* score_p, SDL_KeyboardEvent* key_p)
 {
   int symbol = key_p->keysym.sym;
@@ -106,6 +353,7 @@ static void enterHighScore(scoreS* score_p, SDL_KeyboardEvent* key_p)
     if (length > 0)
     {
       score_p->name[length - 1] = '\0';
+      redrawRequest();
     }
   }
   else if ((symbol | 0x40000000) != 0 && symbol < 0x80)
@@ -120,6 +368,7 @@ static void enterHighScore(scoreS* score_p, SDL_KeyboardEvent* key_p)
     if (strlen(score_p->name) < MAX_NBR_NAME_CHARS)
     {
       sprintf(score_p->name, "%s%c", score_p->name, symbol);
+      redrawRequest();
       //printf("adding some char to name. Now it is %s\n", score_p->name);
     }
   }
@@ -176,161 +425,138 @@ static char applyShift(char input)
 }
 
 /*
- * shoot() will check if the inputChar is drawn onto the screen. If so it will erase it and give 
- * points. if not, negative points is returned.
+ * advanceGame() makes the spawns that fell due since the last call, recording every decision.
  */
-static int shoot(char inputChar)
+static void advanceGame(void)
 {
-  if (inputChar < START_CHAR || inputChar > END_CHAR) return 0; // Check if this char is in the range we are playing with.
-  int charIndex = inputChar - START_CHAR;
-    
-  // The tables are accessed from event and timer interrupt, so a mutex is used to protect the data
-  SDL_LockMutex(myMutex_p);
-  if (charPlacementTable[charIndex][0] != INVALID_POS)
+  TRACE_SCOPE("placeChar");
+  uint32_t nowMs = SDL_GetTicks() - gameStartMs;
+  while (gameMsUntilSpawn(&game, nowMs) == 0)
   {
-    int x = charPlacementTable[charIndex][0];
-    int y = charPlacementTable[charIndex][1];
-    charPlacementTable[charIndex][0] = INVALID_POS;
-    charPlacementTable[charIndex][1] = INVALID_POS;
-    grid[x][y] = INVALID_CHAR;
-    SDL_UnlockMutex(myMutex_p);
-    return VALUE_FOR_HIT;
+    int charIndex;
+    int pos;
+    gamePickSpawn(&game, &charIndex, &pos);
+    replayRecordSpawn(charIndex, pos);
+    gameSpawn(&game, charIndex, pos);
   }
-
-  SDL_UnlockMutex(myMutex_p);
-  return VALUE_FOR_MISS;
 }
 
 /*
- * placeChar() will pick a random character that is not already on the playing field and then try
- * to put that in the grid. If it fails it will cause a game ending event. Otherwise a new timer 
- * interval will be set up to call back the function again.
+ * msUntilNext() returns how long the main loop may sleep before the next spawn or recorded event
+ * is due, or -1 when nothing is.
  */
-uint32_t placeChar(uint32_t interval, void *param)
+static int msUntilNext(void)
 {
-  int randomNumber = rand();
-
-  // The tables are accessed from event and timer interrupt, so a mutex is used to protect the data
-  SDL_LockMutex(myMutex_p);
-
-  // Loop through all positions starting with the random one.
-  for (int i = 0; i < NUMBER_OF_CHARS; i++)
-  {
-    int charToPlace = (randomNumber + i)% NUMBER_OF_CHARS;
-    if (charPlacementTable[charToPlace][0] == INVALID_POS)
-    {
-      int x, y;
-      // Check if the playing field has an ampty position.
-      // If so, claim it.
-      if (getEmptyPos(&x, &y, (char)(charToPlace + START_CHAR)))
-      {
-        charPlacementTable[charToPlace][0] = x;
-        charPlacementTable[charToPlace][1] = y;
-        break;
-      }
-      else // No place to place char. You have lost. not implemented yet though.
-      {
-        playerLost = true;
-        break;
-      } 
-    }
-  }
+  if (replaying) return replayMsUntilNext();
+  return gameMsUntilSpawn(&game, SDL_GetTicks() - gameStartMs);
+}
 
-  // Make the interval smaller everytime a certain number of characters have been placed.
-  intervalCountDown--;
-  if (intervalCountDown == 0)
-  {
-    intervalCountDown = INTERVAL_COUNT_START;
-    charPlaceIntervalMs = charPlaceIntervalMs * 0.8;
-  }
+static void charSpawned(void* context_p, int charIndex, int pos)
+{
+  gridSet(pos, (char)(charIndex + GAME_START_CHAR));
+  typingStatsSpawn(charIndex);
+  busEventS event = {.type = BUS_SPAWN, .spawn = {charIndex, pos}};
+  eventBusPublish(&event);
+}
 
-  SDL_UnlockMutex(myMutex_p);
+static void charHit(void* context_p, int charIndex, int pos)
+{
+  gridSet(pos, GAME_EMPTY_CELL);
+  typingStatsHit(charIndex);
+  busEventS event = {.type = BUS_HIT, .hit = {charIndex, pos}};
+  eventBusPublish(&event);
+}
 
-  SDL_Event event;
-  SDL_UserEvent userevent;
+static void charMissed(void* context_p, int charIndex)
+{
+  typingStatsMiss(charIndex);
+  busEventS event = {.type = BUS_MISS, .miss = {charIndex, GAME_NONE}};
+  eventBusPublish(&event);
+}
 
-  userevent.type = SDL_USEREVENT;
-  userevent.code = 0;
-  userevent.data1 = &placeChar;
-  userevent.data2 = param;
+static void gameLost(void* context_p)
+{
+  busEventS event = {.type = BUS_GAME_OVER};
+  eventBusPublish(&event);
+}
 
-  event.type = SDL_USEREVENT;
-  event.user = userevent;
+/* pickAdaptive() favors the characters the player is weak on, see typingStats.h. */
+static int pickAdaptive(void* context_p, const freeSetS* freeChars_p)
+{
+  return typingStatsPick(freeChars_p);
+}
 
-  SDL_PushEvent(&event);
-  return(charPlaceIntervalMs);
+static uint64_t replayElapsedUs(void)
+{
+  uint64_t ticks = SDL_GetPerformanceCounter() - replayStartCounter;
+  return (uint64_t)((double)ticks * 1000000 / SDL_GetPerformanceFrequency());
 }
 
 /*
- * getEmptyPos() finds an empty position in the "grid" and inserts the inputChar. It uses the
- * return pointers to deliver the coordinates of the empty position found, and if so TRUE in 
- * the return value. If no empty position is found the function returns FALSE.
+ * startReplay() starts playing back the recording opened with replayOpen().
  */
-static bool getEmptyPos(int* x_p, int* y_p, char inputChar)
+static bool startReplay(const char* path)
 {
-  for (int x = 0; x < GRID_SIZE; x++)
+  haveReplayEvent = replayRead(&nextReplayEvent);
+  if (!haveReplayEvent)
   {
-    for (int y = 0; y < GRID_SIZE; y++)
-    {
-      if (grid[x][y] == INVALID_CHAR)
-      {
-        grid[x][y] = inputChar;
-        *x_p = x;
-        *y_p = y;
-        return true;
-      }
-    }
+    printf("%s has no events.\n", path);
+    return false;
   }
-  return false;
+  replaying = true;
+  replayStartCounter = SDL_GetPerformanceCounter();
+  return true;
 }
 
-static void setGameProgression(bool gameProgressing)
+/*
+ * playReplay() hands the game the recorded events that are due. In fast playback one event is
+ * due per frame. Returns false when the recording has ended.
+ */
+static bool playReplay(void)
 {
-  static SDL_TimerID my_timer_id = -1;
-  if (gameProgressing)
-  {
-    if (my_timer_id == -1)
-    {
-      my_timer_id = SDL_AddTimer(charPlaceIntervalMs, placeChar, 0);
-    }
-    else
-    {
-      printf("Error when starting timer. Already started.\n");
-    }
-  }
-  else
+  uint64_t nowUs = replayFast ? nextReplayEvent.timeUs : replayElapsedUs();
+  while (haveReplayEvent && nextReplayEvent.timeUs <= nowUs)
   {
-    if (my_timer_id != -1)
+    if (nextReplayEvent.type == REPLAY_KEY)
     {
-      SDL_RemoveTimer(my_timer_id);
-      my_timer_id = -1;
+      SDL_KeyboardEvent key = {0};
+      key.type = SDL_KEYDOWN;
+      key.keysym.sym = nextReplayEvent.key.sym;
+      key.keysym.mod = nextReplayEvent.key.mod;
+      gameInputKey(&key);
     }
     else
     {
-      printf("Error when stopping timer. Already stopped.\n");
+      gameSpawn(&game, nextReplayEvent.spawn.charIndex, nextReplayEvent.spawn.pos);
     }
+    haveReplayEvent = replayRead(&nextReplayEvent);
+    if (replayFast) break;
   }
+  return haveReplayEvent;
+}
+
+/*
+ * replayMsUntilNext() returns how long the main loop may sleep before the next recorded event
+ * is due, or -1 when no recording is played.
+ */
+static int replayMsUntilNext(void)
+{
+  if (!replaying) return -1;
+  if (replayFast) return 0;
+  uint64_t nowUs = replayElapsedUs();
+  if (nextReplayEvent.timeUs <= nowUs) return 0;
+  return (int)((nextReplayEvent.timeUs - nowUs + 999) / 1000);
 }
 
 static void recordScoreAndReset(void)
 {
-#define MAX_NO_SCORES 10
-  setGameProgression(false);
+#define MAX_NO_SCORES SCORE_STORE_TOP
+  // Nothing moves behind the score board, so let the background rest.
+  renderSetBackgroundTimer(false);
   scoreS hiScoreList[MAX_NO_SCORES];
-  int nbrOfScores = 0;
-  FILE* scoreFile = fopen("scoreboard.txt", "r");
+  int nbrOfScores = scoreStoreTop(hiScoreList, MAX_NO_SCORES);
 
-  char name[255];
-  int score = 0;
-  while (0 < fscanf(scoreFile, "%s %d\n", name, &score))
-  {
-    snprintf(hiScoreList[nbrOfScores].name, MAX_NBR_NAME_CHARS + 1, "%s", name);
-    hiScoreList[nbrOfScores].score = score;
-    nbrOfScores++;
-  }
-  fclose(scoreFile);
-
-  scoreS* newScore_p = insertNewScore(&nbrOfScores, hiScoreList);
+  scoreS* newScore_p = gameInsertScore(game.score, hiScoreList, &nbrOfScores, MAX_NO_SCORES);
 
 
   // readKeyboard input
@@ -338,14 +564,23 @@ static void recordScoreAndReset(void)
   // while input != enter
   bool nameComplete = (newScore_p == NULL); //If the newScore did not make the score board then no name should entered.
   bool quitScoreView = false;
+  redrawRequest();
   while (quitScoreView != true)
   {
     // For each key press, show the board.
-    renderScoreBoard(hiScoreList, nbrOfScores);
+    if (redrawBegin(false))
+    {
+      // O(log n) over every game played, so looked up again for every key of the name.
+      scoreRankS rank = {game.score, 0, 0, false, 0};
+      scoreStoreRank(game.score, &rank.games, &rank.above); // Leaves games 0 until the log is read.
+      rank.hasBest = newScore_p != NULL && scoreStoreBest(newScore_p->name, &rank.best);
+      renderScoreBoard(hiScoreList, nbrOfScores, &rank);
+    }
 
     SDL_Event event;
-    // Check if we are going to abort.
-    while (SDL_PollEvent(&event))
+    // Sleep until a key is pressed, then handle all pending events.
+    if (!redrawWaitEvent(&event, false, -1)) continue;
+    do
     {
       if (event.type == SDL_KEYDOWN)
       {
@@ -357,69 +592,24 @@ static void recordScoreAndReset(void)
           enterHighScore(newScore_p, &event.key);
         }
       }
-    }
+    } while (SDL_PollEvent(&event));
+    // Events from before the game ended, taken so that the bus wakes the game up again.
+    drainEventBus();
   }
   
   
-  //update score file.
-  scoreFile = fopen("scoreboard.txt", "w");
-  for (int scoreIndex = 0; scoreIndex < nbrOfScores; scoreIndex++)
-  {
-    fprintf(scoreFile, "%s %d\n", hiScoreList[scoreIndex].name, hiScoreList[scoreIndex].score);
-  }
-  fclose(scoreFile);
+  // Every game is kept, the ones off the board without a name. Written in the background.
+  scoreS newScore = {"", game.score};
+  scoreStoreAdd(newScore_p != NULL ? newScore_p : &newScore);
   resetGame();
-  setGameProgression(true);
+  renderSetBackgroundTimer(true);
+  redrawRequest();
 }
 
 static void resetGame()
 {
-
-  score = 0;
-  playerLost = false;
-  charPlaceIntervalMs = INTERVAL_START_MS;
-  // Initialize the placement of the digits to invalid.
-  for (int i = 0; i < (END_CHAR - START_CHAR); i++) 
-  {
-    charPlacementTable[i][0] = INVALID_POS;
-    charPlacementTable[i][1] = INVALID_POS;
-  }
-
+  gameReset(&game);
+  gameStartMs = SDL_GetTicks();
   // Initialize the content of the grid  
-  for (int i = 0; i < (GRID_SIZE * GRID_SIZE); i++) 
-  {
-    grid[i / GRID_SIZE][i % GRID_SIZE] = INVALID_CHAR;
-  }
-}
-
-static scoreS* insertNewScore(int* nbrOfScores_p, scoreS hiScoreList[])
-{
-  int i = 0;
-  scoreS* newScore_p = NULL;
-  while (hiScoreList[i].score > score)
-  {
-    i++;
-    if (i == *nbrOfScores_p) break;
-  }
-  //for (; i < MAX_NO_SCORES; i++)
-  //{
-  //  if (hiScoreList[i]
-  //}
-
-  //change this to start at the current number of entries.
-  for (int pushOutIndex = (MAX_NO_SCORES - 1); pushOutIndex > i ; pushOutIndex--)
-  {
-    memcpy(&hiScoreList[pushOutIndex], &hiScoreList[pushOutIndex-1], sizeof(scoreS)); 
-  }
-
-
-  if (i < MAX_NO_SCORES)
-  {
-    hiScoreList[i].name[0] = '\0';
-    hiScoreList[i].score = score;
-    newScore_p = &hiScoreList[i];
-    if (*nbrOfScores_p < MAX_NO_SCORES) *nbrOfScores_p += 1;
-  }
-
-  return newScore_p;
+  gridFill(GAME_EMPTY_CELL);
 }
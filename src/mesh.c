@@ -0,0 +1,452 @@
+#include <SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mesh.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MESH_X86 1
+#include <immintrin.h>
+#endif
+
+#define LINE_SIZE 1024
+#define START_CAPACITY 64
+#define NEAR_Z -1.0f      // Faces with a vertex closer to the camera than this are not drawn.
+#define MIN_SHADE 64      // Of 255, for faces seen edge on.
+#define OUTLINE_WIDTH 1.0f
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES (32 / RADIX_BITS)
+
+/* growArray() doubles the capacity of an array until it holds needed elements. */
+static bool growArray(void** array_pp, int* capacity_p, int needed, size_t elementSize)
+{
+  if (needed <= *capacity_p) return true;
+  int capacity = (*capacity_p == 0) ? START_CAPACITY : *capacity_p;
+  while (capacity < needed) capacity *= 2;
+  void* array_p = realloc(*array_pp, capacity * elementSize);
+  if (array_p == NULL) return false;
+  *array_pp = array_p;
+  *capacity_p = capacity;
+  return true;
+}
+
+/* parseFace() adds the vertex indices of an f line, turned into 0 based indices. Returns the
+ * number of indices added, or -1 if one of them does not name a vertex read so far. */
+static int parseFace(meshS* mesh_p, const char* line_p, int* indexCapacity_p, int numIndices)
+{
+  int added = 0;
+  char* end_p;
+  while (true)
+  {
+    long index = strtol(line_p, &end_p, 10);
+    if (end_p == line_p) break;
+    // Texture and normal indices after the slashes are not used.
+    line_p = end_p;
+    while (*line_p != '\0' && *line_p != ' ' && *line_p != '\t') line_p++;
+
+    if (index < 0) index += mesh_p->numVertices + 1;
+    if (index < 1 || index > mesh_p->numVertices) return -1;
+    if (!growArray((void**)&mesh_p->faceIndices_p, indexCapacity_p, numIndices + added + 1, sizeof(int)))
+    {
+      return -1;
+    }
+    mesh_p->faceIndices_p[numIndices + added] = index - 1;
+    added++;
+  }
+  return added;
+}
+
+/* allocateFrameBuffers() makes room for the worst frame, every face drawn filled and outlined. */
+static bool allocateFrameBuffers(meshS* mesh_p)
+{
+  int numVertices = 0;
+  int numIndices = 0;
+  for (int face = 0; face < mesh_p->numFaces; face++)
+  {
+    int corners = mesh_p->faceStart_p[face + 1] - mesh_p->faceStart_p[face];
+    numVertices += corners + 4 * corners;
+    numIndices += 3 * (corners - 2) + 6 * corners;
+  }
+  mesh_p->view_p = malloc(mesh_p->numVertices * 4 * sizeof(float));
+  mesh_p->screen_p = malloc(mesh_p->numVertices * sizeof(SDL_FPoint));
+  mesh_p->keys_p = malloc(mesh_p->numFaces * sizeof(uint32_t));
+  mesh_p->keysTemp_p = malloc(mesh_p->numFaces * sizeof(uint32_t));
+  mesh_p->order_p = malloc(mesh_p->numFaces * sizeof(int));
+  mesh_p->orderTemp_p = malloc(mesh_p->numFaces * sizeof(int));
+  mesh_p->shade_p = malloc(mesh_p->numFaces);
+  mesh_p->vertices_p = malloc(numVertices * sizeof(SDL_Vertex));
+  mesh_p->indices_p = malloc(numIndices * sizeof(int));
+  return mesh_p->view_p != NULL && mesh_p->screen_p != NULL && mesh_p->keys_p != NULL &&
+         mesh_p->keysTemp_p != NULL && mesh_p->order_p != NULL && mesh_p->orderTemp_p != NULL &&
+         mesh_p->shade_p != NULL && mesh_p->vertices_p != NULL && mesh_p->indices_p != NULL;
+}
+
+bool meshLoadObj(meshS* mesh_p, const char* path_p)
+{
+  memset(mesh_p, 0, sizeof(meshS));
+  FILE* file_p = fopen(path_p, "r");
+  if (file_p == NULL)
+  {
+    printf("Could not open mesh %s.\n", path_p);
+    return false;
+  }
+
+  int vertexCapacity = 0;
+  int faceCapacity = 0;
+  int indexCapacity = 0;
+  int numIndices = 0;
+  int lineNumber = 0;
+  bool ok = growArray((void**)&mesh_p->faceStart_p, &faceCapacity, 1, sizeof(int));
+  char line[LINE_SIZE];
+  while (ok && fgets(line, LINE_SIZE, file_p) != NULL)
+  {
+    lineNumber++;
+    if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t'))
+    {
+      float x, y, z;
+      if (sscanf(line + 2, "%f %f %f", &x, &y, &z) != 3)
+      {
+        printf("Bad vertex on line %d of %s.\n", lineNumber, path_p);
+        ok = false;
+      }
+      else if ((ok = growArray((void**)&mesh_p->positions_p, &vertexCapacity, 4 * (mesh_p->numVertices + 1), sizeof(float))))
+      {
+        float* position_p = &mesh_p->positions_p[4 * mesh_p->numVertices++];
+        position_p[0] = x;
+        position_p[1] = y;
+        position_p[2] = z;
+        position_p[3] = 1.0f;
+      }
+    }
+    else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+    {
+      int corners = parseFace(mesh_p, line + 2, &indexCapacity, numIndices);
+      if (corners < 3)
+      {
+        printf("Bad face on line %d of %s.\n", lineNumber, path_p);
+        ok = false;
+      }
+      else if ((ok = growArray((void**)&mesh_p->faceStart_p, &faceCapacity, mesh_p->numFaces + 2, sizeof(int))))
+      {
+        numIndices += corners;
+        mesh_p->faceStart_p[++mesh_p->numFaces] = numIndices;
+      }
+    }
+  }
+  fclose(file_p);
+
+  if (ok && mesh_p->numFaces == 0)
+  {
+    printf("No faces in mesh %s.\n", path_p);
+    ok = false;
+  }
+  if (ok && !allocateFrameBuffers(mesh_p))
+  {
+    printf("Could not allocate mesh %s.\n", path_p);
+    ok = false;
+  }
+  if (!ok)
+  {
+    meshDestroy(mesh_p);
+    return false;
+  }
+  return true;
+}
+
+void meshDestroy(meshS* mesh_p)
+{
+  free(mesh_p->positions_p);
+  free(mesh_p->view_p);
+  free(mesh_p->screen_p);
+  free(mesh_p->faceStart_p);
+  free(mesh_p->faceIndices_p);
+  free(mesh_p->keys_p);
+  free(mesh_p->keysTemp_p);
+  free(mesh_p->order_p);
+  free(mesh_p->orderTemp_p);
+  free(mesh_p->shade_p);
+  free(mesh_p->vertices_p);
+  free(mesh_p->indices_p);
+  memset(mesh_p, 0, sizeof(meshS));
+}
+
+/*
+ * buildMatrix() makes the column major 4x4 matrix that scales, rotates by the orientation,
+ * z then y then x, and moves the mesh view_p->distance down the view axis.
+ */
+static void buildMatrix(const meshS* mesh_p, const meshViewS* view_p, float matrix[16])
+{
+  float cx = fixedToDouble(fixedCos(mesh_p->orientation[0]));
+  float sx = fixedToDouble(fixedSin(mesh_p->orientation[0]));
+  float cy = fixedToDouble(fixedCos(mesh_p->orientation[1]));
+  float sy = fixedToDouble(fixedSin(mesh_p->orientation[1]));
+  float cz = fixedToDouble(fixedCos(mesh_p->orientation[2]));
+  float sz = fixedToDouble(fixedSin(mesh_p->orientation[2]));
+  // Rx * Ry * Rz, row by row.
+  float rotation[3][3] =
+  {
+    {cy * cz, -cy * sz, sy},
+    {sx * sy * cz + cx * sz, -sx * sy * sz + cx * cz, -sx * cy},
+    {-cx * sy * cz + sx * sz, cx * sy * sz + sx * cz, cx * cy}
+  };
+  for (int column = 0; column < 3; column++)
+  {
+    for (int row = 0; row < 3; row++)
+    {
+      matrix[column * 4 + row] = view_p->scale * rotation[row][column];
+    }
+    matrix[column * 4 + 3] = 0.0f;
+  }
+  matrix[12] = 0.0f;
+  matrix[13] = 0.0f;
+  matrix[14] = view_p->distance;
+  matrix[15] = 1.0f;
+}
+
+static void transformScalar(const float matrix[16], const float* in_p, float* out_p, int count)
+{
+  for (int i = 0; i < count; i++, in_p += 4, out_p += 4)
+  {
+    for (int row = 0; row < 4; row++)
+    {
+      out_p[row] = matrix[row] * in_p[0] + matrix[4 + row] * in_p[1] +
+                   matrix[8 + row] * in_p[2] + matrix[12 + row] * in_p[3];
+    }
+  }
+}
+
+#ifdef MESH_X86
+/* One vertex per iteration, every component of the vertex times a column of the matrix. */
+__attribute__((target("sse2")))
+static void transformSse2(const float matrix[16], const float* in_p, float* out_p, int count)
+{
+  const __m128 column0 = _mm_loadu_ps(&matrix[0]);
+  const __m128 column1 = _mm_loadu_ps(&matrix[4]);
+  const __m128 column2 = _mm_loadu_ps(&matrix[8]);
+  const __m128 column3 = _mm_loadu_ps(&matrix[12]);
+  for (int i = 0; i < count; i++, in_p += 4, out_p += 4)
+  {
+    __m128 vertex = _mm_loadu_ps(in_p);
+    __m128 result = _mm_mul_ps(column0, _mm_shuffle_ps(vertex, vertex, _MM_SHUFFLE(0, 0, 0, 0)));
+    result = _mm_add_ps(result, _mm_mul_ps(column1, _mm_shuffle_ps(vertex, vertex, _MM_SHUFFLE(1, 1, 1, 1))));
+    result = _mm_add_ps(result, _mm_mul_ps(column2, _mm_shuffle_ps(vertex, vertex, _MM_SHUFFLE(2, 2, 2, 2))));
+    result = _mm_add_ps(result, _mm_mul_ps(column3, _mm_shuffle_ps(vertex, vertex, _MM_SHUFFLE(3, 3, 3, 3))));
+    _mm_storeu_ps(out_p, result);
+  }
+}
+#endif
+
+static void transform(const float matrix[16], const float* in_p, float* out_p, int count)
+{
+#ifdef MESH_X86
+  if (SDL_HasSSE2())
+  {
+    transformSse2(matrix, in_p, out_p, count);
+    return;
+  }
+#endif
+  transformScalar(matrix, in_p, out_p, count);
+}
+
+/* depthKey() maps a float onto an unsigned integer with the same order. */
+static uint32_t depthKey(float depth)
+{
+  uint32_t bits;
+  memcpy(&bits, &depth, sizeof(bits));
+  return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+/*
+ * cullFaces() puts the faces turned towards the camera, and in front of it, in order_p with
+ * their depth keys, and returns how many there are. Also shades them.
+ */
+static int cullFaces(meshS* mesh_p)
+{
+  const float* view_p = mesh_p->view_p;
+  int numVisible = 0;
+  for (int face = 0; face < mesh_p->numFaces; face++)
+  {
+    const int* index_p = &mesh_p->faceIndices_p[mesh_p->faceStart_p[face]];
+    int corners = mesh_p->faceStart_p[face + 1] - mesh_p->faceStart_p[face];
+    const float* a_p = &view_p[4 * index_p[0]];
+    const float* b_p = &view_p[4 * index_p[1]];
+    const float* c_p = &view_p[4 * index_p[2]];
+    float abX = b_p[0] - a_p[0], abY = b_p[1] - a_p[1], abZ = b_p[2] - a_p[2];
+    float acX = c_p[0] - a_p[0], acY = c_p[1] - a_p[1], acZ = c_p[2] - a_p[2];
+    float normalX = abY * acZ - abZ * acY;
+    float normalY = abZ * acX - abX * acZ;
+    float normalZ = abX * acY - abY * acX;
+    // The camera is at the origin, a front face has its normal against the view ray to it.
+    float facing = -(normalX * a_p[0] + normalY * a_p[1] + normalZ * a_p[2]);
+    if (facing <= 0.0f) continue;
+
+    float depth = 0.0f;
+    bool inFront = true;
+    for (int corner = 0; corner < corners; corner++)
+    {
+      float z = view_p[4 * index_p[corner] + 2];
+      inFront &= (z < NEAR_Z);
+      depth += z;
+    }
+    if (!inFront) continue;
+
+    float length = sqrtf((normalX * normalX + normalY * normalY + normalZ * normalZ) *
+                         (a_p[0] * a_p[0] + a_p[1] * a_p[1] + a_p[2] * a_p[2]));
+    mesh_p->shade_p[face] = MIN_SHADE + (uint8_t)((255 - MIN_SHADE) * fminf(facing / length, 1.0f));
+    // Back to front is increasing z, the camera looks down negative z.
+    mesh_p->keys_p[numVisible] = depthKey(depth / corners);
+    mesh_p->order_p[numVisible] = face;
+    numVisible++;
+  }
+  return numVisible;
+}
+
+/*
+ * sortFaces() sorts the first count faces of order_p by their keys, least significant byte
+ * first. Bytes that are the same in every key are skipped, they would not move anything.
+ */
+static void sortFaces(meshS* mesh_p, int count)
+{
+  static int histograms[RADIX_PASSES][RADIX_SIZE];
+  memset(histograms, 0, sizeof(histograms));
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t key = mesh_p->keys_p[i];
+    for (int pass = 0; pass < RADIX_PASSES; pass++)
+    {
+      histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+    }
+  }
+
+  for (int pass = 0; pass < RADIX_PASSES; pass++)
+  {
+    int* histogram = histograms[pass];
+    int shift = pass * RADIX_BITS;
+    if (histogram[(mesh_p->keys_p[0] >> shift) & (RADIX_SIZE - 1)] == count) continue;
+
+    int offset = 0;
+    for (int digit = 0; digit < RADIX_SIZE; digit++)
+    {
+      int digitCount = histogram[digit];
+      histogram[digit] = offset;
+      offset += digitCount;
+    }
+    for (int i = 0; i < count; i++)
+    {
+      uint32_t key = mesh_p->keys_p[i];
+      int slot = histogram[(key >> shift) & (RADIX_SIZE - 1)]++;
+      mesh_p->keysTemp_p[slot] = key;
+      mesh_p->orderTemp_p[slot] = mesh_p->order_p[i];
+    }
+    uint32_t* keys_p = mesh_p->keys_p;
+    mesh_p->keys_p = mesh_p->keysTemp_p;
+    mesh_p->keysTemp_p = keys_p;
+    int* order_p = mesh_p->order_p;
+    mesh_p->order_p = mesh_p->orderTemp_p;
+    mesh_p->orderTemp_p = order_p;
+  }
+}
+
+static SDL_Vertex meshVertex(SDL_FPoint position, SDL_Color color)
+{
+  SDL_Vertex vertex;
+  vertex.position = position;
+  vertex.color = color;
+  vertex.tex_coord.x = 0.0f;
+  vertex.tex_coord.y = 0.0f;
+  return vertex;
+}
+
+void meshDraw(meshS* mesh_p, SDL_Renderer* renderer_p, const meshViewS* view_p)
+{
+  float matrix[16];
+  buildMatrix(mesh_p, view_p, matrix);
+  transform(matrix, mesh_p->positions_p, mesh_p->view_p, mesh_p->numVertices);
+
+  // Each vertex is projected once, however many faces share it.
+  for (int i = 0; i < mesh_p->numVertices; i++)
+  {
+    const float* position_p = &mesh_p->view_p[4 * i];
+    mesh_p->screen_p[i].x = view_p->focalLength * position_p[0] / position_p[2] + view_p->centerX;
+    mesh_p->screen_p[i].y = view_p->focalLength * position_p[1] / position_p[2] + view_p->centerY;
+  }
+
+  int numVisible = cullFaces(mesh_p);
+  if (numVisible == 0) return;
+  sortFaces(mesh_p, numVisible);
+
+  int numVertices = 0;
+  int numIndices = 0;
+  SDL_Vertex* vertices_p = mesh_p->vertices_p;
+  int* indices_p = mesh_p->indices_p;
+  for (int i = 0; i < numVisible; i++)
+  {
+    int face = mesh_p->order_p[i];
+    const int* index_p = &mesh_p->faceIndices_p[mesh_p->faceStart_p[face]];
+    int corners = mesh_p->faceStart_p[face + 1] - mesh_p->faceStart_p[face];
+
+    if (view_p->flags & MESH_FILL)
+    {
+      int shade = mesh_p->shade_p[face];
+      SDL_Color color = {view_p->fill.r * shade / 255,
+                         view_p->fill.g * shade / 255,
+                         view_p->fill.b * shade / 255,
+                         view_p->fill.a};
+      for (int corner = 0; corner < corners; corner++)
+      {
+        vertices_p[numVertices + corner] = meshVertex(mesh_p->screen_p[index_p[corner]], color);
+      }
+      // A fan from the first corner, faces are convex.
+      for (int corner = 1; corner + 1 < corners; corner++)
+      {
+        indices_p[numIndices++] = numVertices;
+        indices_p[numIndices++] = numVertices + corner;
+        indices_p[numIndices++] = numVertices + corner + 1;
+      }
+      numVertices += corners;
+    }
+
+    if (view_p->flags & MESH_OUTLINE)
+    {
+      // Every edge as a quad, SDL has no batched lines.
+      for (int corner = 0; corner < corners; corner++)
+      {
+        SDL_FPoint start = mesh_p->screen_p[index_p[corner]];
+        SDL_FPoint end = mesh_p->screen_p[index_p[(corner + 1) % corners]];
+        float dx = end.x - start.x;
+        float dy = end.y - start.y;
+        float length = sqrtf(dx * dx + dy * dy);
+        if (length < 0.001f) continue;
+        float offsetX = -dy / length * (OUTLINE_WIDTH / 2);
+        float offsetY = dx / length * (OUTLINE_WIDTH / 2);
+        SDL_FPoint quad[4] =
+        {
+          {start.x + offsetX, start.y + offsetY},
+          {end.x + offsetX, end.y + offsetY},
+          {end.x - offsetX, end.y - offsetY},
+          {start.x - offsetX, start.y - offsetY}
+        };
+        for (int q = 0; q < 4; q++)
+        {
+          vertices_p[numVertices + q] = meshVertex(quad[q], view_p->outline);
+        }
+        indices_p[numIndices++] = numVertices;
+        indices_p[numIndices++] = numVertices + 1;
+        indices_p[numIndices++] = numVertices + 2;
+        indices_p[numIndices++] = numVertices + 2;
+        indices_p[numIndices++] = numVertices + 3;
+        indices_p[numIndices++] = numVertices;
+        numVertices += 4;
+      }
+    }
+  }
+
+  if (numIndices > 0 && SDL_RenderGeometry(renderer_p,
+                                           NULL,
+                                           vertices_p,
+                                           numVertices,
+                                           indices_p,
+                                           numIndices)) printf("Error when RenderGeometry: %s\n", SDL_GetError());
+}
@@ -0,0 +1,50 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <redraw.h>
+
+static SDL_atomic_t redrawRequested = {1}; // The first frame always has to be drawn.
+static Uint32 frameIntervalMs = 0;
+static Uint32 lastFrameMs = 0;
+
+void redrawInit(int maxFps)
+{
+  frameIntervalMs = (maxFps > 0) ? 1000 / maxFps : 0;
+  lastFrameMs = SDL_GetTicks() - frameIntervalMs;
+  SDL_AtomicSet(&redrawRequested, 1);
+}
+
+void redrawRequest(void)
+{
+  SDL_AtomicSet(&redrawRequested, 1);
+}
+
+/* Milliseconds until the frame cap allows the next frame. */
+static Uint32 msUntilNextFrame(void)
+{
+  Uint32 sinceLastFrame = SDL_GetTicks() - lastFrameMs;
+  return (sinceLastFrame < frameIntervalMs) ? frameIntervalMs - sinceLastFrame : 0;
+}
+
+bool redrawWaitEvent(SDL_Event* event_p, bool animating, int maxWaitMs)
+{
+  if (!animating && SDL_AtomicGet(&redrawRequested) == 0)
+  {
+    // Nothing to draw until something happens. Timers wake us up through the event bus.
+    if (maxWaitMs < 0) return SDL_WaitEvent(event_p) == 1;
+    return SDL_WaitEventTimeout(event_p, maxWaitMs) == 1;
+  }
+  Uint32 waitMs = msUntilNextFrame();
+  if (maxWaitMs >= 0 && (Uint32)maxWaitMs < waitMs) waitMs = maxWaitMs;
+  return SDL_WaitEventTimeout(event_p, waitMs) == 1;
+}
+
+bool redrawBegin(bool animating)
+{
+  if (!animating && SDL_AtomicGet(&redrawRequested) == 0) return false;
+  if (msUntilNextFrame() > 0) return false;
+
+  // Cleared before drawing, so a request made while drawing gives one more frame.
+  SDL_AtomicSet(&redrawRequested, 0);
+  lastFrameMs = SDL_GetTicks();
+  return true;
+}
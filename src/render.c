@@ -3,13 +3,26 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <render.h>
+#include <lensKernel.h>
+#include <bumpMap.h>
+#include <glyphBatch.h>
+#include <hudCache.h>
+#include <redraw.h>
+#include <leaves.h>
+#include <stringRaster.h>
+#include <fixedTrig.h>
+#include <mesh.h>
+#include <workerPool.h>
+#include <world.h>
+#include <atlas.h>
+#include <trace.h>
 
 // DEFINES
 #define PIXEL_SIZE 5
 #define SHINE 0xA0
 #define SHADE 0xA0
-#define STRING_LENGTH (WIN_WIDTH + 2 * PIXEL_SIZE) // One datapoint before visible and one after
 #define CYLINDER_HEIGHT 150
 #define CYLINDER_HEIGHT 150
 #define WIN_WIDTH 640
@@ -17,148 +30,154 @@
 #define WIN_FLAGS 0 //SDL_WINDOW_FULLSCREEN
 #define FIRST_AVAILABLE_RENDERER -1
 #define RENDERER_FLAGS SDL_RENDERER_ACCELERATED
-#define MAX_NUM_LEAVES 1000
-#define NUM_LEAF_STATES 4
+#define MAX_NUM_LEAVES 100000
+#define LEAF_SIZE 3
 #define TREE_X (WIN_WIDTH - 200)
 #define TREE_Y (WIN_HEIGHT - 175)
 #define GROUND_LEVEL 40
 #define MOUNTAIN_LEVEL 85
-#define CLOUD_MAX_SPEED 10
-#define MAX_NUM_CLOUDS 20
-#define NUM_LOOP_TYPES 3
-#define MAX_LOOP_LENGTH 17
-#define MAX_PHI 2.5
+#define BACKGROUND_INTERVAL_MS 100
+#define NUM_WIND_STATES 3 // windSpeed is 0, 4 or 8.
+#define MAX_WORKER_THREADS 7
+#define STRING_COLUMNS (WIN_WIDTH / PIXEL_SIZE)
+#define HIGHLIGHT_X 100 // Where the highlight colours are in the leaves bitmap.
+#define HIGHLIGHT_Y 87
+#define MAX_HIGHLIGHT_SIZE 16
+#define MESH_FILE "torus.obj" // Next to the executable, like the atlas.
+#define MAX_PATH_SIZE 1024
+#define MESH_FOCAL_LENGTH 100 // Screen pixels per unit of x / z.
+#define MESH_DISTANCE -300
+#define MESH_SCALE 100
 
 #define FONT_WIDTH 35
 #define FONT_HEIGHT 75
 #define FONT_SIZE_RATIO ((float)FONT_WIDTH / (float)FONT_HEIGHT)
-typedef struct leaf
-{
-  int state;
-  int x;
-  int y;
-  bool onGround;
-  int lifetime;
-  bool loop;
-  int loopIndex;
-  int loopType;
-} leafS;
-
-struct coord {
-    double x;
-    double y;
-    double z;
-};
-struct face {
-    struct coord *coords[4];
-};
-
-struct cube {
-    struct face faces[6];
-    struct face *sortedFaces[6];
-};
-
-typedef struct string
-{
-  int state;
-  int x;
-  double y;
-  double last_y;
-  double phi;
-  double last_phi;
-} stringS;
-
-typedef struct loopS
-{
-  int x;
-  int y;
-} loopS;
-
-leafS leaves[MAX_NUM_LEAVES];
-stringS strings[STRING_LENGTH];
-int numLeaves = 0;
-
-typedef struct cloudS
-{
-  int state;
-  int x;
-  int y;
-  int height;
-  int width;
-  int spriteY;
-  int speed;
-} cloudS;
-
-int bumpMap[WIN_WIDTH][WIN_HEIGHT];
-
-cloudS clouds[MAX_NUM_CLOUDS];
-int numClouds = 0;
+#define STRING_SIZE 100
+#define SCORE_CHAR_SIZE 25
+#define OVERLAY_CHAR_SIZE 14
+#define SCOREBOARD_START_Y 40
+#define SCOREBOARD_CHAR_SIZE ((WIN_HEIGHT - 2 * SCOREBOARD_START_Y) / 12)
+#define SCOREBOARD_INFO_CHAR_SIZE 20
+#define SCOREBOARD_MAX_ENTRIES 10
+// The colour of every leaf state, picked from the leaves bitmap.
+static SDL_Color leafColors[LEAF_NUM_STATES];
+
+#define LENS_BUMP_RADIUS 10
+#define LENS_BUMP_AMOUNT 10
+static bumpMapS bumpMap;
+
+// The static passes at the back, rendered into a texture per wind state.
+typedef struct backgroundLayerS
+{
+  SDL_Texture* texture_p;
+  unsigned int passes; // The passes the texture holds.
+} backgroundLayerS;
+static backgroundLayerS backgroundLayers[NUM_WIND_STATES];
+#define LAYER_PASSES (RENDER_PASS_BIT(RENDER_PASS_SKY) | \
+                      RENDER_PASS_BIT(RENDER_PASS_GROUND) | \
+                      RENDER_PASS_BIT(RENDER_PASS_TREE))
+// Passes drawn between the ground and the tree. The tree can only join the layer without them.
+#define MIDDLE_PASSES (RENDER_PASS_BIT(RENDER_PASS_CLOUDS) | \
+                       RENDER_PASS_BIT(RENDER_PASS_LEAVES) | \
+                       RENDER_PASS_BIT(RENDER_PASS_STRING))
 
 int cylinderTextureHeight;
 int cylinderTextureWidth;
 
-#define L_U 3 // the min unit of loop movement
-loopS loops[NUM_LOOP_TYPES][MAX_LOOP_LENGTH] =
-{
-  {{.x = -2, .y= -1},{.x=0, .y=-4},{.x=4, .y=0},{.x=0, .y=-4}},
-  {{},{},{},{},{},{},{},{}},
-  {{},{},{},{},{},{},{},{},{},{},{},{},{},{},{},{}}
-};
-
-int maxLoopIndex[NUM_LOOP_TYPES] = {4, 8, 16};
 
 static SDL_Window* myWindow_p;
 static SDL_Renderer* myRenderer_p;
 static SDL_Texture* asciiTexture_p;
-static SDL_Texture* cloudTexture_p;
-static SDL_Texture* leavesTexture_p;
-static SDL_Texture* cylinderTexture_p;
-static int gridSize = 0;
-static int windSpeed = 0;
-static double lightAngle = 0;
-static struct cube cube;
+static SDL_Texture* spritesTexture_p; // The leaves and clouds images, one above the other.
+static SDL_Point leavesOrigin;        // Where the images are in the sprites texture.
+static SDL_Point cloudsOrigin;
+static SDL_Texture* lensTexture_p;
+static int gridColumns = 0;
+static int gridRows = 0;
+static glyphLayoutS gridLayout;
+static hudLineS scoreLine;
+static hudLineS overlayLine;
+static char overlayText[HUD_LINE_SIZE];
+static hudLineS scoreBoardHeaderLine;
+static hudLineS scoreBoardLines[SCOREBOARD_MAX_ENTRIES];
+static hudLineS scoreBoardInfoLine;
+static hudLineS scoreBoardRankLine;
+static meshS mesh;
+static bool meshLoaded = false;
+static unsigned int enabledPasses = RENDER_DEFAULT_PASSES;
+static renderPassTimerT passTimer_p = NULL;
+static uint64_t lensBumpsApplied = 0;
+static bool backgroundTimer = false;
+
+static const char* passNames[RENDER_NUM_PASSES] =
+{
+  [RENDER_PASS_BACKGROUND] = "background layer",
+  [RENDER_PASS_SKY] = "drawSky",
+  [RENDER_PASS_GROUND] = "drawGround",
+  [RENDER_PASS_CLOUDS] = "drawClouds",
+  [RENDER_PASS_LEAVES] = "drawLeaves",
+  [RENDER_PASS_STRING] = "drawString",
+  [RENDER_PASS_TREE] = "drawTree",
+  [RENDER_PASS_LENS] = "drawLens",
+  [RENDER_PASS_MESH] = "drawMesh",
+  [RENDER_PASS_GRID] = "glyph grid",
+  [RENDER_PASS_GLYPHS] = "glyph batch",
+  [RENDER_PASS_SCORE] = "drawScore",
+};
 
 static void initLens(void);
-static void updateLens(void);
-static void drawLens(void);
-static void calcSourceRect(SDL_Rect* rect, char inputChar);
+static void drawLens(const worldSnapshotS* world_p);
 static void drawScore(int score, int intervalMs);
-static void drawLeaves();
-static void drawString();
-static void drawTree();
+static void drawGrid(char* input_p);
+static bool initTextLayouts(void);
+static void initHudLines(void);
+static void destroyHudLines(void);
+static void drawLeaves(const worldSnapshotS* world_p);
+static void initLeafColors(const atlasImageS* leaves_p);
+static SDL_Color imageColor(const atlasImageS* image_p, int x, int y);
+static bool initStringRaster(const atlasImageS* cylinder_p, const SDL_Color* highlight_p);
+static void drawString(const worldSnapshotS* world_p);
+static void drawTree(int wind);
+static unsigned int drawBackgroundLayer(int wind);
+static void destroyBackgroundLayers(void);
 static void drawGround();
 static void drawSky();
-static void drawClouds();
-static void removeCloud();
-static void createCloud();
+static void drawClouds(const worldSnapshotS* world_p);
 static void drawText(char* string, int charSize, int x, int y);
-static void initLoops();
 static void stringWarpInit();
-static void initStrings();
-static void initCube();
-static void updateCube();
-static void drawCube();
-static void faceSortInsert(struct face *thisFace, struct face **sortedFaces);
-
-uint32_t updateBackground(uint32_t interval, void* parameters);
-static void updateString();
+static void drawMesh(const worldSnapshotS* world_p);
+static void assetPath(char* path_p, size_t size, const char* name_p);
 
 void renderDestroy(void)
 {
+  glyphLayoutDestroy(&gridLayout);
+  destroyHudLines();
+  glyphBatchDestroy();
   SDL_DestroyTexture(asciiTexture_p);
-  SDL_DestroyTexture(leavesTexture_p);
-  SDL_DestroyTexture(cylinderTexture_p);
-}
-
-int renderInit(int gridSizeInput)
-{
-  initLoops();
-  initStrings();
+  SDL_DestroyTexture(spritesTexture_p);
+  stringRasterDestroy();
+  atlasClose();
+  worldDestroy();
+  workerPoolDestroy();
+  SDL_DestroyTexture(lensTexture_p);
+  bumpMapDestroy(&bumpMap);
+  if (meshLoaded) meshDestroy(&mesh);
+  meshLoaded = false;
+  destroyBackgroundLayers();
+}
+
+int renderInit(int columns, int rows)
+{
+  TRACE_SCOPE("renderInit");
+  fixedTrigInit();
   stringWarpInit();
   initLens();
-  initCube();
+  char path[MAX_PATH_SIZE];
+  assetPath(path, sizeof(path), MESH_FILE);
+  meshLoaded = meshLoadObj(&mesh, path);
 
-  gridSize = gridSizeInput;
+  gridColumns = columns;
+  gridRows = rows;
   myWindow_p = SDL_CreateWindow("Storm Clacker - typing in the wind.", 0, 0, WIN_WIDTH, WIN_HEIGHT, WIN_FLAGS);
   if (myWindow_p == NULL)
   {
@@ -178,177 +197,315 @@ myRenderer_p = SDL_CreateRenderer(
 
   // Set size of renderer to the same as window
   SDL_RenderSetLogicalSize(myRenderer_p, WIN_WIDTH, WIN_HEIGHT);
+
+  // The effects drawn on the CPU share one thread per core.
+  int workerThreads = SDL_GetCPUCount() - 1;
+  if (workerThreads > MAX_WORKER_THREADS) workerThreads = MAX_WORKER_THREADS;
+  if (!workerPoolInit(workerThreads > 0 ? workerThreads : 0)) return -1;
+
+  // The background is simulated on a thread of its own, the leaves on the worker pool too.
+  worldConfigS worldConfig =
+  {
+    .width = WIN_WIDTH,
+    .height = WIN_HEIGHT,
+    .groundY = WIN_HEIGHT - GROUND_LEVEL,
+    .treeX = TREE_X,
+    .treeY = TREE_Y,
+    .maxLeaves = MAX_NUM_LEAVES,
+    .leafSize = LEAF_SIZE,
+    .stringColumns = STRING_COLUMNS,
+    .cellSize = PIXEL_SIZE,
+    .stringHeight = 0, // Set once the cylinder bitmap is loaded, see below.
+    .lensBumpSize = 2 * LENS_BUMP_RADIUS,
+    .tickMs = BACKGROUND_INTERVAL_MS,
+    .seed = rand(),
+  };
   
-  // Create the texture that will be used to print background.
-  SDL_Surface* surface;
-  if (NULL == (surface = SDL_LoadBMP("./src/leaves2.bmp"))) printf("Error when loading BMP: %s\n", SDL_GetError());
-  // Set 100th pixel as the transparent color.
-  if (SDL_SetColorKey(surface,
-                      SDL_TRUE,
-                      *(((uint32_t*)(surface->pixels)) + 100)) != 0){
-    printf("Error when changing color key: %s\n", SDL_GetError());
+  // Every bitmap comes from the atlas, already in the texture format and with the colour keys
+  // applied, see atlas.h.
+  assetPath(path, sizeof(path), ATLAS_FILE);
+  if (!atlasOpen(path)) return -1;
+  const atlasImageS* leaves_p = atlasFind("leaves");
+  const atlasImageS* clouds_p = atlasFind("clouds");
+  const atlasImageS* cylinder_p = atlasFind("cylinder");
+  const atlasImageS* font_p = atlasFind("font");
+  if (leaves_p == NULL || clouds_p == NULL || cylinder_p == NULL || font_p == NULL) return -1;
+
+  // The leaves and clouds share a page, so one texture holds both.
+  if (NULL == (spritesTexture_p = atlasCreateTexture(myRenderer_p, leaves_p))) return -1;
+  leavesOrigin = (SDL_Point){leaves_p->x, leaves_p->y};
+  cloudsOrigin = (SDL_Point){clouds_p->x, clouds_p->y};
+  initLeafColors(leaves_p);
+
+  // The string highlights add this part of the clouds.
+  SDL_Color highlight[MAX_HIGHLIGHT_SIZE * MAX_HIGHLIGHT_SIZE];
+  for (int i = 0; i < MAX_HIGHLIGHT_SIZE * MAX_HIGHLIGHT_SIZE; i++)
+  {
+    highlight[i] = imageColor(clouds_p, HIGHLIGHT_X + i % MAX_HIGHLIGHT_SIZE, HIGHLIGHT_Y + i / MAX_HIGHLIGHT_SIZE);
   }
 
-  if (NULL == (leavesTexture_p = SDL_CreateTextureFromSurface(myRenderer_p,
-                                                              surface))){
-    printf("Error when creating texture: %s\n", SDL_GetError());
-  }
+  /* The cylinder bitmap is drawn by the string rasterizer, straight from the atlas. */
+  cylinderTextureHeight = cylinder_p->height;
+  cylinderTextureWidth = cylinder_p->width;
+  if (!initStringRaster(cylinder_p, highlight)) return -1;
 
+  // Create the texture that will be used to print ASCII.
+  if (NULL == (asciiTexture_p = atlasCreateTexture(myRenderer_p, font_p))) return -1;
 
-  // Set blue pixel as the transparent color.
-  if (SDL_SetColorKey(surface,
-                      SDL_TRUE,
-                      *(((uint32_t*)(surface->pixels)) + 126)) != 0){
-    printf("Error when changing color key: %s\n", SDL_GetError());
-  }
+  // All glyphs of a frame are drawn in one batch, at positions computed here once.
+  if (!glyphBatchInit(myRenderer_p, asciiTexture_p, FONT_WIDTH, FONT_HEIGHT)) return -1;
+  if (!initTextLayouts()) return -1;
+  hudCacheInit(myRenderer_p);
+  initHudLines();
 
-  if (NULL == (cloudTexture_p = SDL_CreateTextureFromSurface(myRenderer_p,
-                                                              surface))){
-    printf("Error when creating texture: %s\n", SDL_GetError());
-  }
 
-  /* Create the cylinder texture! */
-  if (NULL == (surface = SDL_LoadBMP("./src/cylinder.bmp"))) printf("Error when loading BMP: %s\n", SDL_GetError());
-  
-  cylinderTextureHeight = surface->h;
-  cylinderTextureWidth = surface->w;
-  if (NULL == (cylinderTexture_p = SDL_CreateTextureFromSurface(myRenderer_p,
-                                                              surface))){
-    printf("Error when creating texture: %s\n", SDL_GetError());
-  }
+  // Create the texture the lens is streamed into when it changes.
+  if (NULL == (lensTexture_p = SDL_CreateTexture(myRenderer_p,
+                                                 SDL_PIXELFORMAT_ABGR8888,
+                                                 SDL_TEXTUREACCESS_STREAMING,
+                                                 WIN_WIDTH,
+                                                 WIN_HEIGHT))) printf("Error when creating texture: %s\n", SDL_GetError());
+  // The lens is see-through where it is flat, see lensKernel.h.
+  SDL_SetTextureBlendMode(lensTexture_p, SDL_BLENDMODE_BLEND);
 
+  worldConfig.stringHeight = cylinderTextureHeight;
+  if (!worldInit(&worldConfig)) return -1;
 
-  SDL_FreeSurface(surface);
-  
-  // Create the texture that will be used to print ASCII.
-  if (NULL == (surface = SDL_LoadBMP("./src/consolas.bmp"))) printf("Error when loading BMP: %s\n", SDL_GetError());
-  // Set first pixel as the transparent color.
-  if (SDL_SetColorKey(surface,
-                      SDL_TRUE,
-                      *((uint32_t*)(surface->pixels)+100)) != 0)
-  {
-    printf("Error when changing color key: %s\n", SDL_GetError());
-  }
+  // Start the ticks that will move background now and then.
+  renderSetBackgroundTimer(true);
+  return 0;
+}
 
-  if (NULL == (asciiTexture_p = SDL_CreateTextureFromSurface(myRenderer_p,
-                                                   surface))) printf("Error when creating texture: %s\n", SDL_GetError());
-  SDL_FreeSurface(surface);
+void renderSetPasses(unsigned int passMask)
+{
+  enabledPasses = passMask;
+}
 
+unsigned int renderGetPasses(void)
+{
+  return enabledPasses;
+}
 
-  // Create a timer that will move background now and then.
-  const int newTargetTimeoutMs = 100;
-  SDL_TimerID my_timer_id = SDL_AddTimer(newTargetTimeoutMs, updateBackground, 0);
-  if (my_timer_id == 0) printf("Timer error: %s\n", SDL_GetError());
-  return 0;
+bool renderIsAnimated(void)
+{
+  return (enabledPasses & RENDER_ANIMATED_PASSES) != 0;
 }
 
-void render(char* input_p, int score, int intervalMs)
+void renderSetPassTimer(renderPassTimerT passTimer)
 {
-  if (SDL_SetRenderDrawColor(myRenderer_p, 20, 20, 255, 255) != 0) printf("Color error\n");
-  SDL_RenderClear(myRenderer_p);
+  passTimer_p = passTimer;
+}
 
-  drawSky();
-  drawGround();
-  //drawClouds();
-  //drawLeaves();
-  //updateString();
-  //drawString();
-  drawTree();
-  //updateLens();
-  //drawLens();
-  drawCube();
-  
-  for (int x = 0; x < gridSize; x++)
+void renderSetBackgroundTimer(bool running)
+{
+  backgroundTimer = running;
+  worldSetTicking(running);
+}
+
+void renderTickBackground(void)
+{
+  worldTick();
+}
+
+void renderStepBackgroundFrame(void)
+{
+  worldStepFrame();
+}
+
+void renderSetOverlay(const char* text_p)
+{
+  snprintf(overlayText, sizeof(overlayText), "%s", text_p != NULL ? text_p : "");
+}
+
+int renderStorm(int numLeaves)
+{
+  return worldStorm(numLeaves);
+}
+
+const char* renderPassName(renderPassE pass)
+{
+  return passNames[pass];
+}
+
+/* RENDER_PASS() draws one pass if it is enabled and reports its duration to the pass timer. */
+#define RENDER_PASS(pass, drawCall) \
+  if (enabledPasses & RENDER_PASS_BIT(pass)) \
+  { \
+    TRACE_SCOPE(passNames[pass]); \
+    uint64_t passStart = (passTimer_p != NULL) ? SDL_GetPerformanceCounter() : 0; \
+    drawCall; \
+    if (passTimer_p != NULL) passTimer_p((pass), SDL_GetPerformanceCounter() - passStart); \
+  }
+
+void render(char* input_p, int score, int intervalMs)
+{
+  TRACE_SCOPE("render");
+  // The newest state of the background, while the next one is simulated.
+  const worldSnapshotS* world_p = worldAcquire();
+  if (backgroundTimer) worldRequestFrame();
+  int wind = world_p->windSpeed;
+  unsigned int layered = 0;
+  RENDER_PASS(RENDER_PASS_BACKGROUND, layered = drawBackgroundLayer(wind));
+  if (layered == 0)
   {
-    for (int y = 0; y < gridSize; y++)
-    {
-      int inputChar = (int)*(input_p + (y * gridSize) + x);
-      SDL_Rect sourceRect;
-      calcSourceRect(&sourceRect, inputChar);
-      SDL_Rect destRect;
-      int height = WIN_HEIGHT / gridSize; 
-      int horizontalSpacing = WIN_WIDTH / gridSize;
-      int width = height * FONT_SIZE_RATIO; 
-      destRect.x = x * horizontalSpacing + (horizontalSpacing/2 - width);
-      destRect.y = y * height;
-      destRect.w = width;
-      destRect.h = height;
-      if (SDL_RenderCopy(myRenderer_p, asciiTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
-    }
-  } 
-  drawScore(score, intervalMs);
+    if (SDL_SetRenderDrawColor(myRenderer_p, 20, 20, 255, 255) != 0) printf("Color error\n");
+    SDL_RenderClear(myRenderer_p);
+    RENDER_PASS(RENDER_PASS_SKY, drawSky());
+    RENDER_PASS(RENDER_PASS_GROUND, drawGround());
+  }
+  RENDER_PASS(RENDER_PASS_CLOUDS, drawClouds(world_p));
+  RENDER_PASS(RENDER_PASS_LEAVES, drawLeaves(world_p));
+  RENDER_PASS(RENDER_PASS_STRING, drawString(world_p));
+  if ((layered & RENDER_PASS_BIT(RENDER_PASS_TREE)) == 0)
+  {
+    RENDER_PASS(RENDER_PASS_TREE, drawTree(wind));
+  }
+  RENDER_PASS(RENDER_PASS_LENS, drawLens(world_p));
+  RENDER_PASS(RENDER_PASS_MESH, drawMesh(world_p));
+  RENDER_PASS(RENDER_PASS_GRID, drawGrid(input_p));
+  RENDER_PASS(RENDER_PASS_GLYPHS, glyphBatchFlush());
+  glyphBatchClear(); // Glyphs queued while the glyph pass is disabled.
+  RENDER_PASS(RENDER_PASS_SCORE, drawScore(score, intervalMs));
+  worldRelease();
+  TRACE_SCOPE("SDL_RenderPresent");
   SDL_RenderPresent(myRenderer_p);
 }
 
-void renderScoreBoard(scoreS* hiScoreList, int numberOfScores)
+void renderScoreBoard(scoreS* hiScoreList, int numberOfScores, const scoreRankS* rank_p)
 {
+  TRACE_SCOPE("renderScoreBoard");
   if (SDL_SetRenderDrawColor(myRenderer_p, 255, 255, 255, 255) != 0) printf("Color error\n");
   SDL_RenderClear(myRenderer_p);
 
-  int startY = 40;
-  int charSize = (WIN_HEIGHT - 2 * startY) / 12; //TODO make this the same def or get real val from caller.
+  const char* header = "PLAYER - SCORE";
+  const char* info = "ENTER CONFIRMS AND RESTARTS";
+  int startY = SCOREBOARD_START_Y;
+  int charSize = SCOREBOARD_CHAR_SIZE; //TODO make this the same def or get real val from caller.
+  int charWidth = (int)(charSize * FONT_SIZE_RATIO);
   char scoreString[255];
   int i;
-  sprintf(scoreString, "PLAYER - SCORE");
 
-  int startX = (WIN_WIDTH - strlen(scoreString) * charSize * FONT_SIZE_RATIO) / 2;
+  int startX = (WIN_WIDTH - strlen(header) * charSize * FONT_SIZE_RATIO) / 2;
 
-  drawText(scoreString, charSize, startX, startY);
+  // The lines start one character in.
+  hudLineDraw(&scoreBoardHeaderLine, header, startX + charWidth, startY);
 
   for (i = 0; i < numberOfScores; i++)
   {
     sprintf(scoreString, "%6s - %d", hiScoreList[i].name, hiScoreList[i].score);
-    drawText(scoreString, charSize, startX, startY + ((i+1) * charSize));
+    if (i < SCOREBOARD_MAX_ENTRIES)
+    {
+      hudLineDraw(&scoreBoardLines[i], scoreString, startX + charWidth, startY + ((i+1) * charSize));
+    }
+    else
+    {
+      drawText(scoreString, charSize, startX, startY + ((i+1) * charSize));
+    }
   }
 
-  sprintf(scoreString, "ENTER CONFIRMS AND RESTARTS");
-  int infoCharSize = 20;
-  startX = (WIN_WIDTH - strlen(scoreString) * infoCharSize * FONT_SIZE_RATIO) / 2;
-  drawText(scoreString, infoCharSize, startX, startY + ((i+1) * charSize));
+  int infoCharSize = SCOREBOARD_INFO_CHAR_SIZE;
+  int infoCharWidth = (int)(infoCharSize * FONT_SIZE_RATIO);
+  startX = (WIN_WIDTH - strlen(info) * infoCharSize * FONT_SIZE_RATIO) / 2;
+  hudLineDraw(&scoreBoardInfoLine, info, startX + infoCharWidth, startY + ((i+1) * charSize));
+
+  if (rank_p != NULL && rank_p->games > 0)
+  {
+    // The game just played is not among the games yet, it counts as one more.
+    char rank[64];
+    int length = snprintf(rank, sizeof(rank), "TOP %.1f%% OF %llu GAMES",
+                          100.0 * (rank_p->above + 1) / (rank_p->games + 1),
+                          (unsigned long long)(rank_p->games + 1));
+    if (rank_p->hasBest && length < (int)sizeof(rank))
+    {
+      snprintf(rank + length, sizeof(rank) - length, " - BEST %d", rank_p->best);
+    }
+    startX = (WIN_WIDTH - strlen(rank) * infoCharSize * FONT_SIZE_RATIO) / 2;
+    hudLineDraw(&scoreBoardRankLine, rank, startX + infoCharWidth, startY + ((i+1) * charSize) + infoCharSize + 4);
+  }
+  glyphBatchFlush();
   SDL_RenderPresent(myRenderer_p);
 
 }
 
 /* LOCAL FUNCTIONS */
-static void initLens(void)
-{
-    memset(&bumpMap[0][0], 128, WIN_WIDTH*WIN_HEIGHT*sizeof(int));
+/*
+ * initTextLayouts() computes where every grid cell and every character of the score line goes,
+ * so that drawing them is only a matter of queuing glyphs.
+ */
+static bool initTextLayouts(void)
+{
+  if (!glyphLayoutCreate(&gridLayout, gridColumns * gridRows)) return false;
+  float verticalSpacing = (float)WIN_HEIGHT / gridRows;
+  float height = verticalSpacing;
+  float horizontalSpacing = (float)WIN_WIDTH / gridColumns;
+  float width = height * FONT_SIZE_RATIO;
+  if (width > horizontalSpacing / 2)
+  {
+    // Many columns and few rows, keep the glyphs from overlapping.
+    width = horizontalSpacing / 2;
+    height = width / FONT_SIZE_RATIO;
+  }
+  for (int x = 0; x < gridColumns; x++)
+  {
+    for (int y = 0; y < gridRows; y++)
+    {
+      SDL_FRect* destRect_p = &gridLayout.rects_p[(y * gridColumns) + x];
+      destRect_p->x = x * horizontalSpacing + (horizontalSpacing/2 - width);
+      destRect_p->y = y * verticalSpacing;
+      destRect_p->w = width;
+      destRect_p->h = height;
+    }
+  }
+  return true;
 }
 
-static void initStrings(void)
+/*
+ * initHudLines() sets up the text lines that are kept rendered in textures, the score line and
+ * the lines of the score board.
+ */
+static void initHudLines(void)
 {
-
-  for (int i = 0; i < WIN_WIDTH; i++)
+  int charWidth = (int)(SCOREBOARD_CHAR_SIZE * FONT_SIZE_RATIO);
+  hudLineInit(&scoreLine, (int)(SCORE_CHAR_SIZE * FONT_SIZE_RATIO), SCORE_CHAR_SIZE);
+  hudLineInit(&overlayLine, (int)(OVERLAY_CHAR_SIZE * FONT_SIZE_RATIO), OVERLAY_CHAR_SIZE);
+  hudLineInit(&scoreBoardHeaderLine, charWidth, SCOREBOARD_CHAR_SIZE);
+  for (int i = 0; i < SCOREBOARD_MAX_ENTRIES; i++)
   {
+    hudLineInit(&scoreBoardLines[i], charWidth, SCOREBOARD_CHAR_SIZE);
   }
-
+  hudLineInit(&scoreBoardInfoLine, (int)(SCOREBOARD_INFO_CHAR_SIZE * FONT_SIZE_RATIO), SCOREBOARD_INFO_CHAR_SIZE);
+  hudLineInit(&scoreBoardRankLine, (int)(SCOREBOARD_INFO_CHAR_SIZE * FONT_SIZE_RATIO), SCOREBOARD_INFO_CHAR_SIZE);
 }
 
-static void initLoops(void)
+static void destroyHudLines(void)
 {
-  for (int loopType = 0; loopType < NUM_LOOP_TYPES; loopType++)
+  hudLineDestroy(&scoreLine);
+  hudLineDestroy(&overlayLine);
+  hudLineDestroy(&scoreBoardHeaderLine);
+  for (int i = 0; i < SCOREBOARD_MAX_ENTRIES; i++)
   {
-    loopS tmpLoops[MAX_LOOP_LENGTH + 1];
-    tmpLoops[0].x = 0;
-    tmpLoops[0].y = 0;
-    int numberOfLoops = 1 + maxLoopIndex[loopType];
-    for (int loopIndex = 0; loopIndex < numberOfLoops; loopIndex++)
-    {
-      loopS* loop_p = &loops[loopType][loopIndex];
-      tmpLoops[loopIndex + 1].x = 3 * (loopType + 1) * (-sin(2*M_PI*loopIndex/numberOfLoops + (M_PI / numberOfLoops)));
-      tmpLoops[loopIndex + 1].y = 3 * (loopType + 1) * (1-cos(2*M_PI*loopIndex/numberOfLoops + (M_PI / numberOfLoops)));
-      loop_p->x = tmpLoops[loopIndex + 1].x - tmpLoops[loopIndex].x;
-      loop_p->y = tmpLoops[loopIndex + 1].y - tmpLoops[loopIndex].y;
-      //printf("Loop  %d, %d, %d, %d\n", loopType, loopIndex, loop_p->x,  loop_p->y); 
-    }
+    hudLineDestroy(&scoreBoardLines[i]);
   }
+  hudLineDestroy(&scoreBoardInfoLine);
+  hudLineDestroy(&scoreBoardRankLine);
+}
+
+static void drawGrid(char* input_p)
+{
+  glyphBatchAddLayout(&gridLayout, input_p, gridColumns * gridRows);
+}
+
+static void initLens(void)
+{
+    lensKernelInit();
+    bumpMapInit(&bumpMap, WIN_WIDTH, WIN_HEIGHT, LENS_FLAT_COLOR);
 }
 
 static void drawSky()
 {
   SDL_Rect sourceRect;
-  sourceRect.x = 95;
-  sourceRect.y = 4;
+  sourceRect.x = leavesOrigin.x + 95;
+  sourceRect.y = leavesOrigin.y + 4;
   sourceRect.h = 1;
   sourceRect.w = 1;
   SDL_Rect destRect;
@@ -357,15 +514,15 @@ static void drawSky()
   destRect.w = WIN_WIDTH;
   destRect.h = WIN_HEIGHT;
 
-  if (SDL_RenderCopy(myRenderer_p, leavesTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+  if (SDL_RenderCopy(myRenderer_p, spritesTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
 }
 
 
 static void drawGround()
 {
   SDL_Rect sourceRect;
-  sourceRect.x = 62;
-  sourceRect.y = 17;
+  sourceRect.x = leavesOrigin.x + 62;
+  sourceRect.y = leavesOrigin.y + 17;
   sourceRect.h = 64-17;
   sourceRect.w = 318-62;
   SDL_Rect destRect;
@@ -374,25 +531,25 @@ static void drawGround()
   destRect.w = WIN_WIDTH;
   destRect.h = GROUND_LEVEL + MOUNTAIN_LEVEL;
 
-  if (SDL_RenderCopy(myRenderer_p, leavesTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+  if (SDL_RenderCopy(myRenderer_p, spritesTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
 }
 
-static void drawTree()
+static void drawTree(int wind)
 {
   int spriteY = 1;
   int spriteX = 1;
-  if (windSpeed == 4)
+  if (wind == 4)
   {
     spriteY = 53;
   }
-  else if (windSpeed == 8)
+  else if (wind == 8)
   {
     spriteY = 105;
   }
 
   SDL_Rect sourceRect;
-  sourceRect.x = spriteX;
-  sourceRect.y = spriteY;
+  sourceRect.x = leavesOrigin.x + spriteX;
+  sourceRect.y = leavesOrigin.y + spriteY;
   sourceRect.h = 44;
   sourceRect.w = 44;
   SDL_Rect destRect;
@@ -401,605 +558,281 @@ static void drawTree()
   destRect.w = 150;
   destRect.h = 150;
 
-  if (SDL_RenderCopy(myRenderer_p, leavesTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+  if (SDL_RenderCopy(myRenderer_p, spritesTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
 }
 
-static void drawLeaves()
+/*
+ * renderBackgroundLayer() renders the given static passes into the layer. The layer is opaque,
+ * the sky does not cover the clear colour at the top and left edges.
+ */
+static bool renderBackgroundLayer(backgroundLayerS* layer_p, unsigned int passes, int wind)
 {
-  for (int i = 0; i < MAX_NUM_LEAVES; i++)
+  if (layer_p->texture_p == NULL)
   {
-    if (leaves[i].state != 0)
+    layer_p->texture_p = SDL_CreateTexture(myRenderer_p,
+                                           SDL_PIXELFORMAT_ARGB8888,
+                                           SDL_TEXTUREACCESS_TARGET,
+                                           WIN_WIDTH,
+                                           WIN_HEIGHT);
+    if (layer_p->texture_p == NULL)
     {
-      SDL_Rect sourceRect;
-      sourceRect.x = 57;
-      sourceRect.y = 4 + leaves[i].state;
-      sourceRect.h = 1;
-      sourceRect.w = 1;
-      SDL_Rect destRect;
-      destRect.x = leaves[i].x;
-      destRect.y = leaves[i].y; 
-      destRect.w = 3;
-      destRect.h = 3;
-
-      if (SDL_RenderCopy(myRenderer_p, leavesTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+      printf("Error when creating texture: %s\n", SDL_GetError());
+      return false;
     }
+    SDL_SetTextureBlendMode(layer_p->texture_p, SDL_BLENDMODE_NONE);
   }
-}
-
-double y_over_cylinder[CYLINDER_HEIGHT];
-static double phi_over_cylinder[CYLINDER_HEIGHT];
-char color_over_cylinder[CYLINDER_HEIGHT];
-char highlight_over_cylinder[CYLINDER_HEIGHT];
-static double power(double in)
-{
-    return in*in*in*in*in*in*in*in;
-}
 
-static void stringWarpInit() 
-{
-    const double d_cylinderHeight = 1.0 * CYLINDER_HEIGHT;
-    phi_over_cylinder[0] = -1.57079633;
-    for (int y = 1; y < CYLINDER_HEIGHT; y+=1) { 
-            phi_over_cylinder[y] = 2*M_PI*asin(y/(2.0*d_cylinderHeight) - 0.25);
-    }
-
-    for (int y = 0; y < CYLINDER_HEIGHT; y+=1) { 
-            y_over_cylinder[y] = ((d_cylinderHeight/2.0 + phi_over_cylinder[y]/2.0/3.14 * d_cylinderHeight));
-            //printf("phi %f, cos %f, y %f\n", phi_over_cylinder[y], cos(phi_over_cylinder[y]), y_over_cylinder[y]);
-    }
-
-    for (int y = 0; y < CYLINDER_HEIGHT; y+=1) { 
-            color_over_cylinder[y] = (char)round(SHADE * cos(phi_over_cylinder[y]));
-            highlight_over_cylinder[y] = (char)round(SHINE * power(cos(phi_over_cylinder[y])));
-            printf("highlight %hhu\n", highlight_over_cylinder[y]);
-    }
-}
-
-static double fsqr(double in) 
-{
-    return in*in*in;
-}
-
-static double calcTwistFactor(double phiDiff)
-{
-    if (phiDiff > 6.28 || phiDiff < -6.28) printf("phiDiff= %f\n", phiDiff);
-
-    double out = 0.5*(1 + cos(7*fabs(phiDiff)));
-
-    if (out < 0.1) printf("twist = %f\n", out);
-
-    return out;
-}
-
-static void drawString()
+  // Glyphs already queued belong to the current target and have to be drawn before switching.
+  glyphBatchFlush();
+  SDL_Texture* previousTarget_p = SDL_GetRenderTarget(myRenderer_p);
+  if (SDL_SetRenderTarget(myRenderer_p, layer_p->texture_p))
+  {
+    printf("Error when setting render target: %s\n", SDL_GetError());
+    return false;
+  }
+  if (SDL_SetRenderDrawColor(myRenderer_p, 20, 20, 255, 255) != 0) printf("Color error\n");
+  SDL_RenderClear(myRenderer_p);
+  unsigned int enabledBefore = enabledPasses;
+  enabledPasses = passes;
+  RENDER_PASS(RENDER_PASS_SKY, drawSky());
+  RENDER_PASS(RENDER_PASS_GROUND, drawGround());
+  RENDER_PASS(RENDER_PASS_TREE, drawTree(wind));
+  enabledPasses = enabledBefore;
+  SDL_SetRenderTarget(myRenderer_p, previousTarget_p);
+  layer_p->passes = passes;
+  return true;
+}
+
+/*
+ * drawBackgroundLayer() copies the cached layer of the static passes for the wind, after
+ * rendering it again if the enabled passes changed. Returns the passes it drew, or 0 when there
+ * is no layer and the passes have to be drawn directly.
+ */
+static unsigned int drawBackgroundLayer(int wind)
 {
-    const double src_x_step = cylinderTextureWidth/WIN_WIDTH;
-    const double src_y_step = cylinderTextureHeight/2/CYLINDER_HEIGHT;
-    double twistScaleFactor;
-    const double dstPixelsPerRad = CYLINDER_HEIGHT/M_PI;
-    for (int x = PIXEL_SIZE; x < WIN_WIDTH + PIXEL_SIZE; x+=PIXEL_SIZE)
-    {
+  unsigned int passes = enabledPasses & LAYER_PASSES;
+  if (enabledPasses & MIDDLE_PASSES) passes &= ~RENDER_PASS_BIT(RENDER_PASS_TREE);
+  if (passes == 0) return 0;
 
-        twistScaleFactor = calcTwistFactor(strings[x - PIXEL_SIZE].phi - strings[x + PIXEL_SIZE].phi);
+  int windState = wind / 4;
+  if (windState >= NUM_WIND_STATES) windState = NUM_WIND_STATES - 1;
+  if ((passes & RENDER_PASS_BIT(RENDER_PASS_TREE)) == 0) windState = 0; // Nothing in it depends on the wind.
 
-        for (int y = 0; y < CYLINDER_HEIGHT; y+=PIXEL_SIZE)
-        {
-            const double d_cylinderHeight = 1.0 * CYLINDER_HEIGHT;
-            SDL_Rect sourceRect;
-            sourceRect.x = (x-PIXEL_SIZE) * src_x_step;
-            sourceRect.y = (strings[x].y + y_over_cylinder[y]);
-            if (sourceRect.y < 0) sourceRect.y = cylinderTextureHeight - (abs(sourceRect.y) % cylinderTextureHeight);
-            else sourceRect.y %= cylinderTextureHeight;
-            sourceRect.h = src_x_step;
-            sourceRect.w = src_y_step;
-            SDL_Rect destRect;
-            destRect.x = (x-PIXEL_SIZE);
-            destRect.y = round(WIN_HEIGHT/2 + ((y - CYLINDER_HEIGHT/2)*twistScaleFactor));
-            destRect.w = PIXEL_SIZE;
-            destRect.h = PIXEL_SIZE * twistScaleFactor *2;
-            unsigned int current_color_y = y - round(dstPixelsPerRad * lightAngle);
-            if (current_color_y > CYLINDER_HEIGHT) current_color_y = CYLINDER_HEIGHT-1;
-            unsigned char color_mod = color_over_cylinder[current_color_y];
-            SDL_SetTextureColorMod(cylinderTexture_p,
-                           color_mod,
-                           color_mod,
-                           color_mod);
-            if (SDL_RenderCopy(myRenderer_p, cylinderTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
-
-            /* Highlights */
-
-            color_mod = highlight_over_cylinder[current_color_y];
-            //printf("lightmod %hhu\n", color_mod);
-            if (color_mod > 1 ) {
-                sourceRect.x = 100;
-                sourceRect.y = 87;
-                SDL_SetTextureBlendMode(cloudTexture_p, SDL_BLENDMODE_ADD);
-                SDL_SetTextureColorMod(cloudTexture_p,
-                        color_mod,
-                        color_mod,
-                        color_mod);
-                if (SDL_RenderCopy(myRenderer_p, cloudTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
-                SDL_SetTextureBlendMode(cloudTexture_p, SDL_BLENDMODE_NONE);
-            }
-        }
-    }
+  backgroundLayerS* layer_p = &backgroundLayers[windState];
+  if (layer_p->texture_p == NULL || layer_p->passes != passes)
+  {
+    if (!renderBackgroundLayer(layer_p, passes, wind)) return 0;
+  }
+  if (SDL_RenderCopy(myRenderer_p, layer_p->texture_p, NULL, NULL)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+  return passes;
 }
 
-static void drawScore(int score, int intervalMs)
+static void destroyBackgroundLayers(void)
 {
-#define STRING_SIZE 100
-#define SCORE_CHAR_SIZE 25;
-  char scoreString[STRING_SIZE];
-  SDL_Rect destRect;
-  destRect.x = 0;
-  destRect.y = 0;
-  destRect.h = SCORE_CHAR_SIZE;
-  destRect.w = destRect.h * FONT_SIZE_RATIO;
-  int numChars = snprintf(scoreString, STRING_SIZE, "Score: %6d @ %3.2f chars per minute.", score, 1000.0/intervalMs);
-  for (int i = 0; i < numChars; i++)
+  for (int i = 0; i < NUM_WIND_STATES; i++)
   {
-   SDL_Rect sourceRect;
-   calcSourceRect(&sourceRect, scoreString[i]);
-   destRect.x += destRect.w;   
-
-   if (SDL_RenderCopy(myRenderer_p, asciiTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
-  } 
+    if (backgroundLayers[i].texture_p != NULL) SDL_DestroyTexture(backgroundLayers[i].texture_p);
+    backgroundLayers[i].texture_p = NULL;
+    backgroundLayers[i].passes = 0;
+  }
 }
 
-static void drawText(char* string, int charSize, int x, int y)
+static void drawLeaves(const worldSnapshotS* world_p)
 {
-  int charWidth = (int)(charSize * FONT_SIZE_RATIO);
-  SDL_Rect destRect;
-   destRect.x = x;
-   destRect.y = y;
-   destRect.h = charSize;
-   destRect.w = charWidth;
-  int numChars = strlen(string);
-  for (int i = 0; i < numChars; i++)
+  // One batch of squares per leaf colour.
+  for (int state = 1; state < LEAF_NUM_STATES; state++)
   {
-   SDL_Rect sourceRect;
-   calcSourceRect(&sourceRect, string[i]);
-   destRect.x += charWidth;
+    int count = world_p->leafStart[state + 1] - world_p->leafStart[state];
+    const SDL_Rect* rects_p = &world_p->leafRects_p[world_p->leafStart[state]];
+    SDL_Color color = leafColors[state];
+    if (count == 0 || color.a == SDL_ALPHA_TRANSPARENT) continue;
 
-   if (SDL_RenderCopy(myRenderer_p, asciiTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+    if (SDL_SetRenderDrawColor(myRenderer_p, color.r, color.g, color.b, color.a) != 0) printf("Color error\n");
+    if (SDL_RenderFillRects(myRenderer_p, rects_p, count)) printf("Error when RenderFillRects: %s\n", SDL_GetError());
   }
 }
 
-static void drawLens()
+/*
+ * initLeafColors() picks the colour of every leaf state from the leaves bitmap, where each one is
+ * a single pixel, so the leaves can be drawn as filled squares.
+ */
+static void initLeafColors(const atlasImageS* leaves_p)
 {
-    for (int x = 0; x < WIN_WIDTH; x++) {
-        for (int y = 0; y < WIN_HEIGHT; y++) {
-            char red = bumpMap[x][y] & 0xFF;
-            char green = ( bumpMap[x][y]>>8) & 0xFF;
-            char blue = (bumpMap[x][y]>>16) & 0xFF;
-            SDL_SetRenderDrawColor(myRenderer_p, red, green, blue, SDL_ALPHA_OPAQUE);
-            if (SDL_RenderDrawPoint(myRenderer_p, x, y) ) printf("Failed to draw point\n");
-
-        }
-    }
-
+  for (int state = 1; state < LEAF_NUM_STATES; state++)
+  {
+    leafColors[state] = imageColor(leaves_p, 57, 4 + state);
+  }
 }
 
-static void calcSourceRect(SDL_Rect* rect, char inputChar)
+/*
+ * imageColor() returns the colour of a pixel of an atlas image, transparent if it was the colour
+ * key, as it ends up in the texture.
+ */
+static SDL_Color imageColor(const atlasImageS* image_p, int x, int y)
 {
-  rect->w = FONT_WIDTH;//35;
-  rect->h = FONT_HEIGHT; //75;
-  int bitmapX = rect->w * (inputChar % 16);
-  int bitmapY = rect->h * (inputChar / 16);
-  rect->x = bitmapX;
-  rect->y = bitmapY;
+  // ATLAS_PIXEL_FORMAT is ABGR8888, red in the low byte.
+  uint32_t pixel = atlasPixel(image_p, x, y);
+  SDL_Color color = {pixel & 0xFF, (pixel >> 8) & 0xFF, (pixel >> 16) & 0xFF, pixel >> 24};
+  return color;
 }
 
-static void removeCloud(int i)
+/* assetPath() puts the path of a file installed next to the executable into path_p, so the game
+ * runs from any directory. */
+static void assetPath(char* path_p, size_t size, const char* name_p)
 {
-  memcpy(&clouds[i], &clouds[numClouds - 1], sizeof(cloudS));
-  clouds[numClouds - 1].state = 0;
-  numClouds--;
+  char* base_p = SDL_GetBasePath();
+  snprintf(path_p, size, "%s%s", base_p != NULL ? base_p : "./", name_p);
+  SDL_free(base_p);
 }
 
-static void removeLeaf(int i)
+double y_over_cylinder[CYLINDER_HEIGHT];
+static double phi_over_cylinder[CYLINDER_HEIGHT];
+char color_over_cylinder[CYLINDER_HEIGHT];
+char highlight_over_cylinder[CYLINDER_HEIGHT];
+static double power(double in)
 {
-  memcpy(&leaves[i], &leaves[numLeaves - 1], sizeof(leafS));
-  leaves[numLeaves - 1].state = 0;
-  numLeaves--;
+    return in*in*in*in*in*in*in*in;
 }
 
-static void updateString()
+static void stringWarpInit() 
 {
-#define MAX_FORCE 75
-    static int count=0;
-    double phaseshift;
-    const double dampening = 0.990;
-    lightAngle = sin(count/50.0);
-    phaseshift =(MAX_PHI * sin(count/40.0) + MAX_PHI * sin(count/28.0));
-    count++;
-    stringS *this = &strings[0];
-    this->last_phi = phaseshift;
-    this->last_y = (phaseshift/2/3.14 * cylinderTextureHeight);
-
-    for (int i = PIXEL_SIZE; i < STRING_LENGTH; i+=PIXEL_SIZE) {
-        this = &strings[i];
-        stringS *prev = &strings[i - PIXEL_SIZE];
-        this->last_phi = (prev->phi)*dampening;
-        this->last_y = (prev->y)*dampening;
-        prev->phi = prev->last_phi;
-        prev->y = prev->last_y;
+    const double d_cylinderHeight = 1.0 * CYLINDER_HEIGHT;
+    phi_over_cylinder[0] = -1.57079633;
+    for (int y = 1; y < CYLINDER_HEIGHT; y+=1) { 
+            phi_over_cylinder[y] = 2*M_PI*fixedToDouble(fixedAsin(fixedFromDouble(y/(2.0*d_cylinderHeight) - 0.25)));
     }
-    this = &strings[STRING_LENGTH];
-    stringS *prev = &strings[STRING_LENGTH - PIXEL_SIZE];
-    this->phi = this->last_phi;
-    this->y = this->last_y;
-    this->last_phi = (prev->phi)*dampening;
-    this->last_y = (prev->y)*dampening;
-    prev->phi = prev->last_phi;
-    prev->y = prev->last_y;
-}
-
-static void updateLens(void)
-{
-    int bumpRadius = 10;
-    int start_x = rand()%(WIN_WIDTH - bumpRadius * 2);
-    int start_y = rand()%(WIN_HEIGHT - bumpRadius * 2);
 
-    for (int x = 0; x < 2*bumpRadius; x++) {
-        for (int y = 0; y < 2*bumpRadius; y++) {
-            bumpMap[x+start_x][y+start_y]+=10;
-        }
+    for (int y = 0; y < CYLINDER_HEIGHT; y+=1) { 
+            y_over_cylinder[y] = ((d_cylinderHeight/2.0 + phi_over_cylinder[y]/2.0/3.14 * d_cylinderHeight));
+            //printf("phi %f, cos %f, y %f\n", phi_over_cylinder[y], cos(phi_over_cylinder[y]), y_over_cylinder[y]);
     }
 
-}
-
-uint32_t updateBackground(uint32_t interval, void* parameters)
-{
-#define MAX_SPEED 3
-    windSpeed = (rand() % MAX_SPEED << 2);
-    int newLeafRand = rand();
-    if ((newLeafRand % 20 + windSpeed) > 18 && numLeaves < MAX_NUM_LEAVES)
-    {
-        leafS* newLeaf_p = &leaves[numLeaves];
-        numLeaves++;
-        newLeaf_p->x = TREE_X + 20 + rand()%60;
-        newLeaf_p->y = TREE_Y + 20; 
-        newLeaf_p->state = newLeafRand % 3 + 1;
-        newLeaf_p->onGround = false;
-        newLeaf_p->lifetime = 500;
+    for (int y = 0; y < CYLINDER_HEIGHT; y+=1) { 
+            double cosPhi = fixedToDouble(fixedCos(fixedAngleFromRadians(phi_over_cylinder[y])));
+            color_over_cylinder[y] = (char)round(SHADE * cosPhi);
+            highlight_over_cylinder[y] = (char)round(SHINE * power(cosPhi));
     }
-    else if (newLeafRand%20 > 16 && numLeaves < MAX_NUM_LEAVES)
-    {
-        leafS* newLeaf_p = &leaves[numLeaves];
-        numLeaves++;
-    newLeaf_p->x = WIN_WIDTH + 20;
-    newLeaf_p->y = WIN_HEIGHT - GROUND_LEVEL - 10; 
-    newLeaf_p->state = newLeafRand % 3 + 1;
-    newLeaf_p->onGround = false;
-    newLeaf_p->lifetime = 500;
-  }
+}
 
-  for (int i = 0; i < MAX_NUM_LEAVES; i++)
-  {
-    leafS* leaf_p = &leaves[i];
-    if (leaf_p->state != 0) // only active leaves
+/*
+ * initStringRaster() hands the cylinder bitmap and the tables made by stringWarpInit() to the
+ * rasterizer. highlight_p is a MAX_HIGHLIGHT_SIZE square of the colours added in highlights.
+ */
+static bool initStringRaster(const atlasImageS* cylinder_p, const SDL_Color* highlight_p)
+{
+    stringSetupS setup;
+    setup.numColumns = STRING_COLUMNS;
+    setup.cellSize = PIXEL_SIZE;
+    setup.cylinderHeight = CYLINDER_HEIGHT;
+    setup.centerY = WIN_HEIGHT/2;
+    setup.yOverCylinder_p = y_over_cylinder;
+    setup.colorOverCylinder_p = color_over_cylinder;
+    setup.highlightOverCylinder_p = highlight_over_cylinder;
+    setup.cylinderPixels_p = atlasPixels(cylinder_p, &setup.bitmapStride);
+    setup.bitmapWidth = cylinder_p->width;
+    setup.bitmapHeight = cylinder_p->height;
+    // Every cell shows a cylinderTextureHeight/2/CYLINDER_HEIGHT wide and
+    // cylinderTextureWidth/WIN_WIDTH high part of the bitmap.
+    setup.sourceStepX = cylinderTextureWidth/WIN_WIDTH;
+    setup.sourceWidth = cylinderTextureHeight/2/CYLINDER_HEIGHT;
+    setup.sourceHeight = cylinderTextureWidth/WIN_WIDTH;
+    if (setup.sourceWidth > MAX_HIGHLIGHT_SIZE) setup.sourceWidth = MAX_HIGHLIGHT_SIZE;
+    if (setup.sourceHeight > MAX_HIGHLIGHT_SIZE) setup.sourceHeight = MAX_HIGHLIGHT_SIZE;
+
+    SDL_Color highlight[MAX_HIGHLIGHT_SIZE * MAX_HIGHLIGHT_SIZE];
+    for (int y = 0; y < setup.sourceHeight; y++)
     {
-      if (windSpeed  == ((MAX_SPEED-1) << 2) && (rand()%40) == 0)
-      {
-        leaf_p->loop = true;
-        leaf_p->loopType = rand()%3;
-        leaf_p->loopIndex = 0; 
-        leaf_p->onGround = false;
-      }
-      if (leaf_p->onGround == false)
-      {
-        if (leaf_p->loop == true)
-        {
-         int loopType =  leaf_p->loopType;
-         int loopIndex = leaf_p->loopIndex;
-          leaf_p->x += loops[loopType][loopIndex].x - windSpeed;
-          leaf_p->y -= loops[loopType][loopIndex].y;
-          leaf_p->loopIndex++;
-          if (leaf_p->loopIndex == maxLoopIndex[loopType]) leaf_p->loop = false;
-        }
-        else
+        for (int x = 0; x < setup.sourceWidth; x++)
         {
-          int thisSpeed = windSpeed + rand()%(MAX_SPEED + 4) - 4; 
-          int thisSpeedY = -2;
-          leaf_p->x -= thisSpeed;
-          leaf_p->y -= thisSpeedY;
-
-          if (leaf_p->y > (WIN_HEIGHT - GROUND_LEVEL + thisSpeed))
-          {
-            leaf_p->onGround = true;
-            leaf_p->y += rand()%5;
-          }
+            highlight[y * setup.sourceWidth + x] = highlight_p[y * MAX_HIGHLIGHT_SIZE + x];
         }
-        if (leaf_p->x < 0) removeLeaf(i);
-      }
-      else // active leaf on ground
-      {
-        leaf_p->lifetime-=1;
-        if (leaf_p->lifetime <= 0) removeLeaf(i);
-      }
     }
-  }
-
-
-
-  if (rand()%(WIN_WIDTH>>4) == 0)
-  {
-    createCloud();
-  }
-
-  for (int i = 0; i < MAX_NUM_CLOUDS; i++)
-  {
-    if (clouds[i].state != 0) // only active clouds
-    {
-        clouds[i].x -= clouds[i].speed;
-
-        if ((clouds[i].x + clouds[i].width) < 0) removeCloud(i);
-      }
-  }
-
-
-  SDL_Event event;
-  SDL_UserEvent userevent;
-
-  userevent.type = SDL_USEREVENT;
-  userevent.code = 0;
-  userevent.data1 = &updateBackground;
-  userevent.data2 = parameters;
-
-  event.type = SDL_USEREVENT;
-  event.user = userevent;
-
-  SDL_PushEvent(&event);
-  return interval;
+    setup.highlight_p = highlight;
+    return stringRasterInit(myRenderer_p, &setup);
 }
 
-static void createCloud()
+static void drawString(const worldSnapshotS* world_p)
 {
-#define CLOUD_MAX_HEIGHT 50
-#define MAX_SCALE 4;
-  if (numClouds < MAX_NUM_CLOUDS)
-  {
-    cloudS* cloud_p = &clouds[numClouds];
-    cloud_p->state = 1;
-    const int max_y = WIN_HEIGHT - GROUND_LEVEL - CLOUD_MAX_HEIGHT;
-    cloud_p->y = rand()%(max_y) + 1;
-    cloud_p->x = WIN_WIDTH; 
-    float scale = 1 - ((float)cloud_p->y / max_y);
-    cloud_p->height =  CLOUD_MAX_HEIGHT * scale;
-    cloud_p->width = 200 * scale;
-    cloud_p->speed = ((CLOUD_MAX_SPEED >> 2) * scale) + (CLOUD_MAX_SPEED >> 2);
-    int spriteNum = rand()%3;
-    switch (spriteNum)
-    {
-      case 0:
-        cloud_p->spriteY = 80;
-        break;
-      case 1:
-        cloud_p->spriteY = 133;
-        break;
-      case 2:
-        cloud_p->spriteY = 190;
-        break;
-      default:
-        printf("Wrong case in cloudCreation!");
-
-    }
-    numClouds++;
-  }
+    const double dstPixelsPerRad = CYLINDER_HEIGHT/M_PI;
+    stringRasterDraw(world_p->columns_p, round(dstPixelsPerRad * world_p->lightAngle));
 }
 
-static void drawClouds()
+static void drawScore(int score, int intervalMs)
 {
-  for (int i = 0; i < MAX_NUM_CLOUDS; i++)
-  {
+  static int lastScore = 0;
+  static int lastIntervalMs = 0;
+  static char scoreString[STRING_SIZE];
 
-    if (clouds[i].state != 0)
-    {
-      //printf("Cloud %d, x %d y %d\n", i, clouds[i].x, clouds[i].y);
-      SDL_Rect sourceRect;
-      sourceRect.x = 82;
-      sourceRect.y = clouds[i].spriteY;
-      sourceRect.h = 20;
-      sourceRect.w = 149 - 82;
-      SDL_Rect destRect;
-      int height = clouds[i].height; 
-      int width =  clouds[i].width;
-      destRect.x = clouds[i].x;
-      destRect.y = clouds[i].y; 
-      destRect.w = width;
-      destRect.h = height;
-
-      if (SDL_RenderCopy(myRenderer_p, cloudTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
-    }
-    else
-    {
-      break;
-    }
+  // Only format the line when it changes, the cached line draws the same text in one copy.
+  if (scoreString[0] == '\0' || score != lastScore || intervalMs != lastIntervalMs)
+  {
+    snprintf(scoreString, STRING_SIZE, "Score: %6d @ %3.2f chars per minute.", score, 1000.0/intervalMs);
+    lastScore = score;
+    lastIntervalMs = intervalMs;
   }
+  // The score line starts one character in.
+  hudLineDraw(&scoreLine, scoreString, scoreLine.charWidth, 0);
+  if (overlayText[0] != '\0') hudLineDraw(&overlayLine, overlayText, scoreLine.charWidth, SCORE_CHAR_SIZE);
 }
 
-#define DISPLAY_Z 100
-#define DISPLAY_X WIN_WIDTH/2
-#define DISPLAY_Y WIN_HEIGHT/2
-
-#define CUBE_SIDE 200
-#define CUBE_CENTER 0
-#define CUBE_CENTER_Z -300
-struct coord corners[8] =
+static void drawText(char* string, int charSize, int x, int y)
 {
-    //FRONT CORNERS
-    {CUBE_CENTER - CUBE_SIDE/2, CUBE_CENTER - CUBE_SIDE/2, .z = CUBE_CENTER_Z - CUBE_SIDE/2},
-    {CUBE_CENTER - CUBE_SIDE/2, CUBE_CENTER + CUBE_SIDE/2, .z = CUBE_CENTER_Z - CUBE_SIDE/2},
-    {CUBE_CENTER + CUBE_SIDE/2, CUBE_CENTER + CUBE_SIDE/2, .z = CUBE_CENTER_Z - CUBE_SIDE/2},
-    {CUBE_CENTER + CUBE_SIDE/2, CUBE_CENTER - CUBE_SIDE/2, .z = CUBE_CENTER_Z - CUBE_SIDE/2},
-
-    //BACK CORNERS
-    {CUBE_CENTER - CUBE_SIDE/2, CUBE_CENTER - CUBE_SIDE/2, .z = CUBE_CENTER_Z + CUBE_SIDE/2},
-    {CUBE_CENTER - CUBE_SIDE/2, CUBE_CENTER + CUBE_SIDE/2, .z = CUBE_CENTER_Z + CUBE_SIDE/2},
-    {CUBE_CENTER + CUBE_SIDE/2, CUBE_CENTER + CUBE_SIDE/2, .z = CUBE_CENTER_Z + CUBE_SIDE/2},
-    {CUBE_CENTER + CUBE_SIDE/2, CUBE_CENTER - CUBE_SIDE/2, .z = CUBE_CENTER_Z + CUBE_SIDE/2},
-};
-
-static void faceSortClear(struct face **sortedFaces, int numberOfFaces) {
-    memset(sortedFaces, 0, numberOfFaces * sizeof(struct face *));
-}
-
-
-/**
- * @brief Returns returns true if faceOne is closest to cam, otherwise positive
- *
- * @param faceOne
- * @param faceTwo
- *
- * @return 
- */
-static bool compareFaces(struct face *faceOne, struct face *faceTwo)
-{
-    int coord = 0;
-    double faceOneMin = faceOne->coords[coord]->z;
-    double faceTwoMin = faceTwo->coords[coord]->z;
-    for (; coord < 4; coord++){
-        faceOneMin = fmin(faceOneMin, faceOne->coords[coord]->z);
-        faceTwoMin = fmin(faceTwoMin, faceTwo->coords[coord]->z);
-    }
-    return (faceOneMin < faceTwoMin);
-
-
-}
-
-static void mat_mul(double Rout[3][3], double A[3][3], double B[3][3]) {
-
-    // Rout = AB;
-    for (int a = 0; a < 3; a++)
-        for (int b = 0; b < 3; b++)
-            Rout[a][b] = A[0][a]*B[b][0] +A[1][a]*B[b][1] +A[2][a]*B[b][2];
+  int charWidth = (int)(charSize * FONT_SIZE_RATIO);
+  // The text starts one character in.
+  glyphBatchAddLine(string, strlen(string), x + charWidth, y, charWidth, charSize);
 }
 
-static void rotateCube(double phi_x, double phi_y, double phi_z) {
-    double Ry[3][3] = 
-    {
-        {cos(phi_x), 0, sin(phi_x)},
-        {0,1,0},
-        {-sin(phi_x), 0, cos(phi_x)}
-    };
-    double Rx[3][3] = 
-    {
-        {1,0,0},
-        {0,cos(phi_y),-sin(phi_y)},
-        {0,sin(phi_y),cos(phi_y)}
-    };
-    double Rz[3][3] = 
+static void drawLens(const worldSnapshotS* world_p)
+{
+    // The bumps the world added since the last frame, as many as it still remembers.
+    if (world_p->numLensBumps - lensBumpsApplied > WORLD_LENS_BUMPS) lensBumpsApplied = world_p->numLensBumps - WORLD_LENS_BUMPS;
+    for (; lensBumpsApplied < world_p->numLensBumps; lensBumpsApplied++)
     {
-        {cos(phi_z),-sin(phi_z), 0},
-        {sin(phi_z),cos(phi_z), 0},
-        {0,0,1},
-    };
-
-    double Rinter[3][3];
-    double Rtot[3][3];
-
-    mat_mul(Rinter, Rx, Ry);
-    mat_mul(Rtot, Rinter, Rz);
-
-
-    for (int i = 0; i < 8; i++) {
-        double x = corners[i].x;
-        double y = corners[i].y;
-        double z = corners[i].z - CUBE_CENTER_Z;
-        corners[i].x = Rtot[0][0] * x + Rtot[0][1] * y + Rtot[0][2] * z;
-        corners[i].y = Rtot[1][0] * x + Rtot[1][1] * y + Rtot[1][2] * z;
-        corners[i].z =+ CUBE_CENTER_Z + Rtot[2][0] * x  + Rtot[2][1] * y  + Rtot[2][2] * z;
+        bumpMapAdd(&bumpMap, &world_p->lensBumps[lensBumpsApplied % WORLD_LENS_BUMPS], LENS_BUMP_AMOUNT);
     }
+    // Only the parts touched since the last frame are uploaded.
+    bumpMapUpload(&bumpMap, lensTexture_p);
 
+    if (SDL_RenderCopy(myRenderer_p, lensTexture_p, NULL, NULL)) printf("Error when RenderCopy: %s\n", SDL_GetError());
 }
 
-static void faceSortInsert(struct face *thisFace, struct face **sortedFaces)
+static void drawClouds(const worldSnapshotS* world_p)
 {
-    struct face ** nextFaceSlot = sortedFaces;
-    int count =0;
-
-    while (*nextFaceSlot != NULL) {
-       count++;
-        if (compareFaces(*nextFaceSlot, thisFace)) {
-            faceSortInsert(*nextFaceSlot,nextFaceSlot++);
-            break;
-        }
-        nextFaceSlot++;
-    }
-    *nextFaceSlot = thisFace;
-}
-
-static void initCube()
-{
-    // init faces
-    // FRONT
-    cube.faces[0].coords[0] = &corners[0];
-    cube.faces[0].coords[1] = &corners[1];
-    cube.faces[0].coords[2] = &corners[2];
-    cube.faces[0].coords[3] = &corners[3];
-
-    //LEFT SIDE
-    cube.faces[1].coords[0] = &corners[0];
-    cube.faces[1].coords[1] = &corners[1];
-    cube.faces[1].coords[2] = &corners[5];
-    cube.faces[1].coords[3] = &corners[4];
-
-    //UPSIDE
-    cube.faces[2].coords[0] = &corners[1];
-    cube.faces[2].coords[1] = &corners[2];
-    cube.faces[2].coords[2] = &corners[6];
-    cube.faces[2].coords[3] = &corners[5];
-
-    //RIGTH SIDE
-    cube.faces[3].coords[0] = &corners[2];
-    cube.faces[3].coords[1] = &corners[3];
-    cube.faces[3].coords[2] = &corners[7];
-    cube.faces[3].coords[3] = &corners[6];
-
-    //DOWN SIDE
-    cube.faces[4].coords[0] = &corners[3];
-    cube.faces[4].coords[1] = &corners[0];
-    cube.faces[4].coords[2] = &corners[4];
-    cube.faces[4].coords[3] = &corners[7];
-
-    //BACK SIDE
-    cube.faces[5].coords[0] = &corners[4];
-    cube.faces[5].coords[1] = &corners[5];
-    cube.faces[5].coords[2] = &corners[6];
-    cube.faces[5].coords[3] = &corners[7];
-
-    printf("about to clear\n");
-    faceSortClear(cube.sortedFaces, 6);
-    for (int i = 0; i < 6; i++) {
-    printf("sort %d\n", i);
-        faceSortInsert(&cube.faces[i], cube.sortedFaces);
-    }
+  const worldCloudS* clouds = world_p->clouds;
+  for (int i = 0; i < world_p->numClouds; i++)
+  {
+    //printf("Cloud %d, x %d y %d\n", i, clouds[i].x, clouds[i].y);
+    SDL_Rect sourceRect;
+    sourceRect.x = cloudsOrigin.x + 82;
+    sourceRect.y = cloudsOrigin.y + clouds[i].spriteY;
+    sourceRect.h = 20;
+    sourceRect.w = 149 - 82;
+    SDL_Rect destRect;
+    int height = clouds[i].height; 
+    int width =  clouds[i].width;
+    destRect.x = clouds[i].x;
+    destRect.y = clouds[i].y; 
+    destRect.w = width;
+    destRect.h = height;
+
+    if (SDL_RenderCopy(myRenderer_p, spritesTexture_p, &sourceRect, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+  }
 }
 
-static void drawCube()
-{
-    double phi_x = 0.0001;
-    double phi_y = 0.0005;
-    double phi_z = 0.0003;
-    rotateCube(phi_x, phi_y, phi_z);
-
-    SDL_SetRenderDrawColor(myRenderer_p, 255, 255, 255, SDL_ALPHA_OPAQUE);
-
-    // for each sorted face
-    for (int face = 0; face < 6; face ++) {
-        // for each coord draw line to next
-        for (int coord = 0; coord < 3; coord++) {
-            struct coord *start_corner = cube.sortedFaces[face]->coords[coord];
-            struct coord *end_corner = cube.sortedFaces[face]->coords[coord + 1];
-//            printf("Drawing %dx%d to %dx%d\n", (int)start_corner->x, (int)start_corner->y, (int)end_corner->x, (int)end_corner->y); 
-//
-            if( SDL_RenderDrawLine(myRenderer_p,
-                    DISPLAY_Z*start_corner->x/start_corner->z + DISPLAY_X,
-                    DISPLAY_Z*start_corner->y/start_corner->z + DISPLAY_Y,
-                    DISPLAY_Z*end_corner->x/end_corner->z + DISPLAY_X,
-                    DISPLAY_Z*end_corner->y/end_corner->z + DISPLAY_Y)) printf("Failed to draw line\n");
-        }
-    }
+static void drawMesh(const worldSnapshotS* world_p)
+{
+    static const meshViewS view =
+    {
+        .focalLength = MESH_FOCAL_LENGTH,
+        .centerX = WIN_WIDTH/2,
+        .centerY = WIN_HEIGHT/2,
+        .distance = MESH_DISTANCE,
+        .scale = MESH_SCALE,
+        .flags = MESH_FILL,
+        .fill = {200, 200, 220, SDL_ALPHA_OPAQUE},
+        .outline = {255, 255, 255, SDL_ALPHA_OPAQUE},
+    };
+    if (!meshLoaded) return;
+    memcpy(mesh.orientation, world_p->meshOrientation, sizeof(mesh.orientation));
+    meshDraw(&mesh, myRenderer_p, &view);
 }
-
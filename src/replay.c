@@ -0,0 +1,214 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <replay.h>
+
+/*
+ * File layout, all integers little endian:
+ *   "SCRP", version (u32), seed (u32), columns (u32), rows (u32)
+ * followed by events:
+ *   type (u8), microseconds since the previous event (varint), then
+ *   REPLAY_KEY:   sym (zigzag varint), mod (varint)
+ *   REPLAY_SPAWN: charIndex + 1 (varint), pos + 1 (varint)
+ * A varint stores 7 bits per byte, low bits first, with the top bit set on all but the last.
+ */
+#define REPLAY_MAGIC "SCRP"
+#define REPLAY_VERSION 1
+#define WRITE_BUFFER_SIZE (64 * 1024)
+
+static FILE* recordFile_p = NULL;
+static SDL_mutex* recordMutex_p = NULL; // Keys and spawns are recorded from different threads.
+static uint64_t recordStartCounter = 0;
+static uint64_t lastRecordedUs = 0;
+
+static FILE* playFile_p = NULL;
+static uint64_t lastPlayedUs = 0;
+
+static void writeU32(FILE* file_p, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    fputc((value >> (8 * i)) & 0xFF, file_p);
+  }
+}
+
+static bool readU32(FILE* file_p, uint32_t* value_p)
+{
+  *value_p = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    int byte = fgetc(file_p);
+    if (byte == EOF) return false;
+    *value_p |= (uint32_t)byte << (8 * i);
+  }
+  return true;
+}
+
+static void writeVarint(FILE* file_p, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    fputc((value & 0x7F) | 0x80, file_p);
+    value >>= 7;
+  }
+  fputc((int)value, file_p);
+}
+
+static bool readVarint(FILE* file_p, uint64_t* value_p)
+{
+  *value_p = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+  {
+    int byte = fgetc(file_p);
+    if (byte == EOF) return false;
+    *value_p |= (uint64_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+static uint64_t zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint64_t value)
+{
+  return (int32_t)((uint32_t)(value >> 1) ^ -(uint32_t)(value & 1));
+}
+
+bool replayStartRecording(const char* path, const replayHeaderS* header_p)
+{
+  recordFile_p = fopen(path, "wb");
+  if (recordFile_p == NULL)
+  {
+    printf("Could not create replay file %s.\n", path);
+    return false;
+  }
+  setvbuf(recordFile_p, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+  recordMutex_p = SDL_CreateMutex();
+
+  fwrite(REPLAY_MAGIC, 1, strlen(REPLAY_MAGIC), recordFile_p);
+  writeU32(recordFile_p, REPLAY_VERSION);
+  writeU32(recordFile_p, header_p->seed);
+  writeU32(recordFile_p, header_p->columns);
+  writeU32(recordFile_p, header_p->rows);
+
+  recordStartCounter = SDL_GetPerformanceCounter();
+  lastRecordedUs = 0;
+  return true;
+}
+
+bool replayIsRecording(void)
+{
+  return recordFile_p != NULL;
+}
+
+/* Writes the type and time of an event. Called with recordMutex_p held. */
+static void writeEventStart(replayEventTypeE type)
+{
+  uint64_t ticks = SDL_GetPerformanceCounter() - recordStartCounter;
+  uint64_t nowUs = ticks / SDL_GetPerformanceFrequency() * 1000000 +
+                   ticks % SDL_GetPerformanceFrequency() * 1000000 / SDL_GetPerformanceFrequency();
+  // Another thread may stamp an event just before one that gets the mutex first.
+  if (nowUs < lastRecordedUs) nowUs = lastRecordedUs;
+  fputc(type, recordFile_p);
+  writeVarint(recordFile_p, nowUs - lastRecordedUs);
+  lastRecordedUs = nowUs;
+}
+
+void replayRecordKey(int32_t sym, uint16_t mod)
+{
+  if (recordFile_p == NULL) return;
+  SDL_LockMutex(recordMutex_p);
+  writeEventStart(REPLAY_KEY);
+  writeVarint(recordFile_p, zigzag(sym));
+  writeVarint(recordFile_p, mod);
+  SDL_UnlockMutex(recordMutex_p);
+}
+
+void replayRecordSpawn(int charIndex, int pos)
+{
+  if (recordFile_p == NULL) return;
+  SDL_LockMutex(recordMutex_p);
+  writeEventStart(REPLAY_SPAWN);
+  writeVarint(recordFile_p, (uint64_t)(charIndex + 1));
+  writeVarint(recordFile_p, (uint64_t)(pos + 1));
+  SDL_UnlockMutex(recordMutex_p);
+}
+
+void replayStopRecording(void)
+{
+  if (recordFile_p == NULL) return;
+  SDL_LockMutex(recordMutex_p);
+  fclose(recordFile_p);
+  recordFile_p = NULL;
+  SDL_UnlockMutex(recordMutex_p);
+  SDL_DestroyMutex(recordMutex_p);
+  recordMutex_p = NULL;
+}
+
+bool replayOpen(const char* path, replayHeaderS* header_p)
+{
+  char magic[4];
+  uint32_t version;
+  playFile_p = fopen(path, "rb");
+  if (playFile_p == NULL)
+  {
+    printf("Could not open replay file %s.\n", path);
+    return false;
+  }
+  if (fread(magic, 1, sizeof(magic), playFile_p) != sizeof(magic) ||
+      memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0 ||
+      !readU32(playFile_p, &version) ||
+      version != REPLAY_VERSION ||
+      !readU32(playFile_p, &header_p->seed) ||
+      !readU32(playFile_p, &header_p->columns) ||
+      !readU32(playFile_p, &header_p->rows))
+  {
+    printf("%s is not a replay file this version can play.\n", path);
+    replayClose();
+    return false;
+  }
+  lastPlayedUs = 0;
+  return true;
+}
+
+bool replayRead(replayEventS* event_p)
+{
+  uint64_t deltaUs, first, second;
+  if (playFile_p == NULL) return false;
+
+  int type = fgetc(playFile_p);
+  if (type == EOF) return false;
+  if (!readVarint(playFile_p, &deltaUs) ||
+      !readVarint(playFile_p, &first) ||
+      !readVarint(playFile_p, &second))
+  {
+    printf("Replay file ends in the middle of an event.\n");
+    return false;
+  }
+  lastPlayedUs += deltaUs;
+  event_p->timeUs = lastPlayedUs;
+  event_p->type = type;
+  switch (type)
+  {
+    case REPLAY_KEY:
+      event_p->key.sym = unzigzag(first);
+      event_p->key.mod = (uint16_t)second;
+      return true;
+    case REPLAY_SPAWN:
+      event_p->spawn.charIndex = (int)first - 1;
+      event_p->spawn.pos = (int)second - 1;
+      return true;
+    default:
+      printf("Unknown event %d in replay file.\n", type);
+      return false;
+  }
+}
+
+void replayClose(void)
+{
+  if (playFile_p != NULL) fclose(playFile_p);
+  playFile_p = NULL;
+}
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <string.h>
+#include <scoreIndex.h>
+
+#define START_NAME_CAPACITY 64
+
+static int bucket(int score)
+{
+  int offset = score - SCORE_INDEX_MIN;
+  if (offset < 0) offset = 0;
+  if (offset >= SCORE_INDEX_BUCKETS) offset = SCORE_INDEX_BUCKETS - 1;
+  return offset + 1; // The tree counts from 1.
+}
+
+/* nameKey() packs the first 4 characters of the name, 0 for an empty name. */
+static uint32_t nameKey(const char* name_p)
+{
+  uint32_t key = 0;
+  for (int i = 0; i < 4 && name_p[i] != '\0'; i++)
+  {
+    key |= (uint32_t)(unsigned char)name_p[i] << (8 * i);
+  }
+  return key;
+}
+
+/* findName() returns the slot of the key, or the empty slot where it belongs. */
+static scoreIndexNameS* findName(const scoreIndexS* index_p, uint32_t key)
+{
+  int mask = index_p->nameCapacity - 1;
+  int slot = (int)((key * 2654435761u) >> 7) & mask;
+  while (index_p->names_p[slot].key != 0 && index_p->names_p[slot].key != key)
+  {
+    slot = (slot + 1) & mask;
+  }
+  return &index_p->names_p[slot];
+}
+
+static bool growNames(scoreIndexS* index_p)
+{
+  scoreIndexS grown = *index_p;
+  grown.nameCapacity = index_p->nameCapacity * 2;
+  grown.names_p = calloc(grown.nameCapacity, sizeof(scoreIndexNameS));
+  if (grown.names_p == NULL) return false;
+  for (int i = 0; i < index_p->nameCapacity; i++)
+  {
+    if (index_p->names_p[i].key != 0) *findName(&grown, index_p->names_p[i].key) = index_p->names_p[i];
+  }
+  free(index_p->names_p);
+  index_p->names_p = grown.names_p;
+  index_p->nameCapacity = grown.nameCapacity;
+  return true;
+}
+
+bool scoreIndexInit(scoreIndexS* index_p)
+{
+  memset(index_p, 0, sizeof(scoreIndexS));
+  index_p->tree_p = calloc(SCORE_INDEX_BUCKETS + 1, sizeof(uint32_t));
+  index_p->nameCapacity = START_NAME_CAPACITY;
+  index_p->names_p = calloc(index_p->nameCapacity, sizeof(scoreIndexNameS));
+  if (index_p->tree_p == NULL || index_p->names_p == NULL)
+  {
+    scoreIndexDestroy(index_p);
+    return false;
+  }
+  return true;
+}
+
+void scoreIndexDestroy(scoreIndexS* index_p)
+{
+  free(index_p->tree_p);
+  free(index_p->names_p);
+  memset(index_p, 0, sizeof(scoreIndexS));
+}
+
+void scoreIndexAdd(scoreIndexS* index_p, const char* name_p, int score)
+{
+  for (int i = bucket(score); i <= SCORE_INDEX_BUCKETS; i += i & -i)
+  {
+    index_p->tree_p[i]++;
+  }
+  index_p->count++;
+
+  uint32_t key = nameKey(name_p);
+  if (key == 0) return;
+  scoreIndexNameS* entry_p = findName(index_p, key);
+  if (entry_p->key == key)
+  {
+    if (score > entry_p->best) entry_p->best = score;
+    return;
+  }
+  if (2 * (index_p->numNames + 1) > index_p->nameCapacity)
+  {
+    // Without room the best of a new name is not kept, the game is counted anyway.
+    if (!growNames(index_p)) return;
+    entry_p = findName(index_p, key);
+  }
+  entry_p->key = key;
+  entry_p->best = score;
+  index_p->numNames++;
+}
+
+uint64_t scoreIndexAbove(const scoreIndexS* index_p, int score)
+{
+  uint64_t notAbove = 0;
+  for (int i = bucket(score); i > 0; i -= i & -i)
+  {
+    notAbove += index_p->tree_p[i];
+  }
+  return index_p->count - notAbove;
+}
+
+bool scoreIndexBest(const scoreIndexS* index_p, const char* name_p, int* best_p)
+{
+  uint32_t key = nameKey(name_p);
+  if (key == 0) return false;
+  const scoreIndexNameS* entry_p = findName(index_p, key);
+  if (entry_p->key != key) return false;
+  *best_p = entry_p->best;
+  return true;
+}
@@ -0,0 +1,539 @@
+#include <SDL.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <scoreIndex.h>
+#include <trace.h>
+#include <scoreStore.h>
+
+#define LOG_MAGIC 0x4C524353u // "SCRL"
+#define LOG_VERSION 1
+#define MAX_PATH_SIZE 1024
+#define MAX_PENDING 256    // Scores added but not written yet.
+#define READ_CHUNK 4096    // Records read at a time.
+#define COMPACT_TAIL 4096  // Unsorted records that make the writer sort the log.
+
+typedef struct logHeaderS
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t sortedRecords; // Best first, the records after them are not sorted.
+} logHeaderS;
+
+typedef struct logRecordS
+{
+  char name[MAX_NBR_NAME_CHARS + 1];
+  int32_t score;
+  uint32_t time;  // Seconds since 1970 when the game ended.
+  uint32_t check; // Of the bytes before it.
+} logRecordS;
+
+static char logPath[MAX_PATH_SIZE];
+static char lockPath[MAX_PATH_SIZE];
+static char tempPath[MAX_PATH_SIZE];
+static int lockFd = -1;
+static SDL_Thread* thread_p = NULL;
+
+static SDL_mutex* lock_p = NULL; // Guards the scores in memory and the queue.
+static SDL_cond* wakeCond_p = NULL;
+static bool quit = false;
+static scoreS top[SCORE_STORE_TOP];
+static int numTop = 0;
+static logRecordS pending[MAX_PENDING];
+static int numPending = 0;
+static scoreIndexS history;         // Every game in the log or queued, for ranking.
+static bool historyReady = false;   // Once the writer thread has read the whole log.
+
+// The log as the writer thread last saw it.
+static dev_t logDevice;
+static ino_t logInode;
+static off_t logEnd = 0;          // Of the last whole record.
+static uint64_t tailRecords = 0;  // After the sorted ones.
+static bool damaged = false;      // Records with a bad checksum were found.
+
+static uint32_t checksum(const logRecordS* record_p)
+{
+  // FNV-1a.
+  const uint8_t* byte_p = (const uint8_t*)record_p;
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < offsetof(logRecordS, check); i++)
+  {
+    hash = (hash ^ byte_p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static logRecordS makeRecord(const char* name_p, int score, uint32_t seconds)
+{
+  logRecordS record;
+  memset(&record, 0, sizeof(record));
+  snprintf(record.name, sizeof(record.name), "%s", name_p);
+  record.score = score;
+  record.time = seconds;
+  record.check = checksum(&record);
+  return record;
+}
+
+static bool recordValid(const logRecordS* record_p)
+{
+  return record_p->check == checksum(record_p) && memchr(record_p->name, '\0', sizeof(record_p->name)) != NULL;
+}
+
+/* insertTop() puts the score among the best, ahead of equal ones. Called with lock_p held. */
+static void insertTop(const char* name_p, int score)
+{
+  int i = 0;
+  while (i < numTop && top[i].score > score) i++;
+  if (i >= SCORE_STORE_TOP) return;
+  int last = (numTop < SCORE_STORE_TOP) ? numTop : SCORE_STORE_TOP - 1;
+  memmove(&top[i + 1], &top[i], (last - i) * sizeof(scoreS));
+  snprintf(top[i].name, sizeof(top[i].name), "%s", name_p);
+  top[i].score = score;
+  if (numTop < SCORE_STORE_TOP) numTop++;
+}
+
+static bool readFull(int fd, void* data_p, size_t size, off_t offset)
+{
+  while (size > 0)
+  {
+    ssize_t done = pread(fd, data_p, size, offset);
+    if (done < 0 && errno == EINTR) continue;
+    if (done <= 0) return false;
+    data_p = (uint8_t*)data_p + done;
+    size -= done;
+    offset += done;
+  }
+  return true;
+}
+
+static bool writeFull(int fd, const void* data_p, size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t done = write(fd, data_p, size);
+    if (done < 0 && errno == EINTR) continue;
+    if (done <= 0) return false;
+    data_p = (const uint8_t*)data_p + done;
+    size -= done;
+  }
+  return true;
+}
+
+static void lockLog(int operation)
+{
+  while (flock(lockFd, operation) != 0 && errno == EINTR);
+}
+
+/* wholeRecordsEnd() returns where the last whole record of a log of size bytes ends. */
+static off_t wholeRecordsEnd(off_t size)
+{
+  if (size < (off_t)sizeof(logHeaderS)) return sizeof(logHeaderS);
+  return size - (size - sizeof(logHeaderS)) % sizeof(logRecordS);
+}
+
+/* mergeRecords() adds the records from start to end to the best scores. Returns how many there
+ * were. */
+static uint64_t mergeRecords(int fd, off_t start, off_t end)
+{
+  static logRecordS records[READ_CHUNK];
+  uint64_t numRecords = 0;
+  while (start < end)
+  {
+    int count = (int)((end - start) / sizeof(logRecordS));
+    if (count > READ_CHUNK) count = READ_CHUNK;
+    if (!readFull(fd, records, count * sizeof(logRecordS), start)) break;
+    SDL_LockMutex(lock_p);
+    for (int i = 0; i < count; i++)
+    {
+      if (!recordValid(&records[i]))
+      {
+        damaged = true;
+        continue;
+      }
+      insertTop(records[i].name, records[i].score);
+      if (historyReady) scoreIndexAdd(&history, records[i].name, records[i].score);
+    }
+    SDL_UnlockMutex(lock_p);
+    start += count * sizeof(logRecordS);
+    numRecords += count;
+  }
+  return numRecords;
+}
+
+/*
+ * loadLog() reads the best scores from the log, the first of the sorted records and all of the
+ * others. The scores of unwritten, the numUnwritten records not in the log yet, and of the queue
+ * are added again. Called with the log locked.
+ */
+static bool loadLog(const logRecordS* unwritten_p, int numUnwritten)
+{
+  TRACE_SCOPE("scoreStore load");
+  int fd = open(logPath, O_RDONLY);
+  struct stat status;
+  logHeaderS header;
+  if (fd < 0 || fstat(fd, &status) != 0 ||
+      !readFull(fd, &header, sizeof(header), 0) ||
+      header.magic != LOG_MAGIC || header.version != LOG_VERSION)
+  {
+    printf("%s is not a score log this version can read.\n", logPath);
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  logDevice = status.st_dev;
+  logInode = status.st_ino;
+  logEnd = wholeRecordsEnd(status.st_size);
+  uint64_t numRecords = (logEnd - sizeof(logHeaderS)) / sizeof(logRecordS);
+  uint64_t sorted = header.sortedRecords < numRecords ? header.sortedRecords : numRecords;
+
+  logRecordS records[SCORE_STORE_TOP];
+  int numBest = sorted < SCORE_STORE_TOP ? (int)sorted : SCORE_STORE_TOP;
+  if (!readFull(fd, records, numBest * sizeof(logRecordS), sizeof(logHeaderS))) numBest = 0;
+  SDL_LockMutex(lock_p);
+  numTop = 0;
+  for (int i = 0; i < numBest; i++)
+  {
+    // Already in order, newest first among equal scores.
+    if (!recordValid(&records[i]))
+    {
+      damaged = true;
+      continue;
+    }
+    snprintf(top[numTop].name, sizeof(top[numTop].name), "%s", records[i].name);
+    top[numTop++].score = records[i].score;
+  }
+  SDL_UnlockMutex(lock_p);
+
+  tailRecords = mergeRecords(fd, sizeof(logHeaderS) + sorted * sizeof(logRecordS), logEnd);
+  close(fd);
+
+  SDL_LockMutex(lock_p);
+  for (int i = 0; i < numUnwritten; i++) insertTop(unwritten_p[i].name, unwritten_p[i].score);
+  for (int i = 0; i < numPending; i++) insertTop(pending[i].name, pending[i].score);
+  SDL_UnlockMutex(lock_p);
+  return true;
+}
+
+/* createLog() creates an empty log, with the scores of the text score board in it. Called with
+ * the log locked. */
+static bool createLog(const char* legacyPath_p)
+{
+  int fd = open(logPath, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+  {
+    if (errno == EEXIST) return true; // Another instance was first.
+    printf("Could not create score log %s.\n", logPath);
+    return false;
+  }
+  logHeaderS header = {LOG_MAGIC, LOG_VERSION, 0};
+  bool written = writeFull(fd, &header, sizeof(header));
+  FILE* legacy_p = (legacyPath_p != NULL) ? fopen(legacyPath_p, "r") : NULL;
+  if (legacy_p != NULL)
+  {
+    char name[255];
+    int score = 0;
+    uint32_t seconds = (uint32_t)time(NULL);
+    while (written && fscanf(legacy_p, "%254s %d\n", name, &score) == 2)
+    {
+      logRecordS record = makeRecord(name, score, seconds);
+      written = writeFull(fd, &record, sizeof(record));
+    }
+    fclose(legacy_p);
+  }
+  written = fsync(fd) == 0 && written;
+  close(fd);
+  if (!written) printf("Could not write score log %s.\n", logPath);
+  return written;
+}
+
+/* indexLog() counts every game of the log, up to logEnd, in a new history. The numUnwritten
+ * records at unwritten_p, not in the log yet, and the queue are counted too. Called with the log
+ * locked. */
+static void indexLog(const logRecordS* unwritten_p, int numUnwritten)
+{
+  TRACE_SCOPE("scoreStore index");
+  static logRecordS records[READ_CHUNK];
+  scoreIndexS index;
+  int fd = open(logPath, O_RDONLY);
+  if (fd < 0 || !scoreIndexInit(&index))
+  {
+    printf("Could not index score log %s.\n", logPath);
+    if (fd >= 0) close(fd);
+    return;
+  }
+  for (off_t start = sizeof(logHeaderS); start < logEnd; )
+  {
+    int count = (int)((logEnd - start) / sizeof(logRecordS));
+    if (count > READ_CHUNK) count = READ_CHUNK;
+    if (!readFull(fd, records, count * sizeof(logRecordS), start)) break;
+    for (int i = 0; i < count; i++)
+    {
+      if (recordValid(&records[i])) scoreIndexAdd(&index, records[i].name, records[i].score);
+    }
+    start += count * sizeof(logRecordS);
+  }
+  close(fd);
+
+  SDL_LockMutex(lock_p);
+  if (historyReady) scoreIndexDestroy(&history);
+  history = index;
+  for (int i = 0; i < numUnwritten; i++) scoreIndexAdd(&history, unwritten_p[i].name, unwritten_p[i].score);
+  for (int i = 0; i < numPending; i++) scoreIndexAdd(&history, pending[i].name, pending[i].score);
+  historyReady = true;
+  SDL_UnlockMutex(lock_p);
+}
+
+/* catchUp() takes in what other instances wrote to the log since the last time, status_p is of
+ * the log as it is now. The numUnwritten records at unwritten_p are not in the log yet. Called
+ * with the log locked. */
+static bool catchUp(int fd, const struct stat* status_p, const logRecordS* unwritten_p, int numUnwritten)
+{
+  if (status_p->st_dev != logDevice || status_p->st_ino != logInode)
+  {
+    // Another instance compacted the log into a new file, read it from the start.
+    if (!loadLog(unwritten_p, numUnwritten)) return false;
+    indexLog(unwritten_p, numUnwritten);
+    return true;
+  }
+  off_t end = wholeRecordsEnd(status_p->st_size);
+  tailRecords += mergeRecords(fd, logEnd, end);
+  logEnd = end;
+  return true;
+}
+
+/* appendRecords() writes the records at the end of the log, after taking in what other
+ * instances appended since the last time. Called with the log locked. */
+static void appendRecords(const logRecordS* records_p, int numRecords)
+{
+  TRACE_SCOPE("scoreStore append");
+  int fd = open(logPath, O_RDWR | O_APPEND);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0 || !catchUp(fd, &status, records_p, numRecords))
+  {
+    printf("Could not open score log %s, %d scores are lost.\n", logPath, numRecords);
+    if (fd >= 0) close(fd);
+    return;
+  }
+  // A record cut short by a crash would shift every record after it.
+  if (status.st_size != logEnd && ftruncate(fd, logEnd) != 0)
+  {
+    printf("Could not repair score log %s.\n", logPath);
+  }
+  if (writeFull(fd, records_p, numRecords * sizeof(logRecordS)) && fdatasync(fd) == 0)
+  {
+    logEnd += numRecords * sizeof(logRecordS);
+    tailRecords += numRecords;
+  }
+  else
+  {
+    printf("Could not write score log %s.\n", logPath);
+  }
+  close(fd);
+}
+
+static int compareRecords(const void* a_p, const void* b_p)
+{
+  const logRecordS* a = a_p;
+  const logRecordS* b = b_p;
+  if (a->score != b->score) return (a->score < b->score) - (a->score > b->score);
+  return (a->time < b->time) - (a->time > b->time);
+}
+
+/* compactLog() writes the valid records sorted best first into a new file, which replaces the
+ * log. Called with the log locked. */
+static void compactLog(void)
+{
+  TRACE_SCOPE("scoreStore compact");
+  int fd = open(logPath, O_RDONLY);
+  if (fd < 0) return;
+  uint64_t numRecords = (logEnd - sizeof(logHeaderS)) / sizeof(logRecordS);
+  logRecordS* records_p = malloc(numRecords * sizeof(logRecordS) + 1);
+  bool loaded = records_p != NULL &&
+                readFull(fd, records_p, numRecords * sizeof(logRecordS), sizeof(logHeaderS));
+  close(fd);
+  if (!loaded)
+  {
+    printf("Could not read score log %s to compact it.\n", logPath);
+    free(records_p);
+    return;
+  }
+  uint64_t numValid = 0;
+  for (uint64_t i = 0; i < numRecords; i++)
+  {
+    if (recordValid(&records_p[i])) records_p[numValid++] = records_p[i];
+  }
+  qsort(records_p, numValid, sizeof(logRecordS), compareRecords);
+
+  logHeaderS header = {LOG_MAGIC, LOG_VERSION, numValid};
+  fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool written = fd >= 0 &&
+                 writeFull(fd, &header, sizeof(header)) &&
+                 writeFull(fd, records_p, numValid * sizeof(logRecordS)) &&
+                 fsync(fd) == 0;
+  struct stat status;
+  written = fd >= 0 && fstat(fd, &status) == 0 && written;
+  if (fd >= 0) close(fd);
+  free(records_p);
+  // The new log is complete on disk before it takes the place of the old one.
+  if (!written || rename(tempPath, logPath) != 0)
+  {
+    printf("Could not compact score log %s.\n", logPath);
+    unlink(tempPath);
+    return;
+  }
+  logDevice = status.st_dev;
+  logInode = status.st_ino;
+  logEnd = status.st_size;
+  tailRecords = 0;
+  damaged = false;
+}
+
+static int writer(void* unused_p)
+{
+  TRACE_THREAD_NAME("scores");
+  static logRecordS batch[MAX_PENDING];
+
+  // The whole history is only read here, so the game starts without waiting for it.
+  lockLog(LOCK_SH);
+  int fd = open(logPath, O_RDONLY);
+  struct stat status;
+  if (fd >= 0 && fstat(fd, &status) == 0 && catchUp(fd, &status, NULL, 0) && !historyReady)
+  {
+    indexLog(NULL, 0);
+  }
+  if (fd >= 0) close(fd);
+  lockLog(LOCK_UN);
+
+  SDL_LockMutex(lock_p);
+  while (true)
+  {
+    while (!quit && numPending == 0) SDL_CondWait(wakeCond_p, lock_p);
+    if (numPending == 0) break; // Quitting, with everything written.
+    int numBatch = numPending;
+    memcpy(batch, pending, numBatch * sizeof(logRecordS));
+    numPending = 0;
+    SDL_UnlockMutex(lock_p);
+
+    lockLog(LOCK_EX);
+    appendRecords(batch, numBatch);
+    if (tailRecords > COMPACT_TAIL || damaged) compactLog();
+    lockLog(LOCK_UN);
+
+    SDL_LockMutex(lock_p);
+  }
+  SDL_UnlockMutex(lock_p);
+  return 0;
+}
+
+bool scoreStoreInit(const char* path_p, const char* legacyPath_p)
+{
+  snprintf(logPath, sizeof(logPath), "%s", path_p);
+  snprintf(lockPath, sizeof(lockPath), "%s.lock", path_p);
+  snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", path_p, (long)getpid());
+  lock_p = SDL_CreateMutex();
+  wakeCond_p = SDL_CreateCond();
+  if (lock_p == NULL || wakeCond_p == NULL)
+  {
+    printf("Could not create score store locks: %s\n", SDL_GetError());
+    return false;
+  }
+  lockFd = open(lockPath, O_RDWR | O_CREAT, 0644);
+  if (lockFd < 0)
+  {
+    printf("Could not open score lock %s, scores are not saved.\n", lockPath);
+    return false;
+  }
+
+  lockLog(LOCK_EX);
+  bool loaded = (access(logPath, F_OK) == 0 || createLog(legacyPath_p)) && loadLog(NULL, 0);
+  lockLog(LOCK_UN);
+  if (!loaded) return false;
+
+  quit = false;
+  thread_p = SDL_CreateThread(writer, "scores", NULL);
+  if (thread_p == NULL)
+  {
+    printf("Could not start the score writer: %s\n", SDL_GetError());
+    return false;
+  }
+  return true;
+}
+
+void scoreStoreDestroy(void)
+{
+  if (thread_p != NULL)
+  {
+    SDL_LockMutex(lock_p);
+    quit = true;
+    SDL_CondSignal(wakeCond_p);
+    SDL_UnlockMutex(lock_p);
+    SDL_WaitThread(thread_p, NULL);
+    thread_p = NULL;
+  }
+  if (lockFd >= 0) close(lockFd);
+  lockFd = -1;
+  if (historyReady) scoreIndexDestroy(&history);
+  historyReady = false;
+  SDL_DestroyCond(wakeCond_p);
+  SDL_DestroyMutex(lock_p);
+  wakeCond_p = NULL;
+  lock_p = NULL;
+}
+
+int scoreStoreTop(scoreS* scores_p, int maxScores)
+{
+  if (lock_p == NULL) return 0;
+  SDL_LockMutex(lock_p);
+  int count = numTop < maxScores ? numTop : maxScores;
+  memcpy(scores_p, top, count * sizeof(scoreS));
+  SDL_UnlockMutex(lock_p);
+  return count;
+}
+
+void scoreStoreAdd(const scoreS* score_p)
+{
+  if (lock_p == NULL) return;
+  SDL_LockMutex(lock_p);
+  // Without a log the scores only last as long as the game.
+  insertTop(score_p->name, score_p->score);
+  if (historyReady) scoreIndexAdd(&history, score_p->name, score_p->score);
+  if (thread_p != NULL && numPending < MAX_PENDING)
+  {
+    pending[numPending++] = makeRecord(score_p->name, score_p->score, (uint32_t)time(NULL));
+    SDL_CondSignal(wakeCond_p);
+  }
+  else if (thread_p != NULL)
+  {
+    printf("The score log is falling behind, a score of %d is not saved.\n", score_p->score);
+  }
+  SDL_UnlockMutex(lock_p);
+}
+
+bool scoreStoreRank(int score, uint64_t* games_p, uint64_t* above_p)
+{
+  if (lock_p == NULL) return false;
+  SDL_LockMutex(lock_p);
+  bool ready = historyReady;
+  if (ready)
+  {
+    *games_p = history.count;
+    *above_p = scoreIndexAbove(&history, score);
+  }
+  SDL_UnlockMutex(lock_p);
+  return ready;
+}
+
+bool scoreStoreBest(const char* name_p, int* best_p)
+{
+  if (lock_p == NULL) return false;
+  SDL_LockMutex(lock_p);
+  bool found = historyReady && scoreIndexBest(&history, name_p, best_p);
+  SDL_UnlockMutex(lock_p);
+  return found;
+}
@@ -0,0 +1,522 @@
+#define _GNU_SOURCE // accept4()
+#include <SDL.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <game.h>
+#include <grid.h>
+#include <trace.h>
+#include <spectator.h>
+
+#define MAX_CLIENTS 1024
+#define MAX_QUEUED 64              // Messages waiting for one client.
+#define MIN_CLIENT_BYTES (256 * 1024)
+#define CLIENT_TIMEOUT_MS 5000     // Without taking a byte while behind, the client is dropped.
+#define MAX_EVENTS 256             // Events of the game between two deltas, more are dropped.
+#define MAX_EVENT_BYTES 11         // Type and two varints.
+#define MESSAGE_HEADER_BYTES 4
+
+/* An encoded message, shared by every client it is queued for. */
+typedef struct messageS
+{
+  int refs;
+  uint32_t size; // Including the length in front.
+  uint8_t data[];
+} messageS;
+
+typedef struct clientS
+{
+  int fd;
+  messageS* queue[MAX_QUEUED];
+  int first;
+  int count;
+  uint32_t sent;       // Bytes of queue[first] already sent.
+  size_t queuedBytes;
+  bool needsKeyframe;
+  bool waitingOut;     // EPOLLOUT is armed.
+  uint32_t lastProgressMs;
+} clientS;
+
+static char socketPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static int listenFd = -1;
+static int epollFd = -1;
+static SDL_Thread* thread_p = NULL;
+static SDL_atomic_t quit;
+static SDL_atomic_t score;
+static SDL_atomic_t intervalMs;
+
+// Events of the game, handed from the main thread to the spectator thread.
+static SDL_SpinLock eventsLock = 0;
+static busEventS events[MAX_EVENTS];
+static int numEvents = 0;
+
+// Owned by the spectator thread.
+static clientS* clients[MAX_CLIENTS];
+static int numClients = 0;
+static char* cells_p = NULL;      // The cells as of the last delta.
+static char* nextCells_p = NULL;
+static int gridVersion = GRID_NO_VERSION;
+static uint32_t seq = 0;
+static int sentScore = 0;
+static int sentIntervalMs = 0;
+static messageS* keyframe_p = NULL; // Of the current seq, built when a client needs it.
+static size_t maxClientBytes = MIN_CLIENT_BYTES;
+
+static uint8_t* putU32(uint8_t* data_p, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    *data_p++ = (value >> (8 * i)) & 0xFF;
+  }
+  return data_p;
+}
+
+static uint8_t* putU16(uint8_t* data_p, uint16_t value)
+{
+  *data_p++ = value & 0xFF;
+  *data_p++ = value >> 8;
+  return data_p;
+}
+
+static uint8_t* putVarint(uint8_t* data_p, uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    *data_p++ = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  *data_p++ = (uint8_t)value;
+  return data_p;
+}
+
+static messageS* newMessage(uint32_t capacity)
+{
+  messageS* message_p = malloc(sizeof(messageS) + capacity);
+  if (message_p == NULL) return NULL;
+  message_p->refs = 1;
+  message_p->size = 0;
+  return message_p;
+}
+
+/* finishMessage() writes the length in front of the body that ends at end_p. */
+static void finishMessage(messageS* message_p, const uint8_t* end_p)
+{
+  message_p->size = (uint32_t)(end_p - message_p->data);
+  putU32(message_p->data, message_p->size - MESSAGE_HEADER_BYTES);
+}
+
+static void releaseMessage(messageS* message_p)
+{
+  if (message_p != NULL && --message_p->refs == 0) free(message_p);
+}
+
+static messageS* encodeKeyframe(void)
+{
+  int numCells = gridNumCells();
+  messageS* message_p = newMessage(MESSAGE_HEADER_BYTES + 17 + numCells);
+  if (message_p == NULL) return NULL;
+  uint8_t* data_p = message_p->data + MESSAGE_HEADER_BYTES;
+  *data_p++ = SPECTATOR_KEYFRAME;
+  data_p = putU32(data_p, seq);
+  data_p = putU16(data_p, (uint16_t)gridColumns());
+  data_p = putU16(data_p, (uint16_t)gridRows());
+  data_p = putU32(data_p, (uint32_t)sentScore);
+  data_p = putU32(data_p, (uint32_t)sentIntervalMs);
+  memcpy(data_p, cells_p, numCells);
+  finishMessage(message_p, data_p + numCells);
+  return message_p;
+}
+
+/* encodeDelta() encodes what changed since the last delta, or returns NULL when nothing did. */
+static messageS* encodeDelta(const busEventS* events_p, int count)
+{
+  bool gridChanged = gridSnapshot(nextCells_p, &gridVersion);
+  int newScore = SDL_AtomicGet(&score);
+  int newIntervalMs = SDL_AtomicGet(&intervalMs);
+  int numCells = gridNumCells();
+  int numChanged = 0;
+  if (gridChanged)
+  {
+    for (int i = 0; i < numCells; i++)
+    {
+      if (nextCells_p[i] != cells_p[i]) numChanged++;
+    }
+  }
+  uint8_t flags = (newScore != sentScore ? SPECTATOR_SCORE : 0) |
+                  (newIntervalMs != sentIntervalMs ? SPECTATOR_INTERVAL : 0);
+  if (numChanged == 0 && flags == 0 && count == 0) return NULL;
+
+  messageS* message_p = newMessage(MESSAGE_HEADER_BYTES + 24 + numChanged * 6 + count * MAX_EVENT_BYTES);
+  if (message_p == NULL) return NULL;
+  uint8_t* data_p = message_p->data + MESSAGE_HEADER_BYTES;
+  *data_p++ = SPECTATOR_DELTA;
+  data_p = putU32(data_p, ++seq);
+  *data_p++ = flags;
+  if (flags & SPECTATOR_SCORE) data_p = putU32(data_p, (uint32_t)newScore);
+  if (flags & SPECTATOR_INTERVAL) data_p = putU32(data_p, (uint32_t)newIntervalMs);
+  data_p = putVarint(data_p, numChanged);
+  int previous = -1;
+  for (int i = 0; i < numCells && numChanged > 0; i++)
+  {
+    if (nextCells_p[i] == cells_p[i]) continue;
+    data_p = putVarint(data_p, i - previous);
+    *data_p++ = (uint8_t)nextCells_p[i];
+    cells_p[i] = nextCells_p[i];
+    previous = i;
+  }
+  data_p = putVarint(data_p, count);
+  for (int i = 0; i < count; i++)
+  {
+    const busEventS* event_p = &events_p[i];
+    // Only these carry a character and a cell, the others have nothing in the union.
+    bool placed = event_p->type == BUS_SPAWN || event_p->type == BUS_HIT || event_p->type == BUS_MISS;
+    *data_p++ = (uint8_t)event_p->type;
+    data_p = putVarint(data_p, (placed ? event_p->spawn.charIndex : GAME_NONE) + 1);
+    data_p = putVarint(data_p, (placed ? event_p->spawn.pos : GAME_NONE) + 1);
+  }
+  finishMessage(message_p, data_p);
+  sentScore = newScore;
+  sentIntervalMs = newIntervalMs;
+  return message_p;
+}
+
+static void closeClient(int index)
+{
+  clientS* client_p = clients[index];
+  for (int i = 0; i < client_p->count; i++)
+  {
+    releaseMessage(client_p->queue[(client_p->first + i) % MAX_QUEUED]);
+  }
+  close(client_p->fd); // Also takes it out of epoll.
+  free(client_p);
+  clients[index] = clients[--numClients];
+}
+
+static void watchOut(clientS* client_p, bool out)
+{
+  if (client_p->waitingOut == out) return;
+  struct epoll_event event = {.events = EPOLLIN | (out ? EPOLLOUT : 0), .data.ptr = client_p};
+  epoll_ctl(epollFd, EPOLL_CTL_MOD, client_p->fd, &event);
+  client_p->waitingOut = out;
+}
+
+/* dropQueued() drops the queued messages the client has not started to take, it gets a
+ * keyframe instead. */
+static void dropQueued(clientS* client_p)
+{
+  int keep = client_p->sent > 0 ? 1 : 0;
+  for (int i = keep; i < client_p->count; i++)
+  {
+    messageS* message_p = client_p->queue[(client_p->first + i) % MAX_QUEUED];
+    client_p->queuedBytes -= message_p->size;
+    releaseMessage(message_p);
+  }
+  client_p->count = keep;
+  client_p->needsKeyframe = true;
+}
+
+static void enqueue(clientS* client_p, messageS* message_p)
+{
+  if (client_p->count == MAX_QUEUED || client_p->queuedBytes + message_p->size > maxClientBytes)
+  {
+    // Behind by too much, a keyframe catches up faster than the deltas.
+    dropQueued(client_p);
+    return;
+  }
+  if (client_p->count == 0) client_p->lastProgressMs = SDL_GetTicks();
+  message_p->refs++;
+  client_p->queue[(client_p->first + client_p->count++) % MAX_QUEUED] = message_p;
+  client_p->queuedBytes += message_p->size;
+}
+
+/* flush() sends what the socket of the client takes. Returns false when the client is gone. */
+static bool flush(clientS* client_p)
+{
+  while (client_p->count > 0)
+  {
+    messageS* message_p = client_p->queue[client_p->first];
+    ssize_t sent = send(client_p->fd, message_p->data + client_p->sent, message_p->size - client_p->sent,
+                        MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent < 0)
+    {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+      watchOut(client_p, true);
+      return true;
+    }
+    client_p->lastProgressMs = SDL_GetTicks();
+    client_p->sent += (uint32_t)sent;
+    if (client_p->sent < message_p->size) continue;
+    client_p->sent = 0;
+    client_p->first = (client_p->first + 1) % MAX_QUEUED;
+    client_p->count--;
+    client_p->queuedBytes -= message_p->size;
+    releaseMessage(message_p);
+  }
+  watchOut(client_p, false);
+  return true;
+}
+
+/* serveClient() queues the delta, and the keyframe when it is due, or only a keyframe when the
+ * client needs one. Then sends what it can. Returns false when the client is gone. */
+static bool serveClient(clientS* client_p, messageS* delta_p, bool keyframeDue)
+{
+  if (!client_p->needsKeyframe && delta_p != NULL) enqueue(client_p, delta_p);
+  if (!client_p->needsKeyframe && keyframeDue) client_p->needsKeyframe = true;
+  // A client catching up waits until it is done with the message it has started.
+  if (client_p->needsKeyframe && client_p->count <= 1)
+  {
+    if (keyframe_p == NULL) keyframe_p = encodeKeyframe();
+    if (keyframe_p != NULL)
+    {
+      client_p->needsKeyframe = false;
+      enqueue(client_p, keyframe_p);
+    }
+  }
+  if (client_p->count > 0 && (uint32_t)(SDL_GetTicks() - client_p->lastProgressMs) > CLIENT_TIMEOUT_MS) return false;
+  return flush(client_p);
+}
+
+static void acceptClients(void)
+{
+  for (;;)
+  {
+    int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    clientS* client_p = numClients < MAX_CLIENTS ? calloc(1, sizeof(clientS)) : NULL;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = client_p};
+    if (client_p == NULL || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+      free(client_p);
+      close(fd);
+      continue;
+    }
+    client_p->fd = fd;
+    client_p->needsKeyframe = true;
+    clients[numClients++] = client_p;
+  }
+}
+
+/* tick() sends the changes since the last tick to every client. */
+static void tick(bool keyframeDue)
+{
+  TRACE_SCOPE("spectator tick");
+  static busEventS taken[MAX_EVENTS];
+  SDL_AtomicLock(&eventsLock);
+  int count = numEvents;
+  memcpy(taken, events, count * sizeof(busEventS));
+  numEvents = 0;
+  SDL_AtomicUnlock(&eventsLock);
+
+  messageS* delta_p = encodeDelta(taken, count);
+  if (delta_p != NULL)
+  {
+    releaseMessage(keyframe_p);
+    keyframe_p = NULL;
+  }
+  // Backwards, a client that is gone is replaced by the last one.
+  for (int i = numClients - 1; i >= 0; i--)
+  {
+    if (!serveClient(clients[i], delta_p, keyframeDue)) closeClient(i);
+  }
+  releaseMessage(delta_p);
+}
+
+static int serve(void* unused_p)
+{
+  TRACE_THREAD_NAME("spectator");
+  struct epoll_event ready[64];
+  const uint32_t tickMs = 1000 / SPECTATOR_HZ;
+  uint32_t nextTickMs = SDL_GetTicks();
+  uint32_t nextKeyframeMs = nextTickMs + SPECTATOR_KEYFRAME_MS;
+  while (!SDL_AtomicGet(&quit))
+  {
+    int32_t waitMs = (int32_t)(nextTickMs - SDL_GetTicks());
+    int numReady = epoll_wait(epollFd, ready, 64, waitMs > 0 ? waitMs : 0);
+    for (int i = 0; i < numReady; i++)
+    {
+      clientS* client_p = ready[i].data.ptr;
+      if (client_p == NULL)
+      {
+        acceptClients();
+        continue;
+      }
+      bool gone = (ready[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+      if (!gone && (ready[i].events & EPOLLIN))
+      {
+        // Clients have nothing to say, what they send is read and dropped.
+        char discard[256];
+        gone = recv(client_p->fd, discard, sizeof(discard), MSG_DONTWAIT) == 0;
+      }
+      if (!gone && (ready[i].events & EPOLLOUT)) gone = !flush(client_p);
+      if (gone)
+      {
+        for (int j = 0; j < numClients; j++)
+        {
+          if (clients[j] != client_p) continue;
+          closeClient(j);
+          break;
+        }
+        // The client may also be in a later entry of ready.
+        for (int j = i + 1; j < numReady; j++)
+        {
+          if (ready[j].data.ptr == client_p) ready[j].events = 0;
+        }
+      }
+    }
+    uint32_t now = SDL_GetTicks();
+    if ((int32_t)(now - nextTickMs) < 0) continue;
+    bool keyframeDue = (int32_t)(now - nextKeyframeMs) >= 0;
+    tick(keyframeDue);
+    nextTickMs += tickMs;
+    if ((int32_t)(now - nextTickMs) > 0) nextTickMs = now + tickMs; // Fell behind, skip ticks.
+    if (keyframeDue) nextKeyframeMs = now + SPECTATOR_KEYFRAME_MS;
+  }
+  return 0;
+}
+
+/*
+ * claimSocketPath() makes way for the listening socket at address_p. A socket left behind by a
+ * game that did not exit cleanly refuses connections and is removed. One that accepts them, or
+ * anything else at the path, belongs to someone else and is left alone.
+ */
+static bool claimSocketPath(const struct sockaddr_un* address_p)
+{
+  struct stat status;
+  if (lstat(address_p->sun_path, &status) != 0)
+  {
+    if (errno == ENOENT) return true;
+    printf("Could not check the spectator socket %s: %s\n", address_p->sun_path, strerror(errno));
+    return false;
+  }
+  if (!S_ISSOCK(status.st_mode))
+  {
+    printf("%s is in the way of the spectator socket.\n", address_p->sun_path);
+    return false;
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+  {
+    printf("Could not check the spectator socket %s: %s\n", address_p->sun_path, strerror(errno));
+    return false;
+  }
+  int result = connect(fd, (const struct sockaddr*)address_p, sizeof(*address_p));
+  int error = errno;
+  close(fd);
+  if (result != 0 && error == ECONNREFUSED)
+  {
+    unlink(address_p->sun_path);
+    return true;
+  }
+  // Connected, or the backlog of a live server is full.
+  if (result == 0 || error == EAGAIN)
+  {
+    printf("The spectator socket %s is in use by another game.\n", address_p->sun_path);
+  }
+  else
+  {
+    printf("Could not check the spectator socket %s: %s\n", address_p->sun_path, strerror(error));
+  }
+  return false;
+}
+
+bool spectatorStart(const char* path_p)
+{
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  if (strlen(path_p) >= sizeof(address.sun_path))
+  {
+    printf("The spectator socket path %s is too long.\n", path_p);
+    return false;
+  }
+  strcpy(address.sun_path, path_p);
+  int numCells = gridNumCells();
+  cells_p = malloc(numCells);
+  nextCells_p = malloc(numCells);
+  if (cells_p == NULL || nextCells_p == NULL)
+  {
+    printf("Could not allocate the spectator grid.\n");
+    spectatorStop();
+    return false;
+  }
+  gridVersion = GRID_NO_VERSION;
+  gridSnapshot(cells_p, &gridVersion);
+  if (maxClientBytes < 2 * (size_t)numCells) maxClientBytes = 2 * (size_t)numCells;
+
+  if (!claimSocketPath(&address))
+  {
+    spectatorStop();
+    return false;
+  }
+  listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+  if (listenFd < 0 || epollFd < 0 ||
+      bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0)
+  {
+    printf("Could not listen for spectators on %s: %s\n", path_p, strerror(errno));
+    spectatorStop();
+    return false;
+  }
+  // Ours from now on, spectatorStop() removes it.
+  strcpy(socketPath, path_p);
+  if (listen(listenFd, SOMAXCONN) != 0 ||
+      epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0)
+  {
+    printf("Could not listen for spectators on %s: %s\n", path_p, strerror(errno));
+    spectatorStop();
+    return false;
+  }
+  SDL_AtomicSet(&quit, 0);
+  thread_p = SDL_CreateThread(serve, "spectator", NULL);
+  if (thread_p == NULL)
+  {
+    printf("Could not start the spectator server: %s\n", SDL_GetError());
+    spectatorStop();
+    return false;
+  }
+  return true;
+}
+
+void spectatorStop(void)
+{
+  if (thread_p != NULL)
+  {
+    SDL_AtomicSet(&quit, 1);
+    SDL_WaitThread(thread_p, NULL);
+    thread_p = NULL;
+  }
+  while (numClients > 0) closeClient(numClients - 1);
+  releaseMessage(keyframe_p);
+  keyframe_p = NULL;
+  if (listenFd >= 0) close(listenFd);
+  if (socketPath[0] != '\0') unlink(socketPath);
+  socketPath[0] = '\0';
+  if (epollFd >= 0) close(epollFd);
+  listenFd = -1;
+  epollFd = -1;
+  free(cells_p);
+  free(nextCells_p);
+  cells_p = NULL;
+  nextCells_p = NULL;
+}
+
+void spectatorSetScore(int newScore, int newIntervalMs)
+{
+  SDL_AtomicSet(&score, newScore);
+  SDL_AtomicSet(&intervalMs, newIntervalMs);
+}
+
+void spectatorEvent(const busEventS* event_p)
+{
+  if (thread_p == NULL || event_p->type == BUS_WIND) return;
+  SDL_AtomicLock(&eventsLock);
+  if (numEvents < MAX_EVENTS) events[numEvents++] = *event_p;
+  SDL_AtomicUnlock(&eventsLock);
+}
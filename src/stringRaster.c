@@ -0,0 +1,211 @@
+#include <SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stringRaster.h>
+#include <workerPool.h>
+
+#define OPAQUE_ALPHA 0xFF000000u
+#define TASKS_PER_THREAD 2 // Some columns take longer, smaller bands even that out.
+#define MAX_CELL_SIZE 32
+#define MAX_SOURCE_SIZE 16
+
+static SDL_Renderer* renderer_p = NULL;
+static SDL_Texture* texture_p = NULL;
+static stringSetupS setup;
+static const uint32_t* cylinderPixels_p = NULL; // SDL_PIXELFORMAT_ABGR8888, like the band.
+static int cylinderWidth = 0;
+static int cylinderHeight = 0;
+static int cylinderStride = 0;
+static uint32_t* highlightPixels_p = NULL; // Premultiplied by their alpha.
+static uint32_t* pixels_p = NULL;
+static int bandTop = 0;
+static int bandWidth = 0;
+static int bandHeight = 0;
+
+// The frame being drawn, shared with the worker tasks.
+static const stringColumnS* frameColumns_p = NULL;
+static int frameLightShift = 0;
+static int frameNumTasks = 1;
+
+static uint32_t packColor(int r, int g, int b)
+{
+  return OPAQUE_ALPHA | (uint32_t)b << 16 | (uint32_t)g << 8 | (uint32_t)r;
+}
+
+/*
+ * shade() scales the colour channels like SDL_SetTextureColorMod() does, c * amount / 255.
+ * Red and blue are scaled together in two 16 bit lanes, and x / 255 is computed as
+ * (x + 1 + (x >> 8)) >> 8, which is exact for x up to 255 * 255.
+ */
+static uint32_t shade(uint32_t pixel, uint32_t amount)
+{
+  uint32_t redBlue = (pixel & 0x00FF00FF) * amount;
+  uint32_t green = (pixel & 0x0000FF00) >> 8;
+  green *= amount;
+  redBlue = ((redBlue + 0x00010001 + ((redBlue >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+  green = ((green + 1 + (green >> 8)) >> 8) & 0xFF;
+  return OPAQUE_ALPHA | redBlue | green << 8;
+}
+
+/* addColors() adds b to a with every channel saturating, like SDL_BLENDMODE_ADD. */
+static uint32_t addColors(uint32_t a, uint32_t b)
+{
+  uint32_t r = (a & 0xFF) + (b & 0xFF);
+  uint32_t g = ((a >> 8) & 0xFF) + ((b >> 8) & 0xFF);
+  uint32_t bl = ((a >> 16) & 0xFF) + ((b >> 16) & 0xFF);
+  return packColor(r > 255 ? 255 : r, g > 255 ? 255 : g, bl > 255 ? 255 : bl);
+}
+
+bool stringRasterInit(SDL_Renderer* renderer, const stringSetupS* setup_p)
+{
+  renderer_p = renderer;
+  setup = *setup_p;
+  bandWidth = setup.numColumns * setup.cellSize;
+  bandHeight = setup.cylinderHeight + 2 * setup.cellSize; // Cells reach below the last row.
+  bandTop = setup.centerY - setup.cylinderHeight / 2;
+
+  cylinderPixels_p = setup.cylinderPixels_p;
+  cylinderWidth = setup.bitmapWidth;
+  cylinderHeight = setup.bitmapHeight;
+  cylinderStride = setup.bitmapStride;
+  if (setup.cellSize > MAX_CELL_SIZE) setup.cellSize = MAX_CELL_SIZE;
+  if (setup.sourceWidth > MAX_SOURCE_SIZE) setup.sourceWidth = MAX_SOURCE_SIZE;
+  if (setup.sourceHeight > MAX_SOURCE_SIZE) setup.sourceHeight = MAX_SOURCE_SIZE;
+  highlightPixels_p = malloc(setup.sourceWidth * setup.sourceHeight * sizeof(uint32_t));
+  pixels_p = malloc((size_t)bandWidth * bandHeight * sizeof(uint32_t));
+  if (highlightPixels_p == NULL || pixels_p == NULL)
+  {
+    printf("Could not allocate the string raster.\n");
+    stringRasterDestroy();
+    return false;
+  }
+  setup.cylinderPixels_p = NULL;
+
+  for (int i = 0; i < setup.sourceWidth * setup.sourceHeight; i++)
+  {
+    SDL_Color color = setup.highlight_p[i];
+    highlightPixels_p[i] = packColor(color.r * color.a / 255, color.g * color.a / 255, color.b * color.a / 255);
+  }
+  setup.highlight_p = NULL;
+
+  texture_p = SDL_CreateTexture(renderer_p,
+                                SDL_PIXELFORMAT_ABGR8888,
+                                SDL_TEXTUREACCESS_STREAMING,
+                                bandWidth,
+                                bandHeight);
+  if (texture_p == NULL)
+  {
+    printf("Error when creating texture: %s\n", SDL_GetError());
+    stringRasterDestroy();
+    return false;
+  }
+  // Only the cells are opaque, the rest of the band shows what is behind it.
+  SDL_SetTextureBlendMode(texture_p, SDL_BLENDMODE_BLEND);
+  return true;
+}
+
+void stringRasterDestroy(void)
+{
+  if (texture_p != NULL) SDL_DestroyTexture(texture_p);
+  texture_p = NULL;
+  free(highlightPixels_p);
+  free(pixels_p);
+  cylinderPixels_p = NULL;
+  highlightPixels_p = NULL;
+  pixels_p = NULL;
+}
+
+/* rasterColumn() draws the cells of column number column, from the top cell down, so that a cell
+ * covers the one above it where they overlap. */
+static void rasterColumn(int column)
+{
+  const int cellSize = setup.cellSize;
+  const double twist = frameColumns_p[column].twist;
+  const double offsetY = frameColumns_p[column].offsetY;
+  const int destHeight = cellSize * twist * 2;
+  const int sourceX = column * cellSize * setup.sourceStepX;
+  if (destHeight <= 0) return;
+
+  // Which bitmap column every pixel of a cell row shows, the same in all cells of the column.
+  int sourceColumns[MAX_CELL_SIZE];
+  int highlightColumns[MAX_CELL_SIZE];
+  for (int dx = 0; dx < cellSize; dx++)
+  {
+    highlightColumns[dx] = dx * setup.sourceWidth / cellSize;
+    sourceColumns[dx] = sourceX + highlightColumns[dx];
+    if (sourceColumns[dx] >= cylinderWidth) sourceColumns[dx] = cylinderWidth - 1;
+  }
+
+  for (int y = 0; y < setup.cylinderHeight; y += cellSize)
+  {
+    int sourceY = (int)(offsetY + setup.yOverCylinder_p[y]);
+    sourceY = ((sourceY % cylinderHeight) + cylinderHeight) % cylinderHeight;
+    int destY = (int)round(setup.centerY + ((y - setup.cylinderHeight / 2) * twist)) - bandTop;
+    unsigned int colorY = y - frameLightShift;
+    if (colorY >= (unsigned int)setup.cylinderHeight) colorY = setup.cylinderHeight - 1;
+    uint32_t shadeAmount = (unsigned char)setup.colorOverCylinder_p[colorY];
+    uint32_t highlightAmount = (unsigned char)setup.highlightOverCylinder_p[colorY];
+    uint32_t highlight[MAX_SOURCE_SIZE * MAX_SOURCE_SIZE];
+    if (highlightAmount > 1)
+    {
+      for (int i = 0; i < setup.sourceWidth * setup.sourceHeight; i++)
+      {
+        highlight[i] = shade(highlightPixels_p[i], highlightAmount);
+      }
+    }
+
+    for (int dy = 0; dy < destHeight; dy++)
+    {
+      int row = destY + dy;
+      if (row < 0 || row >= bandHeight) continue;
+      int sourceRow = (sourceY + dy * setup.sourceHeight / destHeight) % cylinderHeight;
+      const uint32_t* source_p = &cylinderPixels_p[sourceRow * cylinderStride];
+      uint32_t* dest_p = &pixels_p[row * bandWidth + column * cellSize];
+      for (int dx = 0; dx < cellSize; dx++)
+      {
+        dest_p[dx] = shade(source_p[sourceColumns[dx]], shadeAmount);
+      }
+      if (highlightAmount > 1)
+      {
+        const uint32_t* highlight_p = &highlight[(dy * setup.sourceHeight / destHeight) * setup.sourceWidth];
+        for (int dx = 0; dx < cellSize; dx++)
+        {
+          dest_p[dx] = addColors(dest_p[dx], highlight_p[highlightColumns[dx]]);
+        }
+      }
+    }
+  }
+}
+
+/* rasterBand() clears and draws one band of columns. */
+static void rasterBand(void* context_p, int task)
+{
+  int first = setup.numColumns * task / frameNumTasks;
+  int last = setup.numColumns * (task + 1) / frameNumTasks;
+  for (int row = 0; row < bandHeight; row++)
+  {
+    memset(&pixels_p[row * bandWidth + first * setup.cellSize], 0, (last - first) * setup.cellSize * sizeof(uint32_t));
+  }
+  for (int column = first; column < last; column++)
+  {
+    rasterColumn(column);
+  }
+}
+
+void stringRasterDraw(const stringColumnS* columns_p, int lightShift)
+{
+  if (texture_p == NULL) return;
+  frameColumns_p = columns_p;
+  frameLightShift = lightShift;
+  frameNumTasks = workerPoolSize() * TASKS_PER_THREAD;
+  if (frameNumTasks > setup.numColumns) frameNumTasks = setup.numColumns;
+  workerPoolRun(rasterBand, NULL, frameNumTasks);
+
+  if (SDL_UpdateTexture(texture_p, NULL, pixels_p, bandWidth * sizeof(uint32_t)))
+  {
+    printf("Error when updating texture: %s\n", SDL_GetError());
+  }
+  SDL_Rect destRect = {0, bandTop, bandWidth, bandHeight};
+  if (SDL_RenderCopy(renderer_p, texture_p, NULL, &destRect)) printf("Error when RenderCopy: %s\n", SDL_GetError());
+}
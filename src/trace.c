@@ -0,0 +1,153 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <trace.h>
+
+#ifdef STORM_TRACE
+
+#define TRACE_MASK (TRACE_BUFFER_EVENTS - 1)
+#define TRACE_PID 1
+
+typedef struct traceEventS
+{
+  const char* name_p;
+  uint64_t start;
+  uint64_t end;
+} traceEventS;
+
+typedef struct traceBufferS
+{
+  struct traceBufferS* next_p;
+  SDL_threadID threadId;
+  void* threadName_p;   // const char*, set with SDL_AtomicSetPtr().
+  SDL_atomic_t written; // Events ever written, the newest is events[(written - 1) & TRACE_MASK].
+  traceEventS events[TRACE_BUFFER_EVENTS];
+} traceBufferS;
+
+// Every thread that recorded anything, newest first. Buffers are never freed, the events of a
+// thread that ended are exported too.
+static void* buffers_p = NULL;
+static _Thread_local traceBufferS* threadBuffer_p = NULL;
+
+/* threadBuffer() returns the buffer of the calling thread, created on first use. */
+static traceBufferS* threadBuffer(void)
+{
+  if (threadBuffer_p != NULL) return threadBuffer_p;
+  traceBufferS* buffer_p = calloc(1, sizeof(traceBufferS));
+  if (buffer_p == NULL) return NULL;
+  buffer_p->threadId = SDL_ThreadID();
+  void* next_p;
+  do
+  {
+    next_p = SDL_AtomicGetPtr(&buffers_p);
+    buffer_p->next_p = next_p;
+  } while (!SDL_AtomicCASPtr(&buffers_p, next_p, buffer_p));
+  threadBuffer_p = buffer_p;
+  return buffer_p;
+}
+
+uint64_t traceNow(void)
+{
+  return SDL_GetPerformanceCounter();
+}
+
+void traceScopeEnd(traceScopeS* scope_p)
+{
+  uint64_t end = SDL_GetPerformanceCounter();
+  traceBufferS* buffer_p = threadBuffer();
+  if (buffer_p == NULL) return;
+  unsigned int written = (unsigned int)SDL_AtomicGet(&buffer_p->written);
+  traceEventS* event_p = &buffer_p->events[written & TRACE_MASK];
+  event_p->name_p = scope_p->name_p;
+  event_p->start = scope_p->start;
+  event_p->end = end;
+  // A full barrier, the event is complete before it is counted.
+  SDL_AtomicSet(&buffer_p->written, (int)(written + 1));
+}
+
+void traceThreadName(const char* name_p)
+{
+  traceBufferS* buffer_p = threadBuffer();
+  if (buffer_p != NULL) SDL_AtomicSetPtr(&buffer_p->threadName_p, (void*)name_p);
+}
+
+/* copyEvents() copies the events of the buffer that are not overwritten while copying. Returns
+ * how many, the oldest first. */
+static int copyEvents(traceBufferS* buffer_p, traceEventS* events_p)
+{
+  unsigned int written = (unsigned int)SDL_AtomicGet(&buffer_p->written);
+  SDL_MemoryBarrierAcquire();
+  unsigned int first = written > TRACE_BUFFER_EVENTS ? written - TRACE_BUFFER_EVENTS : 0;
+  for (unsigned int i = first; i != written; i++)
+  {
+    events_p[i - first] = buffer_p->events[i & TRACE_MASK];
+  }
+  SDL_MemoryBarrierAcquire();
+  // The owner may have written over the oldest events while they were copied, and may be
+  // writing one more event right now.
+  unsigned int reached = (unsigned int)SDL_AtomicGet(&buffer_p->written) + 1 - first;
+  unsigned int overwritten = reached > TRACE_BUFFER_EVENTS ? reached - TRACE_BUFFER_EVENTS : 0;
+  if (overwritten >= written - first) return 0;
+  for (unsigned int i = 0; i < written - first - overwritten; i++)
+  {
+    events_p[i] = events_p[i + overwritten];
+  }
+  return (int)(written - first - overwritten);
+}
+
+bool traceWrite(const char* path_p)
+{
+  FILE* file_p = fopen(path_p, "w");
+  if (file_p == NULL)
+  {
+    printf("Could not create trace %s.\n", path_p);
+    return false;
+  }
+  traceEventS* events_p = malloc(TRACE_BUFFER_EVENTS * sizeof(traceEventS));
+  if (events_p == NULL)
+  {
+    printf("Could not allocate the trace export.\n");
+    fclose(file_p);
+    return false;
+  }
+  const double usPerTick = 1000000.0 / SDL_GetPerformanceFrequency();
+  const char* separator_p = "";
+  fprintf(file_p, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (traceBufferS* buffer_p = SDL_AtomicGetPtr(&buffers_p); buffer_p != NULL; buffer_p = buffer_p->next_p)
+  {
+    unsigned long tid = (unsigned long)buffer_p->threadId;
+    const char* threadName_p = SDL_AtomicGetPtr(&buffer_p->threadName_p);
+    if (threadName_p != NULL)
+    {
+      fprintf(file_p, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+              separator_p, TRACE_PID, tid, threadName_p);
+      separator_p = ",\n";
+    }
+    int numEvents = copyEvents(buffer_p, events_p);
+    for (int i = 0; i < numEvents; i++)
+    {
+      fprintf(file_p, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+              separator_p, events_p[i].name_p, TRACE_PID, tid,
+              events_p[i].start * usPerTick, (events_p[i].end - events_p[i].start) * usPerTick);
+      separator_p = ",\n";
+    }
+  }
+  fprintf(file_p, "\n]}\n");
+  free(events_p);
+  if (fclose(file_p) != 0)
+  {
+    printf("Could not write trace %s.\n", path_p);
+    return false;
+  }
+  return true;
+}
+
+#else
+
+bool traceWrite(const char* path_p)
+{
+  printf("Tracing is not built in, configure with -DSTORM_TRACE=ON to write %s.\n", path_p);
+  return false;
+}
+
+#endif
@@ -0,0 +1,177 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <typingStats.h>
+
+/*
+ * File layout, all integers little endian:
+ *   "SCTS", version (u32), start time (u32, seconds since 1970), seconds played (u32),
+ *   first character (u32), number of characters (u32)
+ * followed by, for every character:
+ *   spawns, hits, misses, sum of the hit times in ms, slowest hit in ms (varints)
+ * A varint stores 7 bits per byte, low bits first, with the top bit set on all but the last.
+ */
+#define STATS_MAGIC "SCTS"
+#define STATS_VERSION 1
+#define MAX_TRIES 16      // Of rejection sampling, then the last uniform pick is taken.
+#define REACTION_SHIFT 3  // The recent hit times of a character weigh 1/8 each.
+#define AVERAGE_SHIFT 5   // Those of all characters 1/32.
+#define MISS_SHIFT 3
+
+typedef struct charStatsS
+{
+  uint32_t spawns;
+  uint32_t spawnTicks;
+  uint32_t hits;
+  uint32_t misses;
+  uint64_t reactionSumMs;
+  uint32_t reactionMaxMs;
+  float reactionMs; // Moving average of the hit times.
+  float missRate;   // Moving average of the keys of the character that were misses.
+} charStatsS;
+
+static charStatsS* stats_p = NULL;
+static int* weights_p = NULL;
+static int firstChar = 0;
+static int numChars = 0;
+static float averageReactionMs = 0;
+static uint32_t startTicks = 0;
+static uint32_t startTime = 0;
+
+bool typingStatsInit(int first, int count)
+{
+  stats_p = calloc(count, sizeof(charStatsS));
+  weights_p = calloc(count, sizeof(int));
+  if (stats_p == NULL || weights_p == NULL)
+  {
+    printf("Could not allocate typing statistics.\n");
+    typingStatsDestroy();
+    return false;
+  }
+  for (int i = 0; i < count; i++)
+  {
+    weights_p[i] = TYPING_STATS_WEIGHT_ONE;
+  }
+  firstChar = first;
+  numChars = count;
+  averageReactionMs = 0;
+  startTicks = SDL_GetTicks();
+  startTime = (uint32_t)time(NULL);
+  return true;
+}
+
+void typingStatsDestroy(void)
+{
+  free(stats_p);
+  free(weights_p);
+  stats_p = NULL;
+  weights_p = NULL;
+  numChars = 0;
+}
+
+/* updateWeight() weighs the character by how much slower than average it is hit, and more the
+ * more often it is mistyped. Only the weight of the character is updated, the others follow
+ * the average when they are hit or missed next. */
+static void updateWeight(int charIndex)
+{
+  const charStatsS* char_p = &stats_p[charIndex];
+  float slowness = (char_p->hits > 0 && averageReactionMs > 0) ? char_p->reactionMs / averageReactionMs : 1.0f;
+  int weight = (int)(TYPING_STATS_WEIGHT_ONE * slowness * (1.0f + 2.0f * char_p->missRate));
+  if (weight < TYPING_STATS_WEIGHT_ONE) weight = TYPING_STATS_WEIGHT_ONE;
+  if (weight > TYPING_STATS_WEIGHT_MAX) weight = TYPING_STATS_WEIGHT_MAX;
+  weights_p[charIndex] = weight;
+}
+
+void typingStatsSpawn(int charIndex)
+{
+  if (stats_p == NULL) return;
+  stats_p[charIndex].spawns++;
+  stats_p[charIndex].spawnTicks = SDL_GetTicks();
+}
+
+void typingStatsHit(int charIndex)
+{
+  if (stats_p == NULL) return;
+  charStatsS* char_p = &stats_p[charIndex];
+  uint32_t reactionMs = SDL_GetTicks() - char_p->spawnTicks;
+  char_p->hits++;
+  char_p->reactionSumMs += reactionMs;
+  if (reactionMs > char_p->reactionMaxMs) char_p->reactionMaxMs = reactionMs;
+  if (char_p->hits == 1) char_p->reactionMs = reactionMs;
+  else char_p->reactionMs += (reactionMs - char_p->reactionMs) / (1 << REACTION_SHIFT);
+  if (averageReactionMs == 0) averageReactionMs = reactionMs;
+  else averageReactionMs += (reactionMs - averageReactionMs) / (1 << AVERAGE_SHIFT);
+  char_p->missRate -= char_p->missRate / (1 << MISS_SHIFT);
+  updateWeight(charIndex);
+}
+
+void typingStatsMiss(int charIndex)
+{
+  if (stats_p == NULL) return;
+  charStatsS* char_p = &stats_p[charIndex];
+  char_p->misses++;
+  char_p->missRate += (1.0f - char_p->missRate) / (1 << MISS_SHIFT);
+  updateWeight(charIndex);
+}
+
+int typingStatsPick(const freeSetS* set_p)
+{
+  int candidate = freeSetPick(set_p, rand());
+  if (weights_p == NULL) return candidate;
+  for (int i = 0; i < MAX_TRIES && candidate != -1; i++)
+  {
+    if (rand() % TYPING_STATS_WEIGHT_MAX < weights_p[candidate]) return candidate;
+    candidate = freeSetPick(set_p, rand());
+  }
+  return candidate;
+}
+
+static void writeU32(FILE* file_p, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    fputc((value >> (8 * i)) & 0xFF, file_p);
+  }
+}
+
+static void writeVarint(FILE* file_p, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    fputc((value & 0x7F) | 0x80, file_p);
+    value >>= 7;
+  }
+  fputc((int)value, file_p);
+}
+
+bool typingStatsSave(const char* path_p)
+{
+  if (stats_p == NULL) return false;
+  FILE* file_p = fopen(path_p, "wb");
+  if (file_p == NULL)
+  {
+    printf("Could not create typing statistics %s.\n", path_p);
+    return false;
+  }
+  fwrite(STATS_MAGIC, 1, 4, file_p);
+  writeU32(file_p, STATS_VERSION);
+  writeU32(file_p, startTime);
+  writeU32(file_p, (SDL_GetTicks() - startTicks) / 1000);
+  writeU32(file_p, (uint32_t)firstChar);
+  writeU32(file_p, (uint32_t)numChars);
+  for (int i = 0; i < numChars; i++)
+  {
+    writeVarint(file_p, stats_p[i].spawns);
+    writeVarint(file_p, stats_p[i].hits);
+    writeVarint(file_p, stats_p[i].misses);
+    writeVarint(file_p, stats_p[i].reactionSumMs);
+    writeVarint(file_p, stats_p[i].reactionMaxMs);
+  }
+  if (fclose(file_p) != 0)
+  {
+    printf("Could not write typing statistics %s.\n", path_p);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,167 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <trace.h>
+#include <workerPool.h>
+
+static SDL_Thread** threads_p = NULL;
+static int numThreads = 0;
+static SDL_mutex* lock_p = NULL;    // Guards the jobs and the counters below.
+static SDL_cond* workCond_p = NULL;
+static SDL_cond* doneCond_p = NULL;
+static bool quit = false;
+
+#define MAX_JOBS 4 // Jobs run at once, each from a thread of its own.
+
+// A job being run. Threads join it only while the thread that runs it has not taken its last
+// task, one that came later would otherwise claim tasks of the next job in the slot.
+typedef struct jobS
+{
+  bool used;
+  bool open;
+  workerTaskT task_p;
+  void* context_p;
+  int numTasks;
+  SDL_atomic_t nextTask;
+  int activeWorkers; // Threads that may still be running tasks of the job.
+} jobS;
+
+static jobS jobs[MAX_JOBS];
+
+static void runTasks(jobS* job_p)
+{
+  TRACE_SCOPE("runTasks");
+  int task;
+  while ((task = SDL_AtomicAdd(&job_p->nextTask, 1)) < job_p->numTasks)
+  {
+    job_p->task_p(job_p->context_p, task);
+  }
+}
+
+/* findWork() returns an open job with tasks left to take, or NULL. */
+static jobS* findWork(void)
+{
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    if (jobs[i].open && SDL_AtomicGet(&jobs[i].nextTask) < jobs[i].numTasks) return &jobs[i];
+  }
+  return NULL;
+}
+
+static int workerThread(void* data_p)
+{
+  TRACE_THREAD_NAME("worker");
+  SDL_LockMutex(lock_p);
+  while (!quit)
+  {
+    jobS* job_p = findWork();
+    if (job_p == NULL)
+    {
+      SDL_CondWait(workCond_p, lock_p);
+      continue;
+    }
+    // Joining under the lock keeps the job from closing underneath.
+    job_p->activeWorkers++;
+    SDL_UnlockMutex(lock_p);
+
+    runTasks(job_p);
+
+    SDL_LockMutex(lock_p);
+    job_p->activeWorkers--;
+    if (job_p->activeWorkers == 0) SDL_CondBroadcast(doneCond_p);
+  }
+  SDL_UnlockMutex(lock_p);
+  return 0;
+}
+
+bool workerPoolInit(int threads)
+{
+  lock_p = SDL_CreateMutex();
+  workCond_p = SDL_CreateCond();
+  doneCond_p = SDL_CreateCond();
+  if (lock_p == NULL || workCond_p == NULL || doneCond_p == NULL)
+  {
+    printf("Could not create worker pool: %s\n", SDL_GetError());
+    return false;
+  }
+
+  quit = false;
+  numThreads = 0;
+  threads_p = malloc(threads * sizeof(SDL_Thread*));
+  for (int i = 0; threads_p != NULL && i < threads; i++)
+  {
+    threads_p[i] = SDL_CreateThread(workerThread, "worker", NULL);
+    if (threads_p[i] == NULL)
+    {
+      printf("Could not create worker thread: %s\n", SDL_GetError());
+      break;
+    }
+    numThreads++;
+  }
+  return true;
+}
+
+void workerPoolDestroy(void)
+{
+  if (lock_p == NULL) return;
+  SDL_LockMutex(lock_p);
+  quit = true;
+  SDL_CondBroadcast(workCond_p);
+  SDL_UnlockMutex(lock_p);
+  for (int i = 0; i < numThreads; i++)
+  {
+    SDL_WaitThread(threads_p[i], NULL);
+  }
+  free(threads_p);
+  threads_p = NULL;
+  numThreads = 0;
+  SDL_DestroyCond(workCond_p);
+  SDL_DestroyCond(doneCond_p);
+  SDL_DestroyMutex(lock_p);
+  lock_p = NULL;
+}
+
+int workerPoolSize(void)
+{
+  return numThreads + 1;
+}
+
+void workerPoolRun(workerTaskT task_p, void* context_p, int numTasks)
+{
+  if (numThreads == 0 || numTasks <= 1)
+  {
+    for (int task = 0; task < numTasks; task++) task_p(context_p, task);
+    return;
+  }
+
+  SDL_LockMutex(lock_p);
+  jobS* job_p = NULL;
+  for (int i = 0; i < MAX_JOBS && job_p == NULL; i++)
+  {
+    if (!jobs[i].used) job_p = &jobs[i];
+  }
+  if (job_p == NULL)
+  {
+    // As many jobs as slots are running, this one runs on the calling thread alone.
+    SDL_UnlockMutex(lock_p);
+    for (int task = 0; task < numTasks; task++) task_p(context_p, task);
+    return;
+  }
+  job_p->used = true;
+  job_p->task_p = task_p;
+  job_p->context_p = context_p;
+  job_p->numTasks = numTasks;
+  SDL_AtomicSet(&job_p->nextTask, 0);
+  job_p->open = true;
+  SDL_CondBroadcast(workCond_p);
+  SDL_UnlockMutex(lock_p);
+
+  runTasks(job_p);
+
+  // Every task is taken, wait for the threads that took some of this job.
+  SDL_LockMutex(lock_p);
+  job_p->open = false;
+  while (job_p->activeWorkers > 0) SDL_CondWait(doneCond_p, lock_p);
+  job_p->used = false;
+  SDL_UnlockMutex(lock_p);
+}
@@ -0,0 +1,443 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <eventBus.h>
+#include <fixedTrig.h>
+#include <trace.h>
+#include <world.h>
+
+#define MAX_SPEED 3
+#define CLOUD_MAX_HEIGHT 50
+#define CLOUD_MAX_WIDTH 200
+#define CLOUD_MAX_SPEED 10
+#define MAX_PHI 2.5
+#define DAMPENING 0.990
+// How far the mesh turns around x, y and z every frame.
+#define MESH_TURN_X FIXED_RADIANS(0.0001)
+#define MESH_TURN_Y FIXED_RADIANS(0.0005)
+#define MESH_TURN_Z FIXED_RADIANS(0.0003)
+
+// One point of the string, the columns are drawn from the points around them.
+typedef struct stringPointS
+{
+  double y;
+  double lastY;
+  double phi;
+  double lastPhi;
+} stringPointS;
+
+static worldConfigS config;
+static SDL_Thread* thread_p = NULL;
+
+// Simulation state, only touched with simLock_p held.
+static SDL_mutex* simLock_p = NULL;
+static uint32_t randomState = 1;
+static int windSpeed = 0;
+static int numClouds = 0;
+static worldCloudS clouds[WORLD_MAX_CLOUDS];
+static leavesS leaves;
+static uint32_t leavesVersion = 1;
+static int numStringPoints = 0;
+static stringPointS* stringPoints_p = NULL;
+static fixedAngleT frameCount = 0;
+static double lightAngle = 0;
+static uint64_t numLensBumps = 0;
+static SDL_Rect lensBumps[WORLD_LENS_BUMPS];
+static fixedAngleT meshOrientation[3];
+
+// Snapshots and requests, only touched with lock_p held.
+static SDL_mutex* lock_p = NULL;
+static SDL_cond* wakeCond_p = NULL;  // The simulation has something to do.
+static SDL_cond* doneCond_p = NULL;  // A snapshot was published or released.
+static worldSnapshotS snapshots[2];
+static int published = 0;
+static int reading = -1;
+static bool quit = false;
+static bool framePending = false;
+static bool publishPending = false;
+static bool ticking = false;
+static Uint32 nextTickMs = 0;
+static uint64_t ticksRequested = 0;
+static uint64_t ticksDone = 0;
+static uint64_t framesRequested = 0; // By worldStepFrame(), each is stepped on its own.
+static uint64_t framesDone = 0;
+
+/* nextRandom() is a xorshift generator, so the world does not share rand() with the game. */
+static int nextRandom(void)
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState & 0x7FFFFFFF;
+}
+
+static void createCloud(void)
+{
+  if (numClouds < WORLD_MAX_CLOUDS)
+  {
+    static const int spriteY[] = {80, 133, 190};
+    worldCloudS* cloud_p = &clouds[numClouds];
+    const int max_y = config.groundY - CLOUD_MAX_HEIGHT;
+    cloud_p->y = nextRandom()%(max_y) + 1;
+    cloud_p->x = config.width;
+    float scale = 1 - ((float)cloud_p->y / max_y);
+    cloud_p->height = CLOUD_MAX_HEIGHT * scale;
+    cloud_p->width = CLOUD_MAX_WIDTH * scale;
+    cloud_p->speed = ((CLOUD_MAX_SPEED >> 2) * scale) + (CLOUD_MAX_SPEED >> 2);
+    cloud_p->spriteY = spriteY[nextRandom()%3];
+    numClouds++;
+  }
+}
+
+/* tick() moves the wind, the leaves and the clouds one step. */
+static void tick(void)
+{
+  TRACE_SCOPE("updateBackground");
+  windSpeed = (nextRandom() % MAX_SPEED << 2);
+  int newLeafRand = nextRandom();
+  if ((newLeafRand % 20 + windSpeed) > 18)
+  {
+    leavesSpawn(&leaves, config.treeX + 20 + nextRandom()%60, config.treeY + 20, newLeafRand % 3 + 1, nextRandom());
+  }
+  else if (newLeafRand%20 > 16)
+  {
+    leavesSpawn(&leaves, config.width + 20, config.groundY - 10, newLeafRand % 3 + 1, nextRandom());
+  }
+  leavesStep(&leaves, windSpeed, windSpeed == ((MAX_SPEED-1) << 2), config.groundY);
+  leavesVersion++;
+
+  if (nextRandom()%(config.width>>4) == 0)
+  {
+    createCloud();
+  }
+
+  int i = 0;
+  while (i < numClouds)
+  {
+    clouds[i].x -= clouds[i].speed;
+    if ((clouds[i].x + clouds[i].width) < 0)
+    {
+      // The last cloud takes its place, and moves in the next round.
+      clouds[i] = clouds[--numClouds];
+    }
+    else
+    {
+      i++;
+    }
+  }
+}
+
+/* stepString() sends the twist of the string one point further along it, with a new twist
+ * at the start. */
+static void stepString(void)
+{
+  lightAngle = fixedToDouble(fixedSin(frameCount * FIXED_RADIANS(1/50.0)));
+  double phaseshift = MAX_PHI * fixedToDouble(fixedSin(frameCount * FIXED_RADIANS(1/40.0)) + fixedSin(frameCount * FIXED_RADIANS(1/28.0)));
+  frameCount++;
+
+  stringPointS* points_p = stringPoints_p;
+  int last = numStringPoints - 1;
+  points_p[0].lastPhi = phaseshift;
+  points_p[0].lastY = (phaseshift/2/3.14 * config.stringHeight);
+  for (int i = 1; i <= last; i++)
+  {
+    // Nothing comes after the last point to move it on, it does so itself.
+    if (i == last)
+    {
+      points_p[i].phi = points_p[i].lastPhi;
+      points_p[i].y = points_p[i].lastY;
+    }
+    points_p[i].lastPhi = points_p[i - 1].phi*DAMPENING;
+    points_p[i].lastY = points_p[i - 1].y*DAMPENING;
+    points_p[i - 1].phi = points_p[i - 1].lastPhi;
+    points_p[i - 1].y = points_p[i - 1].lastY;
+  }
+}
+
+static double calcTwistFactor(double phiDiff)
+{
+  // cos() is even, the sign of phiDiff does not matter.
+  return fixedToDouble((FIXED_ONE + fixedCos(fixedAngleFromRadians(7*phiDiff))) / 2);
+}
+
+static void stepLens(void)
+{
+  SDL_Rect* bump_p = &lensBumps[numLensBumps % WORLD_LENS_BUMPS];
+  bump_p->w = config.lensBumpSize;
+  bump_p->h = config.lensBumpSize;
+  bump_p->x = nextRandom()%(config.width - bump_p->w);
+  bump_p->y = nextRandom()%(config.height - bump_p->h);
+  numLensBumps++;
+}
+
+/* stepMesh() turns the mesh one frame further. */
+static void stepMesh(void)
+{
+  meshOrientation[0] += MESH_TURN_X;
+  meshOrientation[1] += MESH_TURN_Y;
+  meshOrientation[2] += MESH_TURN_Z;
+}
+
+/*
+ * publish() writes the state into the snapshot the renderer is not reading and makes it the
+ * newest. If the renderer still holds it from before the last publish, that is waited out.
+ */
+static void publish(void)
+{
+  TRACE_SCOPE("publish");
+  SDL_LockMutex(lock_p);
+  int target = 1 - published;
+  while (reading == target) SDL_CondWait(doneCond_p, lock_p);
+  SDL_UnlockMutex(lock_p);
+
+  worldSnapshotS* snapshot_p = &snapshots[target];
+  snapshot_p->windSpeed = windSpeed;
+  snapshot_p->numClouds = numClouds;
+  memcpy(snapshot_p->clouds, clouds, numClouds * sizeof(worldCloudS));
+
+  if (snapshot_p->leavesVersion != leavesVersion)
+  {
+    int numRects = 0;
+    for (int state = 0; state < LEAF_NUM_STATES; state++)
+    {
+      int count = 0;
+      const SDL_Rect* rects_p = leavesRects(&leaves, state, config.leafSize, &count);
+      snapshot_p->leafStart[state] = numRects;
+      memcpy(&snapshot_p->leafRects_p[numRects], rects_p, count * sizeof(SDL_Rect));
+      numRects += count;
+    }
+    snapshot_p->leafStart[LEAF_NUM_STATES] = numRects;
+    snapshot_p->leavesVersion = leavesVersion;
+  }
+
+  for (int i = 0; i < config.stringColumns; i++)
+  {
+    snapshot_p->columns_p[i].twist = calcTwistFactor(stringPoints_p[i].phi - stringPoints_p[i + 2].phi);
+    snapshot_p->columns_p[i].offsetY = stringPoints_p[i + 1].y;
+  }
+  snapshot_p->lightAngle = lightAngle;
+  snapshot_p->numLensBumps = numLensBumps;
+  memcpy(snapshot_p->lensBumps, lensBumps, sizeof(lensBumps));
+  memcpy(snapshot_p->meshOrientation, meshOrientation, sizeof(meshOrientation));
+
+  SDL_LockMutex(lock_p);
+  published = target;
+  SDL_UnlockMutex(lock_p);
+}
+
+/* notifyTick() wakes up the main loop, the background changed. */
+static void notifyTick(void)
+{
+  busEventS event = {.type = BUS_WIND, .wind = {windSpeed}};
+  eventBusPublish(&event);
+}
+
+static int simulate(void* unused_p)
+{
+  TRACE_THREAD_NAME("world");
+  SDL_LockMutex(lock_p);
+  while (!quit)
+  {
+    Uint32 now = SDL_GetTicks();
+    bool tickDue = ticking && (Sint32)(now - nextTickMs) >= 0;
+    if (!tickDue && !framePending && !publishPending && ticksDone == ticksRequested &&
+        framesDone == framesRequested)
+    {
+      if (ticking) SDL_CondWaitTimeout(wakeCond_p, lock_p, nextTickMs - now);
+      else SDL_CondWait(wakeCond_p, lock_p);
+      continue;
+    }
+
+    uint64_t ticksTaken = ticksRequested;
+    int numTicks = (int)(ticksTaken - ticksDone);
+    if (tickDue)
+    {
+      numTicks++;
+      nextTickMs += config.tickMs;
+      // After a stall the missed ticks are dropped, not run all at once.
+      if ((Sint32)(now - nextTickMs) >= 0) nextTickMs = now + config.tickMs;
+    }
+    uint64_t framesTaken = framesRequested;
+    int numFrames = (int)(framesTaken - framesDone);
+    // The frames render() asks for are coalesced, and go with any others.
+    if (framePending && numFrames == 0) numFrames = 1;
+    framePending = false;
+    publishPending = false;
+    SDL_UnlockMutex(lock_p);
+
+    SDL_LockMutex(simLock_p);
+    for (int i = 0; i < numTicks; i++) tick();
+    for (int i = 0; i < numFrames; i++)
+    {
+      TRACE_SCOPE("frame step");
+      stepString();
+      stepLens();
+      stepMesh();
+    }
+    publish();
+    SDL_UnlockMutex(simLock_p);
+    if (numTicks > 0) notifyTick();
+
+    SDL_LockMutex(lock_p);
+    ticksDone = ticksTaken;
+    framesDone = framesTaken;
+    SDL_CondBroadcast(doneCond_p);
+  }
+  SDL_UnlockMutex(lock_p);
+  return 0;
+}
+
+bool worldInit(const worldConfigS* config_p)
+{
+  config = *config_p;
+  randomState = config.seed | 1; // The generator gets stuck at zero.
+  // One point before the first column and two after the last.
+  numStringPoints = config.stringColumns + 3;
+  stringPoints_p = calloc(numStringPoints, sizeof(stringPointS));
+  for (int i = 0; i < 2; i++)
+  {
+    snapshots[i].leafRects_p = malloc(config.maxLeaves * sizeof(SDL_Rect));
+    snapshots[i].columns_p = calloc(config.stringColumns, sizeof(stringColumnS));
+  }
+  simLock_p = SDL_CreateMutex();
+  lock_p = SDL_CreateMutex();
+  wakeCond_p = SDL_CreateCond();
+  doneCond_p = SDL_CreateCond();
+  if (stringPoints_p == NULL || snapshots[0].leafRects_p == NULL || snapshots[0].columns_p == NULL ||
+      snapshots[1].leafRects_p == NULL || snapshots[1].columns_p == NULL)
+  {
+    printf("Could not allocate the world.\n");
+    worldDestroy();
+    return false;
+  }
+  if (simLock_p == NULL || lock_p == NULL || wakeCond_p == NULL || doneCond_p == NULL)
+  {
+    printf("Could not create world locks: %s\n", SDL_GetError());
+    worldDestroy();
+    return false;
+  }
+  if (!leavesInit(&leaves, config.maxLeaves))
+  {
+    worldDestroy();
+    return false;
+  }
+
+  quit = false;
+  ticking = false;
+  publish();
+  thread_p = SDL_CreateThread(simulate, "world", NULL);
+  if (thread_p == NULL)
+  {
+    printf("Could not start the world thread: %s\n", SDL_GetError());
+    worldDestroy();
+    return false;
+  }
+  return true;
+}
+
+void worldDestroy(void)
+{
+  if (thread_p != NULL)
+  {
+    SDL_LockMutex(lock_p);
+    quit = true;
+    SDL_CondSignal(wakeCond_p);
+    SDL_UnlockMutex(lock_p);
+    SDL_WaitThread(thread_p, NULL);
+    thread_p = NULL;
+  }
+  if (simLock_p != NULL) SDL_DestroyMutex(simLock_p);
+  if (lock_p != NULL) SDL_DestroyMutex(lock_p);
+  if (wakeCond_p != NULL) SDL_DestroyCond(wakeCond_p);
+  if (doneCond_p != NULL) SDL_DestroyCond(doneCond_p);
+  simLock_p = NULL;
+  lock_p = NULL;
+  wakeCond_p = NULL;
+  doneCond_p = NULL;
+  leavesDestroy(&leaves);
+  for (int i = 0; i < 2; i++)
+  {
+    free(snapshots[i].leafRects_p);
+    free(snapshots[i].columns_p);
+    memset(&snapshots[i], 0, sizeof(worldSnapshotS));
+  }
+  free(stringPoints_p);
+  stringPoints_p = NULL;
+  published = 0;
+  reading = -1;
+  ticksRequested = 0;
+  ticksDone = 0;
+  framesRequested = 0;
+  framesDone = 0;
+}
+
+const worldSnapshotS* worldAcquire(void)
+{
+  SDL_LockMutex(lock_p);
+  reading = published;
+  SDL_UnlockMutex(lock_p);
+  return &snapshots[reading];
+}
+
+void worldRelease(void)
+{
+  SDL_LockMutex(lock_p);
+  reading = -1;
+  SDL_CondBroadcast(doneCond_p);
+  SDL_UnlockMutex(lock_p);
+}
+
+void worldRequestFrame(void)
+{
+  SDL_LockMutex(lock_p);
+  framePending = true;
+  SDL_CondSignal(wakeCond_p);
+  SDL_UnlockMutex(lock_p);
+}
+
+void worldStepFrame(void)
+{
+  SDL_LockMutex(lock_p);
+  uint64_t target = ++framesRequested;
+  SDL_CondSignal(wakeCond_p);
+  while (framesDone < target) SDL_CondWait(doneCond_p, lock_p);
+  SDL_UnlockMutex(lock_p);
+}
+
+void worldSetTicking(bool running)
+{
+  SDL_LockMutex(lock_p);
+  if (running && !ticking) nextTickMs = SDL_GetTicks() + config.tickMs;
+  ticking = running;
+  SDL_CondSignal(wakeCond_p);
+  SDL_UnlockMutex(lock_p);
+}
+
+void worldTick(void)
+{
+  SDL_LockMutex(lock_p);
+  uint64_t target = ++ticksRequested;
+  SDL_CondSignal(wakeCond_p);
+  while (ticksDone < target) SDL_CondWait(doneCond_p, lock_p);
+  SDL_UnlockMutex(lock_p);
+}
+
+int worldStorm(int numLeaves)
+{
+  SDL_LockMutex(simLock_p);
+  int added = 0;
+  while (added < numLeaves &&
+         leavesSpawn(&leaves, nextRandom() % config.width, nextRandom() % config.groundY, nextRandom() % 3 + 1, nextRandom()))
+  {
+    added++;
+  }
+  leavesVersion++;
+  SDL_UnlockMutex(simLock_p);
+
+  SDL_LockMutex(lock_p);
+  publishPending = true;
+  SDL_CondSignal(wakeCond_p);
+  SDL_UnlockMutex(lock_p);
+  return added;
+}
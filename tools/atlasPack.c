@@ -0,0 +1,174 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atlas.h>
+
+/*
+ * atlasPack packs the bitmaps of the game into the atlas the game maps at startup, see atlas.h.
+ * It is run by the build, whenever one of the bitmaps changes.
+ *
+ * Usage: atlasPack sourceDirectory output
+ */
+
+#define NO_KEY -1
+#define MAX_PATH_SIZE 1024
+
+enum { PAGE_SPRITES, PAGE_FONT, PAGE_CYLINDER, NUM_PAGES };
+
+typedef struct packImageS
+{
+  const char* name_p;
+  const char* file_p;
+  int keyPixel;  // Index of the pixel whose colour is transparent, or NO_KEY.
+  int page;
+} packImageS;
+
+// Images of a page are stacked top to bottom in this order.
+static const packImageS packImages[] =
+{
+  {"leaves", "leaves2.bmp", 100, PAGE_SPRITES},      // Sky, ground, tree and leaf colours.
+  {"clouds", "leaves2.bmp", 126, PAGE_SPRITES},      // The same bitmap, keyed on the sky.
+  {"font", "consolas.bmp", 100, PAGE_FONT},
+  {"cylinder", "cylinder.bmp", NO_KEY, PAGE_CYLINDER}, // Only read by the string raster.
+};
+#define NUM_IMAGES (int)(sizeof(packImages) / sizeof(packImages[0]))
+
+static SDL_Surface* surfaces[NUM_IMAGES];
+static atlasPageS pages[NUM_PAGES];
+static atlasImageS images[NUM_IMAGES];
+
+/* loadImage() loads the bitmap of image i in the atlas format and applies its colour key. */
+static bool loadImage(const char* directory_p, int i)
+{
+  const packImageS* pack_p = &packImages[i];
+  char path[MAX_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s/%s", directory_p, pack_p->file_p);
+  SDL_Surface* source_p = SDL_LoadBMP(path);
+  if (source_p == NULL)
+  {
+    printf("Error when loading BMP %s: %s\n", path, SDL_GetError());
+    return false;
+  }
+  SDL_Surface* converted_p = SDL_ConvertSurfaceFormat(source_p, ATLAS_PIXEL_FORMAT, 0);
+  if (converted_p == NULL)
+  {
+    printf("Error when converting %s: %s\n", path, SDL_GetError());
+    SDL_FreeSurface(source_p);
+    return false;
+  }
+
+  atlasImageS* image_p = &images[i];
+  strncpy(image_p->name, pack_p->name_p, ATLAS_NAME_SIZE - 1);
+  image_p->page = pack_p->page;
+  image_p->width = converted_p->w;
+  image_p->height = converted_p->h;
+  if (pack_p->keyPixel != NO_KEY)
+  {
+    // Like SDL_CreateTextureFromSurface() with a colour key: the pixels that equal the key in
+    // the bitmap keep their colour and become transparent.
+    int bytesPerPixel = source_p->format->BytesPerPixel;
+    uint32_t key = 0;
+    memcpy(&key, (const Uint8*)source_p->pixels + pack_p->keyPixel * bytesPerPixel, bytesPerPixel);
+    image_p->flags = ATLAS_KEYED;
+    image_p->colorKey = ((const uint32_t*)converted_p->pixels)[pack_p->keyPixel];
+    for (int y = 0; y < source_p->h; y++)
+    {
+      const Uint8* sourceRow_p = (const Uint8*)source_p->pixels + y * source_p->pitch;
+      uint32_t* row_p = (uint32_t*)((Uint8*)converted_p->pixels + y * converted_p->pitch);
+      for (int x = 0; x < source_p->w; x++)
+      {
+        uint32_t pixel = 0;
+        memcpy(&pixel, sourceRow_p + x * bytesPerPixel, bytesPerPixel);
+        if (pixel == key) row_p[x] &= ~converted_p->format->Amask;
+      }
+    }
+  }
+  SDL_FreeSurface(source_p);
+  surfaces[i] = converted_p;
+  return true;
+}
+
+/* layout() stacks the images into their pages and places the pages in the file. Returns the
+ * size of the file. */
+static uint32_t layout(void)
+{
+  for (int i = 0; i < NUM_IMAGES; i++)
+  {
+    atlasPageS* page_p = &pages[images[i].page];
+    images[i].y = page_p->height;
+    page_p->height += images[i].height;
+    if (images[i].width > page_p->width) page_p->width = images[i].width;
+  }
+  uint32_t offset = sizeof(atlasHeaderS) + sizeof(pages) + sizeof(images);
+  for (int p = 0; p < NUM_PAGES; p++)
+  {
+    offset = (offset + ATLAS_ALIGN - 1) / ATLAS_ALIGN * ATLAS_ALIGN;
+    pages[p].format = ATLAS_PIXEL_FORMAT;
+    pages[p].pitch = pages[p].width * sizeof(uint32_t);
+    pages[p].offset = offset;
+    offset += pages[p].pitch * pages[p].height;
+  }
+  return offset;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 3)
+  {
+    printf("Usage: atlasPack sourceDirectory output\n");
+    return 1;
+  }
+  for (int i = 0; i < NUM_IMAGES; i++)
+  {
+    if (!loadImage(argv[1], i)) return 1;
+  }
+  atlasHeaderS header =
+  {
+    .magic = ATLAS_MAGIC,
+    .version = ATLAS_VERSION,
+    .size = layout(),
+    .numPages = NUM_PAGES,
+    .numImages = NUM_IMAGES,
+  };
+
+  uint8_t* file_p = calloc(header.size, 1);
+  if (file_p == NULL)
+  {
+    printf("Could not allocate the atlas.\n");
+    return 1;
+  }
+  memcpy(file_p, &header, sizeof(header));
+  memcpy(file_p + sizeof(header), pages, sizeof(pages));
+  memcpy(file_p + sizeof(header) + sizeof(pages), images, sizeof(images));
+  for (int i = 0; i < NUM_IMAGES; i++)
+  {
+    const atlasPageS* page_p = &pages[images[i].page];
+    for (uint32_t y = 0; y < images[i].height; y++)
+    {
+      memcpy(file_p + page_p->offset + (images[i].y + y) * page_p->pitch,
+             (const Uint8*)surfaces[i]->pixels + y * surfaces[i]->pitch,
+             images[i].width * sizeof(uint32_t));
+    }
+    SDL_FreeSurface(surfaces[i]);
+  }
+
+  FILE* out_p = fopen(argv[2], "wb");
+  if (out_p == NULL)
+  {
+    printf("Could not create %s.\n", argv[2]);
+    free(file_p);
+    return 1;
+  }
+  bool written = fwrite(file_p, 1, header.size, out_p) == header.size;
+  written = fclose(out_p) == 0 && written;
+  free(file_p);
+  if (!written)
+  {
+    printf("Could not write %s.\n", argv[2]);
+    remove(argv[2]);
+    return 1;
+  }
+  printf("Packed %d images into %d pages, %u bytes.\n", NUM_IMAGES, NUM_PAGES, header.size);
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <game.h>
+#include <spectator.h>
+
+/*
+ * Watches a game started with --spectate SOCKET, drawing the grid in the terminal.
+ * Usage: spectatorView SOCKET [--quiet]
+ * With --quiet only a count of the messages is printed every second, to load test the server
+ * with many viewers.
+ */
+
+static char* cells_p = NULL;
+static int columns = 0;
+static int rows = 0;
+static int score = 0;
+static int intervalMs = 0;
+static uint32_t seq = 0;
+static int synced = 0;
+static char lastEvent[64] = "";
+
+static int readFull(int fd, void* data_p, size_t size)
+{
+  char* bytes_p = data_p;
+  while (size > 0)
+  {
+    ssize_t got = read(fd, bytes_p, size);
+    if (got <= 0) return 0;
+    bytes_p += got;
+    size -= got;
+  }
+  return 1;
+}
+
+static uint32_t getU32(const uint8_t** data_pp)
+{
+  const uint8_t* data_p = *data_pp;
+  *data_pp += 4;
+  return data_p[0] | (data_p[1] << 8) | (data_p[2] << 16) | ((uint32_t)data_p[3] << 24);
+}
+
+static uint16_t getU16(const uint8_t** data_pp)
+{
+  const uint8_t* data_p = *data_pp;
+  *data_pp += 2;
+  return data_p[0] | (data_p[1] << 8);
+}
+
+static uint32_t getVarint(const uint8_t** data_pp, const uint8_t* end_p)
+{
+  uint32_t value = 0;
+  for (int shift = 0; shift < 35 && *data_pp < end_p; shift += 7)
+  {
+    uint8_t byte = *(*data_pp)++;
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) break;
+  }
+  return value;
+}
+
+static void applyKeyframe(const uint8_t* data_p, const uint8_t* end_p)
+{
+  if (end_p - data_p < 16) return;
+  seq = getU32(&data_p);
+  int newColumns = getU16(&data_p);
+  int newRows = getU16(&data_p);
+  score = (int32_t)getU32(&data_p);
+  intervalMs = (int)getU32(&data_p);
+  if (end_p - data_p < newColumns * newRows) return;
+  if (newColumns * newRows != columns * rows)
+  {
+    free(cells_p);
+    cells_p = malloc(newColumns * newRows);
+    if (cells_p == NULL) exit(1);
+  }
+  columns = newColumns;
+  rows = newRows;
+  memcpy(cells_p, data_p, columns * rows);
+  synced = 1;
+}
+
+static void applyDelta(const uint8_t* data_p, const uint8_t* end_p)
+{
+  if (end_p - data_p < 5) return;
+  uint32_t deltaSeq = getU32(&data_p);
+  if (!synced || deltaSeq != seq + 1)
+  {
+    // Missed a delta, the next keyframe puts things right.
+    synced = 0;
+    return;
+  }
+  seq = deltaSeq;
+  uint8_t flags = *data_p++;
+  if ((flags & SPECTATOR_SCORE) && end_p - data_p >= 4) score = (int32_t)getU32(&data_p);
+  if ((flags & SPECTATOR_INTERVAL) && end_p - data_p >= 4) intervalMs = (int)getU32(&data_p);
+  uint32_t numCells = getVarint(&data_p, end_p);
+  int index = -1;
+  for (uint32_t i = 0; i < numCells && data_p < end_p; i++)
+  {
+    index += getVarint(&data_p, end_p);
+    if (data_p >= end_p) break;
+    char cell = (char)*data_p++;
+    if (index >= 0 && index < columns * rows) cells_p[index] = cell;
+  }
+  uint32_t numEvents = getVarint(&data_p, end_p);
+  for (uint32_t i = 0; i < numEvents && data_p < end_p; i++)
+  {
+    int type = *data_p++;
+    int charIndex = (int)getVarint(&data_p, end_p) - 1;
+    int pos = (int)getVarint(&data_p, end_p) - 1;
+    char character = charIndex >= 0 ? (char)(charIndex + GAME_START_CHAR) : '?';
+    if (type == BUS_HIT) snprintf(lastEvent, sizeof(lastEvent), "hit %c at %d", character, pos);
+    else if (type == BUS_MISS) snprintf(lastEvent, sizeof(lastEvent), "missed %c", character);
+    else if (type == BUS_GAME_OVER) snprintf(lastEvent, sizeof(lastEvent), "game over");
+  }
+}
+
+static void draw(void)
+{
+  printf("\033[H\033[2J");
+  printf("Score %d, a character every %d ms%s\n", score, intervalMs, synced ? "" : " (waiting for a keyframe)");
+  for (int y = 0; y < rows; y++)
+  {
+    fwrite(&cells_p[y * columns], 1, columns, stdout);
+    putchar('\n');
+  }
+  printf("%s\n", lastEvent);
+  fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2 || (argc > 2 && strcmp(argv[2], "--quiet") != 0))
+  {
+    printf("Usage: %s SOCKET [--quiet]\n", argv[0]);
+    return 1;
+  }
+  int quiet = argc > 2;
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", argv[1]);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+  {
+    printf("Could not connect to %s.\n", argv[1]);
+    return 1;
+  }
+
+  uint8_t* message_p = NULL;
+  uint32_t capacity = 0;
+  unsigned long keyframes = 0;
+  unsigned long deltas = 0;
+  unsigned long gaps = 0;
+  time_t lastReport = time(NULL);
+  uint8_t header[4];
+  while (readFull(fd, header, sizeof(header)))
+  {
+    const uint8_t* header_p = header;
+    uint32_t size = getU32(&header_p);
+    if (size == 0) continue;
+    if (size > capacity)
+    {
+      free(message_p);
+      message_p = malloc(size);
+      capacity = message_p != NULL ? size : 0;
+      if (message_p == NULL) return 1;
+    }
+    if (!readFull(fd, message_p, size)) break;
+    if (message_p[0] == SPECTATOR_KEYFRAME)
+    {
+      applyKeyframe(message_p + 1, message_p + size);
+      keyframes++;
+    }
+    else if (message_p[0] == SPECTATOR_DELTA)
+    {
+      int wasSynced = synced;
+      applyDelta(message_p + 1, message_p + size);
+      deltas++;
+      if (wasSynced && !synced) gaps++;
+    }
+    if (!quiet && cells_p != NULL)
+    {
+      draw();
+    }
+    else if (quiet && time(NULL) != lastReport)
+    {
+      lastReport = time(NULL);
+      printf("seq %u: %lu keyframes, %lu deltas, %lu gaps\n", seq, keyframes, deltas, gaps);
+      fflush(stdout);
+    }
+  }
+  printf("The game has ended.\n");
+  free(message_p);
+  free(cells_p);
+  close(fd);
+  return 0;
+}